@@ -49,6 +49,8 @@ std::string BMC::getUnitState(const std::string& unitToCheck)
     std::variant<std::string> currentState;
     sdbusplus::message::object_path unitTargetPath;
 
+    // The initial state is read while systemd is busy starting the BMC's
+    // units, so each call is given the time of a slow call
     auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
                                             SYSTEMD_INTERFACE, "GetUnit");
 
@@ -56,7 +58,7 @@ std::string BMC::getUnitState(const std::string& unitToCheck)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = utils::call(this->bus, method, utils::CallClass::Slow);
         result.read(unitTargetPath);
     }
     catch (const sdbusplus::exception_t& e)
@@ -76,7 +78,7 @@ std::string BMC::getUnitState(const std::string& unitToCheck)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = utils::call(this->bus, method, utils::CallClass::Slow);
 
         // Is input target active or inactive?
         result.read(currentState);
@@ -131,7 +133,7 @@ void BMC::executeTransition(const Transition tranReq)
             SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE, "Reboot");
         try
         {
-            this->bus.call(method);
+            utils::call(this->bus, method, utils::CallClass::Control);
         }
         catch (const sdbusplus::exception_t& e)
         {
@@ -161,7 +163,7 @@ void BMC::executeTransition(const Transition tranReq)
 
         try
         {
-            this->bus.call(method);
+            utils::call(this->bus, method, utils::CallClass::Control);
         }
         catch (const sdbusplus::exception_t& e)
         {
@@ -195,7 +197,7 @@ int BMC::bmcStateChange(sdbusplus::message_t& msg)
 
         try
         {
-            this->bus.call(method);
+            utils::call(this->bus, method, utils::CallClass::Control);
         }
         catch (const sdbusplus::exception_t& e)
         {
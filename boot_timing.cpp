@@ -0,0 +1,175 @@
+#include "boot_timing.hpp"
+
+#include <cereal/archives/json.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/string.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+using ProgressStages = BootTiming::ProgressStages;
+
+namespace
+{
+
+/** @brief Check if the host firmware has handed over to the OS */
+bool osStarted(ProgressStages stage)
+{
+    return (stage == ProgressStages::OSStart) ||
+           (stage == ProgressStages::OSRunning);
+}
+
+BootTiming::Record toRecord(const BootTiming::Stats& stats)
+{
+    return {stats.last, stats.min, stats.max, stats.average, stats.count};
+}
+
+} // namespace
+
+void BootTiming::Stats::add(uint64_t ms)
+{
+    last = ms;
+    if (count == 0)
+    {
+        min = ms;
+        max = ms;
+        average = static_cast<double>(ms);
+    }
+    else
+    {
+        min = std::min(min, ms);
+        max = std::max(max, ms);
+        average += averageWeight * (static_cast<double>(ms) - average);
+    }
+
+    if (count < std::numeric_limits<uint32_t>::max())
+    {
+        count++;
+    }
+}
+
+BootTiming::BootTiming(const fs::path& path) : path(path)
+{
+    load();
+}
+
+void BootTiming::resume(ProgressStages current)
+{
+    stage = current;
+    stageStart.reset();
+    iplStart.reset();
+}
+
+bool BootTiming::progress(ProgressStages next, Clock::time_point now)
+{
+    if (next == stage)
+    {
+        return false;
+    }
+
+    auto elapsed = [now](Clock::time_point start) -> uint64_t {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now -
+                                                                     start)
+            .count();
+    };
+
+    // The OS running is not part of the boot, and a stage after it starts
+    // the next boot, e.g. for a warm reboot
+    bool newBoot = (stage == ProgressStages::Unspecified) ||
+                   (osStarted(stage) && !osStarted(next));
+    bool changed = false;
+
+    if (stageStart && (stage != ProgressStages::OSRunning) &&
+        (next != ProgressStages::Unspecified) && !newBoot)
+    {
+        stageStats[convertForMessage(stage)].add(elapsed(*stageStart));
+        changed = true;
+    }
+
+    if (next == ProgressStages::Unspecified)
+    {
+        stageStart.reset();
+        iplStart.reset();
+    }
+    else
+    {
+        stageStart = now;
+        if (newBoot)
+        {
+            iplStart = now;
+        }
+
+        if (iplStart && osStarted(next))
+        {
+            iplStats.add(elapsed(*iplStart));
+            iplStart.reset();
+            changed = true;
+        }
+    }
+
+    stage = next;
+
+    if (changed)
+    {
+        store();
+    }
+    return changed;
+}
+
+std::map<std::string, BootTiming::Record> BootTiming::stages() const
+{
+    std::map<std::string, Record> records;
+    for (const auto& [name, stats] : stageStats)
+    {
+        records.emplace(name, toRecord(stats));
+    }
+    return records;
+}
+
+BootTiming::Record BootTiming::ipl() const
+{
+    return toRecord(iplStats);
+}
+
+void BootTiming::store() const
+{
+    std::ofstream os(path.c_str(), std::ios::binary);
+    cereal::JSONOutputArchive oarchive(os);
+    oarchive(stageStats, iplStats);
+}
+
+void BootTiming::load()
+{
+    try
+    {
+        if (fs::exists(path))
+        {
+            std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+            cereal::JSONInputArchive iarchive(is);
+            iarchive(stageStats, iplStats);
+        }
+    }
+    catch (const cereal::Exception& e)
+    {
+        error("Failed to load the boot timing: {ERROR}", "ERROR", e);
+        stageStats.clear();
+        iplStats = {};
+        fs::remove(path);
+    }
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <xyz/openbmc_project/State/Boot/Progress/server.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+namespace fs = std::filesystem;
+
+/** @class BootTiming
+ *  @brief Times the BootProgress stages of a host and keeps rolling
+ *         statistics of them across boots, in a persisted file
+ */
+class BootTiming
+{
+  public:
+    using ProgressStages = sdbusplus::xyz::openbmc_project::State::Boot::
+        server::Progress::ProgressStages;
+    using Clock = std::chrono::steady_clock;
+
+    /** @brief Statistics of a duration, in milliseconds */
+    struct Stats
+    {
+        uint64_t last = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+
+        /** @brief Exponentially weighted moving average */
+        double average = 0;
+
+        /** @brief The number of durations seen */
+        uint32_t count = 0;
+
+        /** @brief Add a duration */
+        void add(uint64_t ms);
+
+        template <class Archive>
+        void serialize(Archive& archive)
+        {
+            archive(last, min, max, average, count);
+        }
+    };
+
+    /** @brief The statistics as sent on D-Bus: last, min, max, average and
+     *         count */
+    using Record = std::tuple<uint64_t, uint64_t, uint64_t, double, uint32_t>;
+
+    /** @brief Constructor, loads the persisted statistics
+     *
+     * @param[in] path - The file the statistics are persisted in
+     */
+    explicit BootTiming(const fs::path& path);
+
+    /** @brief Continue from the stage the host was restored in, without
+     *         timing it as its start was not seen
+     *
+     * @param[in] current - The current stage
+     */
+    void resume(ProgressStages current);
+
+    /** @brief Handle a change of the BootProgress
+     *
+     * Ends the timing of the previous stage, and of the IPL once the OS is
+     * started. A stage which was not seen starting, e.g. as the BMC was
+     * reset during it, is not timed. Unspecified ends the boot.
+     *
+     * @param[in] stage - The new stage
+     * @param[in] now   - The time of the change
+     *
+     * @return If the statistics changed
+     */
+    bool progress(ProgressStages stage, Clock::time_point now = Clock::now());
+
+    /** @brief Get the statistics of each stage, by stage name */
+    std::map<std::string, Record> stages() const;
+
+    /** @brief Get the statistics of the IPL, from the first stage until the
+     *         OS is started */
+    Record ipl() const;
+
+    /** @brief Weight of the newest duration in the average */
+    static constexpr double averageWeight = 0.25;
+
+  private:
+    /** @brief Persist the statistics */
+    void store() const;
+
+    /** @brief Load the persisted statistics */
+    void load();
+
+    /** @brief The file the statistics are persisted in */
+    const fs::path path;
+
+    /** @brief The statistics of each stage, by stage name */
+    std::map<std::string, Stats> stageStats;
+
+    /** @brief The statistics of the IPL */
+    Stats iplStats;
+
+    /** @brief The stage in progress */
+    ProgressStages stage = ProgressStages::Unspecified;
+
+    /** @brief When the stage in progress started, if it was seen */
+    std::optional<Clock::time_point> stageStart;
+
+    /** @brief When the IPL in progress started, if it was seen */
+    std::optional<Clock::time_point> iplStart;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
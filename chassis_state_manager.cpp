@@ -50,6 +50,11 @@ constexpr auto CHASSIS_STATE_POWERCYCLE_TGT_FMT =
     "obmc-chassis-powercycle@{}.target";
 constexpr auto AUTO_POWER_RESTORE_SVC_FMT =
     "phosphor-discover-system-state@{}.service";
+constexpr auto CHASSIS_POWER_START_SVC_FMT = "obmc-power-start@{}.service";
+constexpr auto CHASSIS_POWERON_STARTED_MSG =
+    "xyz.openbmc_project.State.Info.ChassisPowerOnStarted";
+constexpr auto CHASSIS_POWERON_FAILURE_MSG =
+    "xyz.openbmc_project.State.Chassis.Error.PowerOnFailure";
 constexpr auto ACTIVE_STATE = "active";
 constexpr auto ACTIVATING_STATE = "activating";
 
@@ -72,6 +77,7 @@ constexpr auto UPOWER_INTERFACE = "org.freedesktop.UPower.Device";
 constexpr auto POWERSYSINPUTS_INTERFACE =
     "xyz.openbmc_project.State.Decorator.PowerSystemInputs";
 constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+constexpr auto POWER_INTERFACE = "org.openbmc.control.Power";
 
 void Chassis::createSystemdTargetTable()
 {
@@ -114,7 +120,7 @@ void Chassis::determineInitialState()
     method.append("org.openbmc.control.Power", "pgood");
     try
     {
-        auto reply = this->bus.call(method);
+        auto reply = utils::call(this->bus, method);
         reply.read(pgood);
 
         if (std::get<int>(pgood) == 1)
@@ -147,12 +153,7 @@ void Chassis::determineInitialState()
 
                     setStateChangeTime();
                     // Generate file indicating AC loss occurred
-                    std::string chassisLostPowerFileFmt =
-                        fmt::sprintf(CHASSIS_LOST_POWER_FILE, id);
-                    fs::create_directories(BASE_FILE_DIR);
-                    fs::path chassisPowerLossFile{chassisLostPowerFileFmt};
-                    std::ofstream outfile(chassisPowerLossFile);
-                    outfile.close();
+                    chassisLostPowerFile.create();
 
                     // 0 indicates pinhole reset. 1 is NOT pinhole reset
                     if (phosphor::state::manager::utils::getGpioValue(
@@ -239,9 +240,13 @@ bool Chassis::determineStatusOfUPSPower()
     std::map<std::string, std::map<std::string, std::vector<std::string>>>
         mapperResponse;
 
+    // The lookup and the reads of all of the objects share one budget
+    utils::Deadline deadline(utils::callTimeout(utils::CallClass::Slow));
+
     try
     {
-        auto mapperResponseMsg = bus.call(mapper);
+        auto mapperResponseMsg =
+            utils::call(bus, mapper, utils::CallClass::Query, &deadline);
         mapperResponseMsg.read(mapperResponse);
     }
     catch (const sdbusplus::exception_t& e)
@@ -268,7 +273,8 @@ bool Chassis::determineStatusOfUPSPower()
                                                   PROPERTY_INTERFACE, "GetAll");
                 method.append(UPOWER_INTERFACE);
 
-                auto response = bus.call(method);
+                auto response = utils::call(bus, method,
+                                            utils::CallClass::Query, &deadline);
                 using Property = std::string;
                 using Value = std::variant<bool, uint>;
                 using PropertyMap = std::map<Property, Value>;
@@ -345,9 +351,13 @@ bool Chassis::determineStatusOfPSUPower()
     std::map<std::string, std::map<std::string, std::vector<std::string>>>
         mapperResponse;
 
+    // The lookup and the reads of all of the objects share one budget
+    utils::Deadline deadline(utils::callTimeout(utils::CallClass::Slow));
+
     try
     {
-        auto mapperResponseMsg = bus.call(mapper);
+        auto mapperResponseMsg =
+            utils::call(bus, mapper, utils::CallClass::Query, &deadline);
         mapperResponseMsg.read(mapperResponse);
     }
     catch (const sdbusplus::exception_t& e)
@@ -369,7 +379,8 @@ bool Chassis::determineStatusOfPSUPower()
                                                   PROPERTY_INTERFACE, "GetAll");
                 method.append(POWERSYSINPUTS_INTERFACE);
 
-                auto response = bus.call(method);
+                auto response = utils::call(bus, method,
+                                            utils::CallClass::Query, &deadline);
                 using Property = std::string;
                 using Value = std::variant<std::string>;
                 using PropertyMap = std::map<Property, Value>;
@@ -474,7 +485,7 @@ void Chassis::startUnit(const std::string& sysdUnit)
     method.append(sysdUnit);
     method.append("replace");
 
-    this->bus.call_noreply(method);
+    utils::call(this->bus, method, utils::CallClass::Control);
 
     return;
 }
@@ -487,7 +498,7 @@ void Chassis::restartUnit(const std::string& sysdUnit)
     method.append(sysdUnit);
     method.append("replace");
 
-    this->bus.call_noreply(method);
+    utils::call(this->bus, method, utils::CallClass::Control);
 
     return;
 }
@@ -497,6 +508,8 @@ bool Chassis::stateActive(const std::string& target)
     std::variant<std::string> currentState;
     sdbusplus::message::object_path unitTargetPath;
 
+    // The initial state is read while systemd is busy starting the BMC's
+    // units, so each call is given the time of a slow call
     auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
                                             SYSTEMD_INTERFACE, "GetUnit");
 
@@ -504,7 +517,7 @@ bool Chassis::stateActive(const std::string& target)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = utils::call(this->bus, method, utils::CallClass::Slow);
         result.read(unitTargetPath);
     }
     catch (const sdbusplus::exception_t& e)
@@ -522,7 +535,7 @@ bool Chassis::stateActive(const std::string& target)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = utils::call(this->bus, method, utils::CallClass::Slow);
         result.read(currentState);
     }
     catch (const sdbusplus::exception_t& e)
@@ -578,17 +591,159 @@ int Chassis::sysStateChange(sdbusplus::message_t& msg)
         // This file is used to indicate to chassis related systemd services
         // that the chassis is already on and they should skip running.
         // Once the chassis state is back to on we can clear this file.
-        auto size = std::snprintf(nullptr, 0, CHASSIS_ON_FILE, 0);
-        size++; // null
-        std::unique_ptr<char[]> chassisFile(new char[size]);
-        std::snprintf(chassisFile.get(), size, CHASSIS_ON_FILE, 0);
-        if (std::filesystem::exists(chassisFile.get()))
+        chassisOnFile.remove();
+    }
+    else if ((newStateUnit == fmt::format(CHASSIS_POWER_START_SVC_FMT, id)) &&
+             (newStateResult == "done") && (!chassisOnFile.exists()))
+    {
+        // The power on request is made once the ordering of the
+        // obmc-power-start@ marker service is met, e.g. the fans are up
+        startPowerOn();
+    }
+
+    return 0;
+}
+
+void Chassis::sysStateChangeJobNew(sdbusplus::message_t& msg)
+{
+    uint32_t newStateID{};
+    sdbusplus::message::object_path newStateObjPath;
+    std::string newStateUnit{};
+
+    // Read the msg and populate each variable
+    msg.read(newStateID, newStateObjPath, newStateUnit);
+
+    if ((newStateUnit == systemdTargetTable[Transition::On]) &&
+        (!chassisOnFile.exists()))
+    {
+        // The power on may not have been requested through this object,
+        // e.g. by the host start target, so it is stopped here. Starting
+        // the poweroff target flushes the queued power on jobs, as its
+        // OnFailure did when the power status was checked by a service.
+        if (!checkPowerStatus())
         {
-            std::filesystem::remove(chassisFile.get());
+            powerOff();
+            return;
+        }
+
+        info("Received signal that power ON has started");
+        try
+        {
+            utils::createError(this->bus, CHASSIS_POWERON_STARTED_MSG,
+                               sdbusplus::xyz::openbmc_project::Logging::
+                                   server::Entry::Level::Informational,
+                               {{"CHASSIS_ID", std::to_string(id)}});
+        }
+        catch (const std::exception& e)
+        {
+            error("Failed to create chassis power on log: {ERROR}", "ERROR",
+                  e);
         }
     }
+}
 
-    return 0;
+void Chassis::powerOff()
+{
+    try
+    {
+        startUnit(fmt::format(CHASSIS_STATE_POWEROFF_TGT_FMT, id));
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Failed to power off chassis {ID}: {ERROR}", "ID", id, "ERROR",
+              e);
+    }
+}
+
+bool Chassis::checkPowerStatus()
+{
+    auto powerStatus = server::Chassis::currentPowerStatus();
+    if (powerStatus == PowerStatus::Good)
+    {
+        return true;
+    }
+
+    error("Chassis power status is not good: {CURRENT_PWR_STATUS}",
+          "CURRENT_PWR_STATUS", powerStatus);
+
+    // Generate log telling user why system is not powering on
+    try
+    {
+        utils::createError(
+            this->bus, "xyz.openbmc_project.State.ChassisPowerBad",
+            sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level::
+                Critical);
+    }
+    catch (const std::exception& e)
+    {
+        error("Failed to create chassis power bad log: {ERROR}", "ERROR", e);
+    }
+    return false;
+}
+
+void Chassis::startPowerOn()
+{
+    // The power status may have gone bad since the power on was queued
+    if (!checkPowerStatus())
+    {
+        powerOff();
+        return;
+    }
+
+    auto path = fmt::format("/org/openbmc/control/power{}", id);
+    try
+    {
+        // Only look up the power control service once, it is cleared on
+        // failure in case it changed
+        if (powerService.empty())
+        {
+            powerService = utils::getService(bus, path, POWER_INTERFACE);
+        }
+
+        auto method = bus.new_method_call(powerService.c_str(), path.c_str(),
+                                          POWER_INTERFACE, "setPowerState");
+        method.append(1);
+        powerOnCall = bus.call_async(
+            method,
+            [this](sdbusplus::message_t reply) { powerOnDone(reply); },
+            utils::callTimeout(utils::CallClass::Control).count());
+    }
+    catch (const std::exception& e)
+    {
+        powerService.clear();
+        powerOnFailed(e.what());
+    }
+}
+
+void Chassis::powerOnDone(sdbusplus::message_t& reply)
+{
+    if (reply.is_method_error())
+    {
+        powerService.clear();
+        powerOnFailed(reply.get_error()->name);
+    }
+}
+
+void Chassis::powerOnFailed(const std::string& reason)
+{
+    error("Failed to request chassis {ID} power on: {ERROR}", "ID", id,
+          "ERROR", reason);
+
+    try
+    {
+        utils::createError(this->bus, CHASSIS_POWERON_FAILURE_MSG,
+                           sdbusplus::xyz::openbmc_project::Logging::server::
+                               Entry::Level::Critical,
+                           {{"CHASSIS_ID", std::to_string(id)},
+                            {"ERROR", reason}});
+    }
+    catch (const std::exception& e)
+    {
+        error("Failed to create chassis power on failure log: {ERROR}",
+              "ERROR", e);
+    }
+
+    powerOff();
 }
 
 Chassis::Transition Chassis::requestedPowerTransition(Transition value)
@@ -603,6 +758,10 @@ Chassis::Transition Chassis::requestedPowerTransition(Transition value)
             BMCNotReady();
     }
 #endif
+    if ((value != Transition::Off) && (!checkPowerStatus()))
+    {
+        throw sdbusplus::xyz::openbmc_project::Common::Error::NotAllowed();
+    }
     startUnit(systemdTargetTable.find(value)->second);
     return server::Chassis::requestedPowerTransition(value);
 }
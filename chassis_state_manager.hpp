@@ -2,6 +2,7 @@
 
 #include "config.h"
 
+#include "marker_file.hpp"
 #include "utils.hpp"
 #include "xyz/openbmc_project/State/Chassis/server.hpp"
 #include "xyz/openbmc_project/State/PowerOnHours/server.hpp"
@@ -14,6 +15,8 @@
 
 #include <chrono>
 #include <filesystem>
+#include <optional>
+#include <string>
 
 namespace phosphor
 {
@@ -55,7 +58,14 @@ class Chassis : public ChassisInherit
                 sdbusRule::path("/org/freedesktop/systemd1") +
                 sdbusRule::interface("org.freedesktop.systemd1.Manager"),
             [this](sdbusplus::message_t& m) { sysStateChange(m); }),
-        id(id),
+        systemdSignalJobNew(
+            bus,
+            sdbusRule::type::signal() + sdbusRule::member("JobNew") +
+                sdbusRule::path("/org/freedesktop/systemd1") +
+                sdbusRule::interface("org.freedesktop.systemd1.Manager"),
+            [this](sdbusplus::message_t& m) { sysStateChangeJobNew(m); }),
+        id(id), chassisOnFile(CHASSIS_ON_FILE, id),
+        chassisLostPowerFile(CHASSIS_LOST_POWER_FILE, id),
         pohTimer(
             sdeventplus::Event::get_default(), [this](auto&) { pohCallback(); },
             std::chrono::hours{1}, std::chrono::minutes{1})
@@ -76,7 +86,11 @@ class Chassis : public ChassisInherit
         this->emit_object_added();
     }
 
-    /** @brief Set value of RequestedPowerTransition */
+    /** @brief Set value of RequestedPowerTransition
+     *
+     * Requests which power on the chassis are rejected with NotAllowed
+     * while the power status is not good.
+     */
     Transition requestedPowerTransition(Transition value) override;
 
     /** @brief Set value of CurrentPowerState */
@@ -88,6 +102,32 @@ class Chassis : public ChassisInherit
     /** @brief Increment POHCounter if Chassis Power state is ON */
     void startPOHCounter();
 
+    /** @brief Check if JobNew systemd signal is relevant to this object
+     *
+     * Performs the actions of the chassis power on path when its targets
+     * are queued, rather than forking a service for each of them. A power
+     * on queued while the power status is not good is stopped by starting
+     * the poweroff target.
+     *
+     * @note This is public for unit testing purposes
+     *
+     * @param[in]  msg       - Data associated with subscribed signal
+     *
+     */
+    void sysStateChangeJobNew(sdbusplus::message_t& msg);
+
+    /** @brief Check if systemd state change is relevant to this object
+     *
+     * Instance specific interface to handle the detected systemd state
+     * change
+     *
+     * @note This is public for unit testing purposes
+     *
+     * @param[in]  msg       - Data associated with subscribed signal
+     *
+     */
+    int sysStateChange(sdbusplus::message_t& msg);
+
   private:
     /** @brief Create systemd target instance names and mapping table */
     void createSystemdTargetTable();
@@ -143,15 +183,40 @@ class Chassis : public ChassisInherit
      **/
     bool stateActive(const std::string& target);
 
-    /** @brief Check if systemd state change is relevant to this object
+    /** @brief Request the power control service to power on the chassis
      *
-     * Instance specific interface to handle the detected systemd state
-     * change
+     * The request is sent without waiting for its reply, which is handled
+     * by powerOnDone(). The chassis is powered off instead if the power
+     * status is not good.
+     */
+    void startPowerOn();
+
+    /** @brief Handle the reply to the power on request
      *
-     * @param[in]  msg       - Data associated with subscribed signal
+     * @param[in] reply - The method reply
+     */
+    void powerOnDone(sdbusplus::message_t& reply);
+
+    /** @brief Log a failed power on and power the chassis off again, so the
+     *         power on target doesn't wait for a power good which won't come
      *
+     * @param[in] reason - Why the power on failed
      */
-    int sysStateChange(sdbusplus::message_t& msg);
+    void powerOnFailed(const std::string& reason);
+
+    /** @brief Start the poweroff target, which also flushes the queued
+     *         power on jobs
+     */
+    void powerOff();
+
+    /** @brief Check the power status allows the chassis to be powered on
+     *
+     * Logs an error telling the user why the system is not powering on if
+     * it does not.
+     *
+     * @return true if the power status is good
+     */
+    bool checkPowerStatus();
 
     /** @brief Persistent sdbusplus DBus connection. */
     sdbusplus::bus_t& bus;
@@ -159,15 +224,31 @@ class Chassis : public ChassisInherit
     /** @brief Used to subscribe to dbus systemd signals **/
     sdbusplus::bus::match_t systemdSignals;
 
+    /** @brief Used to subscribe to dbus systemd JobNew signal **/
+    sdbusplus::bus::match_t systemdSignalJobNew;
+
     /** @brief Watch for any changes to UPS properties **/
     std::unique_ptr<sdbusplus::bus::match_t> uPowerPropChangeSignal;
 
     /** @brief Watch for any changes to PowerSystemInputs properties **/
     std::unique_ptr<sdbusplus::bus::match_t> powerSysInputsPropChangeSignal;
 
+    /** @brief Power control service, looked up on first use **/
+    std::string powerService;
+
+    /** @brief Outstanding setPowerState call **/
+    std::optional<sdbusplus::slot_t> powerOnCall;
+
     /** @brief Chassis id. **/
     const size_t id = 0;
 
+    /** @brief File indicating to the chassis services that the chassis was
+     *         already on when the BMC was reset **/
+    const MarkerFile chassisOnFile;
+
+    /** @brief File indicating the chassis lost power while it was on **/
+    const MarkerFile chassisLostPowerFile;
+
     /** @brief Transition state to systemd target mapping table. **/
     std::map<Transition, std::string> systemdTargetTable;
 
@@ -0,0 +1,71 @@
+#include "crash_loop.hpp"
+
+#include <algorithm>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+uint64_t CrashLoop::currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t CrashLoop::windowStart(uint64_t now) const
+{
+    auto window = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      limits.window)
+                      .count();
+    return now - std::min<uint64_t>(now, window);
+}
+
+void CrashLoop::record(uint64_t now)
+{
+    auto start = windowStart(now);
+
+    // Drop the crashes which aged out, or are from before a clock change
+    std::erase_if(crashTimes, [now, start](auto time) {
+        return (time < start) || (time > now);
+    });
+    crashTimes.push_back(now);
+    while (crashTimes.size() > limits.maxCrashes)
+    {
+        crashTimes.pop_front();
+    }
+}
+
+uint32_t CrashLoop::inWindow(uint64_t now) const
+{
+    auto start = windowStart(now);
+
+    return std::count_if(crashTimes.begin(), crashTimes.end(),
+                         [now, start](auto time) {
+        return (time >= start) && (time <= now);
+    });
+}
+
+uint64_t CrashLoop::rebootDelay(uint64_t now) const
+{
+    auto crashes = inWindow(now);
+    if (crashes < 2)
+    {
+        return 0;
+    }
+
+    uint64_t delay = limits.backoff.count();
+    uint64_t maxDelay = limits.maxBackoff.count();
+    for (uint32_t crash = 2; (crash < crashes) && (delay < maxDelay); crash++)
+    {
+        delay *= 2;
+    }
+    return std::min(delay, maxDelay);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
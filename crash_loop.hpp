@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cereal/types/deque.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class CrashLoop
+ *  @brief Keeps the times a host crashed within a window, to back off the
+ *         automatic reboots of a host which keeps crashing
+ *
+ * The times are in milliseconds since epoch, so they can be persisted
+ * across BMC reboots.
+ */
+class CrashLoop
+{
+  public:
+    /** @brief The limits of the crash loop backoff */
+    struct Limits
+    {
+        /** @brief How long a crash counts */
+        std::chrono::seconds window;
+
+        /** @brief The delay of the reboot after the second crash */
+        std::chrono::seconds backoff;
+
+        /** @brief The longest delay of a reboot */
+        std::chrono::seconds maxBackoff;
+
+        /** @brief The most crash times kept */
+        size_t maxCrashes;
+    };
+
+    /** @brief Constructor
+     *
+     * @param[in] limits - The limits of the backoff
+     */
+    explicit CrashLoop(const Limits& limits) : limits(limits) {}
+
+    /** @brief Get the current time, in milliseconds since epoch */
+    static uint64_t currentTime();
+
+    /** @brief Record a crash
+     *
+     * The crashes which aged out of the window are dropped, as are those
+     * after the crash, which are from before the clock was set back.
+     *
+     * @param[in] now - The time of the crash
+     */
+    void record(uint64_t now = currentTime());
+
+    /** @brief Get the number of crashes within the window
+     *
+     * @param[in] now - The current time
+     */
+    uint32_t inWindow(uint64_t now = currentTime()) const;
+
+    /** @brief Get the delay of the next automatic reboot
+     *
+     * The first crash within the window reboots right away, each further
+     * crash doubles the delay from the backoff up to the max backoff.
+     *
+     * @param[in] now - The current time
+     *
+     * @return The delay in seconds
+     */
+    uint64_t rebootDelay(uint64_t now = currentTime()) const;
+
+    /** @brief Get the time of the last crash, 0 if there was none */
+    uint64_t lastCrash() const
+    {
+        return crashTimes.empty() ? 0 : crashTimes.back();
+    }
+
+    /** @brief The limits of the backoff */
+    const Limits limits;
+
+    /** @brief Function required by Cereal to perform serialization.
+     *
+     *  @tparam Archive - Cereal archive type
+     *  @param[in] archive - reference to Cereal archive.
+     */
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(crashTimes);
+    }
+
+  private:
+    /** @brief Get the start of the window */
+    uint64_t windowStart(uint64_t now) const;
+
+    /** @brief The crash times, oldest first */
+    std::deque<uint64_t> crashTimes;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
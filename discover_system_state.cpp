@@ -114,7 +114,7 @@ int main(int argc, char** argv)
     std::variant<std::string> result;
     try
     {
-        auto reply = bus.call(methodOneTime);
+        auto reply = phosphor::state::manager::utils::call(bus, methodOneTime);
         reply.read(result);
         auto powerPolicy = std::get<std::string>(result);
 
@@ -124,7 +124,8 @@ int main(int argc, char** argv)
             // one_time is set to None so use the customer setting
             info("One time not set, check user setting of power policy");
 
-            auto reply = bus.call(methodUserSetting);
+            auto reply =
+                phosphor::state::manager::utils::call(bus, methodUserSetting);
             reply.read(result);
             powerPolicy = std::get<std::string>(result);
         }
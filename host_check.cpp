@@ -2,6 +2,9 @@
 
 #include "host_check.hpp"
 
+#include "marker_file.hpp"
+#include "utils.hpp"
+
 #include <unistd.h>
 
 #include <boost/range/adaptor/reversed.hpp>
@@ -58,9 +61,13 @@ bool checkFirmwareConditionRunning(sdbusplus::bus_t& bus)
     std::map<std::string, std::map<std::string, std::vector<std::string>>>
         mapperResponse;
 
+    // The lookup and the reads of all of the conditions share one budget
+    utils::Deadline deadline(utils::callTimeout(utils::CallClass::Slow));
+
     try
     {
-        auto mapperResponseMsg = bus.call(mapper);
+        auto mapperResponseMsg =
+            utils::call(bus, mapper, utils::CallClass::Query, &deadline);
         mapperResponseMsg.read(mapperResponse);
     }
     catch (const sdbusplus::exception_t& e)
@@ -100,7 +107,8 @@ bool checkFirmwareConditionRunning(sdbusplus::bus_t& bus)
                 method.append(CONDITION_HOST_INTERFACE,
                               CONDITION_HOST_PROPERTY);
 
-                auto response = bus.call(method);
+                auto response = utils::call(bus, method,
+                                            utils::CallClass::Query, &deadline);
                 std::variant<FirmwareCondition> currentFwCondV;
                 response.read(currentFwCondV);
                 auto currentFwCond =
@@ -142,7 +150,7 @@ bool isChassiPowerOn(sdbusplus::bus_t& bus, size_t id)
                                           PROPERTY_INTERFACE, "Get");
         method.append(CHASSIS_STATE_INTF, CHASSIS_STATE_POWER_PROP);
 
-        auto response = bus.call(method);
+        auto response = utils::call(bus, method);
         std::variant<PowerState> currentPowerStateV;
         response.read(currentPowerStateV);
 
@@ -198,12 +206,7 @@ bool isHostRunning(size_t id)
             info("Host is running!");
             // Create file for host instance and create in filesystem to
             // indicate to services that host is running
-            auto size = std::snprintf(nullptr, 0, HOST_RUNNING_FILE, 0);
-            size++; // null
-            std::unique_ptr<char[]> buf(new char[size]);
-            std::snprintf(buf.get(), size, HOST_RUNNING_FILE, 0);
-            std::ofstream outfile(buf.get());
-            outfile.close();
+            MarkerFile(HOST_RUNNING_FILE, id).create();
             return true;
         }
     }
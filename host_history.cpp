@@ -0,0 +1,184 @@
+#include "host_history.hpp"
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cereal/types/vector.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <fstream>
+#include <optional>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+namespace server = sdbusplus::xyz::openbmc_project::State::server;
+namespace bootprogress = sdbusplus::xyz::openbmc_project::State::Boot::server;
+namespace osstatus =
+    sdbusplus::xyz::openbmc_project::State::OperatingSystem::server;
+
+// Bump when the persisted format changes, older files are dropped
+constexpr uint32_t historyVersion = 1;
+
+namespace
+{
+
+/** @brief The enum value without its interface prefix, e.g. Running, to
+ *         keep the persisted file small */
+template <typename Enum>
+std::string shortName(Enum value)
+{
+    auto name = convertForMessage(value);
+    return name.substr(name.rfind('.') + 1);
+}
+
+template <typename Enum, typename Convert>
+std::optional<Enum> fromShortName(const std::string& name, Convert convert)
+{
+    auto prefix = convertForMessage(Enum{});
+    prefix.erase(prefix.rfind('.') + 1);
+    return convert(prefix + name);
+}
+
+} // namespace
+
+HostHistory::HostHistory(const fs::path& path) : path(path)
+{
+    load();
+}
+
+bool HostHistory::add(const Entry& entry)
+{
+    if ((count != 0) && at(count - 1).sameStates(entry))
+    {
+        return false;
+    }
+
+    if (count < capacity)
+    {
+        entries[(first + count) % capacity] = entry;
+        count++;
+    }
+    else
+    {
+        entries[first] = entry;
+        first = (first + 1) % capacity;
+    }
+
+    store();
+    return true;
+}
+
+std::vector<HostHistory::Record> HostHistory::get(uint64_t since) const
+{
+    std::vector<Record> records;
+    records.reserve(count);
+
+    for (size_t index = 0; index < count; index++)
+    {
+        const auto& entry = at(index);
+        if (entry.time > since)
+        {
+            records.emplace_back(entry.time, convertForMessage(entry.hostState),
+                                 convertForMessage(entry.bootProgress),
+                                 convertForMessage(entry.osState),
+                                 convertForMessage(entry.restartCause));
+        }
+    }
+    return records;
+}
+
+void HostHistory::store() const
+{
+    std::vector<Record> records;
+    records.reserve(count);
+
+    for (size_t index = 0; index < count; index++)
+    {
+        const auto& entry = at(index);
+        records.emplace_back(entry.time, shortName(entry.hostState),
+                             shortName(entry.bootProgress),
+                             shortName(entry.osState),
+                             shortName(entry.restartCause));
+    }
+
+    std::ofstream os(path.c_str(), std::ios::binary);
+    cereal::BinaryOutputArchive oarchive(os);
+    oarchive(historyVersion, records);
+    if (!os)
+    {
+        error("Failed to write host history to {PATH}", "PATH",
+              path.string());
+    }
+}
+
+void HostHistory::load()
+{
+    if (!fs::exists(path))
+    {
+        return;
+    }
+
+    std::vector<Record> records;
+    try
+    {
+        std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+        cereal::BinaryInputArchive iarchive(is);
+
+        uint32_t version = 0;
+        iarchive(version);
+        if (version != historyVersion)
+        {
+            info("Dropping host history of version {VERSION}", "VERSION",
+                 version);
+            fs::remove(path);
+            return;
+        }
+        iarchive(records);
+    }
+    catch (const std::exception& e)
+    {
+        // A corrupt size may fail to allocate rather than fail to read
+        error("Failed to load host history: {ERROR}", "ERROR", e);
+        fs::remove(path);
+        return;
+    }
+
+    // Keep the newest entries if the history was bigger in an older build
+    auto skip = (records.size() > capacity) ? (records.size() - capacity) : 0;
+    for (size_t index = skip; index < records.size(); index++)
+    {
+        const auto& [time, hostState, bootProgress, osState, restartCause] =
+            records[index];
+
+        auto host = fromShortName<HostState>(
+            hostState, server::Host::convertStringToHostState);
+        auto progress = fromShortName<ProgressStages>(
+            bootProgress,
+            bootprogress::Progress::convertStringToProgressStages);
+        auto os = fromShortName<OSStatus>(
+            osState, osstatus::Status::convertStringToOSStatus);
+        auto cause = fromShortName<RestartCause>(
+            restartCause, server::Host::convertStringToRestartCause);
+
+        // Values may have been dropped from the interfaces since
+        if (!host || !progress || !os || !cause)
+        {
+            continue;
+        }
+
+        entries[count] = {time, *host, *progress, *os, *cause};
+        count++;
+    }
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "config.h"
+
+#include <xyz/openbmc_project/State/Boot/Progress/server.hpp>
+#include <xyz/openbmc_project/State/Host/server.hpp>
+#include <xyz/openbmc_project/State/OperatingSystem/Status/server.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+namespace fs = std::filesystem;
+
+/** @class HostHistory
+ *  @brief The last state transitions of a host, kept in a fixed size ring
+ *         buffer which is mirrored to a persisted file
+ */
+class HostHistory
+{
+  public:
+    using HostState =
+        sdbusplus::xyz::openbmc_project::State::server::Host::HostState;
+    using RestartCause =
+        sdbusplus::xyz::openbmc_project::State::server::Host::RestartCause;
+    using ProgressStages = sdbusplus::xyz::openbmc_project::State::Boot::
+        server::Progress::ProgressStages;
+    using OSStatus = sdbusplus::xyz::openbmc_project::State::OperatingSystem::
+        server::Status::OSStatus;
+
+    /** @brief The states of the host after a transition */
+    struct Entry
+    {
+        /** @brief Milliseconds since epoch of the transition */
+        uint64_t time = 0;
+        HostState hostState = HostState::Off;
+        ProgressStages bootProgress = ProgressStages::Unspecified;
+        OSStatus osState = OSStatus::Inactive;
+        RestartCause restartCause = RestartCause::Unknown;
+
+        /** @brief Check if the states, not the time, are the same */
+        bool sameStates(const Entry& other) const
+        {
+            return std::tie(hostState, bootProgress, osState, restartCause) ==
+                   std::tie(other.hostState, other.bootProgress,
+                            other.osState, other.restartCause);
+        }
+    };
+
+    /** @brief An entry as sent on D-Bus: time, CurrentHostState,
+     *         BootProgress, OperatingSystemState and RestartCause */
+    using Record = std::tuple<uint64_t, std::string, std::string, std::string,
+                              std::string>;
+
+    /** @brief Constructor, loads the persisted history
+     *
+     * @param[in] path - The file the history is persisted in
+     */
+    explicit HostHistory(const fs::path& path);
+
+    /** @brief Add a transition, unless the states did not change,
+     *         replacing the oldest one once full, and persist the history
+     *
+     * @param[in] entry - The states after the transition
+     *
+     * @return If the entry was added
+     */
+    bool add(const Entry& entry);
+
+    /** @brief Get the transitions, oldest first
+     *
+     * @param[in] since - Only get the transitions after this time, in
+     *                    milliseconds since epoch
+     */
+    std::vector<Record> get(uint64_t since) const;
+
+    /** @brief The number of transitions kept */
+    size_t size() const
+    {
+        return count;
+    }
+
+    /** @brief The maximum number of transitions kept */
+    static constexpr size_t capacity = HOST_HISTORY_SIZE;
+
+  private:
+    /** @brief Get an entry by age, 0 is the oldest */
+    const Entry& at(size_t index) const
+    {
+        return entries[(first + index) % capacity];
+    }
+
+    /** @brief Persist the history */
+    void store() const;
+
+    /** @brief Load the persisted history, dropping it if it is invalid */
+    void load();
+
+    /** @brief The file the history is persisted in */
+    const fs::path path;
+
+    /** @brief The ring buffer, preallocated to its full size */
+    std::array<Entry, capacity> entries{};
+
+    /** @brief Index of the oldest entry */
+    size_t first = 0;
+
+    /** @brief Number of valid entries */
+    size_t count = 0;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "config.h"
+
+#include "crash_loop.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @brief Version of the persisted host state
+ *
+ *  1 - The requested transition, boot progress and OS state
+ *  2 - The reboot attempts left, ahead of the version 1 fields
+ *  3 - The crash times, ahead of the version 2 fields
+ */
+constexpr std::uint32_t hostPersistVersion = 3;
+
+/** @brief The persisted state of a host, other than its crash times
+ *
+ *  The enums are kept as their D-Bus strings, so they can be read back
+ *  after the enum values change.
+ */
+struct HostPersist
+{
+    /** @brief Auto reboot attempts left, all of them if not persisted */
+    uint32_t retryAttempts = BOOT_COUNT_MAX_ALLOWED;
+
+    /** @brief RequestedHostTransition */
+    std::string requestedTransition;
+
+    /** @brief BootProgress */
+    std::string bootProgress;
+
+    /** @brief OperatingSystemState */
+    std::string osState;
+
+    /** @brief Archive the fields with the crash times, as hostPersistVersion
+     *
+     *  @tparam Archive - Cereal archive type
+     *  @param[in] archive - reference to Cereal archive.
+     *  @param[in] crashLoop - The crash times of the host
+     */
+    template <class Archive>
+    void write(Archive& archive, const CrashLoop& crashLoop) const
+    {
+        archive(crashLoop, retryAttempts, requestedTransition, bootProgress,
+                osState);
+    }
+
+    /** @brief Read the fields and crash times archived by any version
+     *
+     *  @tparam Archive - Cereal archive type
+     *  @param[in] archive - reference to Cereal archive.
+     *  @param[in] version - The version the fields were archived with
+     *  @param[out] crashLoop - The crash times of the host, left alone by
+     *                          versions without them
+     */
+    template <class Archive>
+    void read(Archive& archive, std::uint32_t version, CrashLoop& crashLoop)
+    {
+        switch (version)
+        {
+            case 3:
+                archive(crashLoop);
+                [[fallthrough]];
+            case 2:
+                archive(retryAttempts);
+                [[fallthrough]];
+            case 1:
+                archive(requestedTransition, bootProgress, osState);
+                break;
+        }
+    }
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
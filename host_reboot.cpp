@@ -0,0 +1,229 @@
+#include "config.h"
+
+#include "utils.hpp"
+
+#include <getopt.h>
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/message.hpp>
+#include <xyz/openbmc_project/State/Host/server.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+using namespace std::literals::chrono_literals;
+using RestartCause =
+    sdbusplus::xyz::openbmc_project::State::server::Host::RestartCause;
+namespace sdbusRule = sdbusplus::bus::match::rules;
+
+constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
+constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
+constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
+constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+constexpr auto HOST_INTERFACE = "xyz.openbmc_project.State.Host";
+constexpr auto REBOOT_ATTEMPTS_INTERFACE =
+    "xyz.openbmc_project.Control.Boot.RebootAttempts";
+
+// The shutdown path normally completes well within this, it only bounds the
+// wait if a job is stuck so the host is not left off forever
+constexpr auto shutdownTimeout = 60s;
+
+using Job = std::tuple<uint32_t, std::string, std::string, std::string,
+                       sdbusplus::message::object_path,
+                       sdbusplus::message::object_path>;
+
+std::string getHostTarget(const std::string& name, size_t id)
+{
+    return "obmc-host-" + name + "@" + std::to_string(id) + ".target";
+}
+
+/** @brief Get the ids of the queued jobs of the given units */
+std::set<uint32_t> getPendingJobs(sdbusplus::bus_t& bus,
+                                  const std::set<std::string>& units)
+{
+    auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
+                                      SYSTEMD_INTERFACE, "ListJobs");
+
+    std::vector<Job> jobs;
+    auto reply = bus.call(method);
+    reply.read(jobs);
+
+    std::set<uint32_t> pending;
+    for (const auto& [jobId, unit, type, state, jobPath, unitPath] : jobs)
+    {
+        if (units.contains(unit))
+        {
+            debug("Waiting for {UNIT} {TYPE} job {JOB_ID}", "UNIT", unit,
+                  "TYPE", type, "JOB_ID", jobId);
+            pending.insert(jobId);
+        }
+    }
+    return pending;
+}
+
+/** @brief Wait for the jobs of the host shutdown path to be removed
+ *
+ * Starting the boot (or quiesce) target while these jobs are still queued
+ * would cancel them, as the targets conflict.
+ */
+void waitForShutdown(sdbusplus::bus_t& bus, size_t id)
+{
+    std::set<uint32_t> pending;
+
+    // Subscribe before listing the jobs so no removal can be missed
+    sdbusplus::bus::match_t jobRemoved(
+        bus,
+        sdbusRule::type::signal() + sdbusRule::member("JobRemoved") +
+            sdbusRule::path(SYSTEMD_OBJ_PATH) +
+            sdbusRule::interface(SYSTEMD_INTERFACE),
+        [&pending](sdbusplus::message_t& msg) {
+        uint32_t jobId{};
+        sdbusplus::message::object_path jobPath;
+        std::string unit;
+        std::string result;
+        msg.read(jobId, jobPath, unit, result);
+
+        if (pending.erase(jobId) != 0)
+        {
+            info("{UNIT} job completed with result {RESULT}", "UNIT", unit,
+                 "RESULT", result);
+        }
+    });
+
+    utils::subscribeToSystemdSignals(bus);
+
+    pending = getPendingJobs(bus, {getHostTarget("stop", id),
+                                   getHostTarget("stopped", id),
+                                   getHostTarget("reboot", id)});
+
+    auto deadline = std::chrono::steady_clock::now() + shutdownTimeout;
+    while (!pending.empty())
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            error("Host{ID} shutdown path did not complete in {TIMEOUT}s, "
+                  "continuing with the reboot",
+                  "ID", id, "TIMEOUT", shutdownTimeout.count());
+            return;
+        }
+
+        bus.wait(std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline - now));
+        while (bus.process_discard())
+        {}
+    }
+}
+
+template <typename T>
+T getHostProperty(sdbusplus::bus_t& bus, size_t id, const char* interface,
+                  const char* property)
+{
+    auto service = std::string{HOST_BUSNAME} + std::to_string(id);
+    auto path = std::string{HOST_OBJPATH} + std::to_string(id);
+
+    auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                      PROPERTY_INTERFACE, "Get");
+    method.append(interface, property);
+
+    std::variant<T> value;
+    auto reply = bus.call(method);
+    reply.read(value);
+    return std::get<T>(value);
+}
+
+void startTarget(sdbusplus::bus_t& bus, const std::string& target)
+{
+    auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
+                                      SYSTEMD_INTERFACE, "StartUnit");
+    method.append(target, "replace");
+    bus.call_noreply(method);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
+
+int main(int argc, char** argv)
+{
+    using namespace phosphor::state::manager;
+    PHOSPHOR_LOG2_USING;
+
+    size_t hostId = 0;
+
+    int arg;
+    int optIndex = 0;
+
+    static struct option longOpts[] = {{"host", required_argument, 0, 'h'},
+                                       {0, 0, 0, 0}};
+
+    while ((arg = getopt_long(argc, argv, "h:", longOpts, &optIndex)) != -1)
+    {
+        switch (arg)
+        {
+            case 'h':
+                hostId = std::stoul(optarg);
+                break;
+            default:
+                break;
+        }
+    }
+
+    auto bus = sdbusplus::bus::new_default();
+
+    try
+    {
+        // This runs as a part of the target to reboot the host, so the host
+        // is first shut down, and then booted once that has completed
+        waitForShutdown(bus, hostId);
+
+        // Normally the standard power on path will determine if the system
+        // has reached its reboot count and halt in Quiesce if so. But in the
+        // host-crash path this standard path is not utilized, as it goes only
+        // through systemd targets. To ensure the system does not end up in an
+        // endless reboot loop, put host into Quiesce if reboot count is
+        // exhausted and the reason for the reboot was a HostCrash
+        auto attemptsLeft = getHostProperty<uint32_t>(
+            bus, hostId, REBOOT_ATTEMPTS_INTERFACE, "AttemptsLeft");
+        auto restartCause = getHostProperty<RestartCause>(
+            bus, hostId, HOST_INTERFACE, "RestartCause");
+
+        if ((attemptsLeft == 0) && (restartCause == RestartCause::HostCrash))
+        {
+            info("Reboot count is 0 and host crashed, go to host quiesce");
+            startTarget(bus, getHostTarget("quiesce", hostId));
+        }
+        else
+        {
+            info("Reboot count ({COUNT}) is greater than 0 or host did not "
+                 "crash so reboot host",
+                 "COUNT", attemptsLeft);
+            startTarget(bus, getHostTarget("startmin", hostId));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        error("Failed to reboot host{ID}: {ERROR}", "ID", hostId, "ERROR", e);
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
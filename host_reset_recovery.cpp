@@ -1,5 +1,7 @@
 #include "config.h"
 
+#include "marker_file.hpp"
+
 #include <unistd.h>
 
 #include <phosphor-logging/elog.hpp>
@@ -114,19 +116,6 @@ void createErrorLog(sdbusplus::bus_t& bus)
     }
 }
 
-// Once CHASSIS_ON_FILE is removed, the obmc-chassis-poweron@.target has
-// completed and the phosphor-chassis-state-manager code has processed it.
-bool isChassisTargetComplete()
-{
-    auto size = std::snprintf(nullptr, 0, CHASSIS_ON_FILE, 0);
-    size++; // null
-    std::unique_ptr<char[]> buf(new char[size]);
-    std::snprintf(buf.get(), size, CHASSIS_ON_FILE, 0);
-
-    std::ifstream f(buf.get());
-    return !f.good();
-}
-
 void moveToHostQuiesce(sdbusplus::bus_t& bus)
 {
     try
@@ -181,10 +170,14 @@ int main()
 
     auto bus = sdbusplus::bus::new_default();
 
+    // Once CHASSIS_ON_FILE is removed, the obmc-chassis-poweron@.target has
+    // completed and the phosphor-chassis-state-manager code has processed it.
+    const MarkerFile chassisOnFile(CHASSIS_ON_FILE, 0);
+
     // Chassis power is on if this service starts but need to wait for the
     // obmc-chassis-poweron@.target to complete before potentially initiating
     // another systemd target transition (i.e. Quiesce->Reboot)
-    while (!isChassisTargetComplete())
+    while (chassisOnFile.exists())
     {
         debug("Waiting for chassis on target to complete");
         std::this_thread::sleep_for(std::chrono::seconds(1));
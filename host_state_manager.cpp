@@ -22,14 +22,18 @@
 #include <xyz/openbmc_project/Control/Power/RestorePolicy/server.hpp>
 #include <xyz/openbmc_project/State/Host/error.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
 
-// Register class version with Cereal
-CEREAL_CLASS_VERSION(phosphor::state::manager::Host, CLASS_VERSION)
+// Register class version with Cereal, see host_persist.hpp
+CEREAL_CLASS_VERSION(phosphor::state::manager::Host,
+                     phosphor::state::manager::hostPersistVersion)
 
 namespace phosphor
 {
@@ -60,6 +64,42 @@ constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
 constexpr auto SYSTEMD_PROPERTY_IFACE = "org.freedesktop.DBus.Properties";
 constexpr auto SYSTEMD_INTERFACE_UNIT = "org.freedesktop.systemd1.Unit";
 
+constexpr auto emitsChange = sdbusplus::vtable::property_::emits_change;
+
+const sdbusplus::vtable_t Host::crashLoopVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("CrashWindow", "t", getCrashLoopProperty,
+                                sdbusplus::vtable::property_::const_),
+    sdbusplus::vtable::property("CrashCount", "u", getCrashLoopProperty,
+                                emitsChange),
+    sdbusplus::vtable::property("LastCrashTime", "t", getCrashLoopProperty,
+                                emitsChange),
+    sdbusplus::vtable::property("RebootDelay", "t", getCrashLoopProperty,
+                                emitsChange),
+    sdbusplus::vtable::property("RebootPending", "b", getCrashLoopProperty,
+                                emitsChange),
+    sdbusplus::vtable::end()};
+
+const sdbusplus::vtable_t Host::historyVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method("GetHistory", "t", "a(tssss)", getHistory),
+    sdbusplus::vtable::end()};
+
+const sdbusplus::vtable_t Host::bootTimingVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Stages", "a{s(tttdu)}",
+                                getBootTimingProperty, emitsChange),
+    sdbusplus::vtable::property("IPL", "(tttdu)", getBootTimingProperty,
+                                emitsChange),
+    sdbusplus::vtable::end()};
+
+uint64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
 void Host::determineInitialState()
 {
     if (stateActive(getTarget(server::Host::HostState::Running)) ||
@@ -113,6 +153,8 @@ void Host::createSystemdTargetMaps()
     };
 #endif
     hostCrashTarget = fmt::format("obmc-host-crash@{}.target", id);
+    hostResetTarget = fmt::format("obmc-host-reset@{}.target", id);
+    chassisPowerOffTarget = fmt::format("obmc-chassis-poweroff@{}.target", id);
 }
 
 const std::string& Host::getTarget(HostState state)
@@ -135,7 +177,7 @@ void Host::executeTransition(Transition tranReq)
     method.append(sysdUnit);
     method.append("replace");
 
-    this->bus.call_noreply(method);
+    utils::call(this->bus, method, utils::CallClass::Control);
 
     return;
 }
@@ -145,6 +187,8 @@ bool Host::stateActive(const std::string& target)
     std::variant<std::string> currentState;
     sdbusplus::message::object_path unitTargetPath;
 
+    // The initial state is read while systemd is busy starting the BMC's
+    // units, so each call is given the time of a slow call
     auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
                                             SYSTEMD_INTERFACE, "GetUnit");
 
@@ -152,7 +196,7 @@ bool Host::stateActive(const std::string& target)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = utils::call(this->bus, method, utils::CallClass::Slow);
         result.read(unitTargetPath);
     }
     catch (const sdbusplus::exception_t& e)
@@ -170,7 +214,7 @@ bool Host::stateActive(const std::string& target)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = utils::call(this->bus, method, utils::CallClass::Slow);
         result.read(currentState);
     }
     catch (const sdbusplus::exception_t& e)
@@ -192,23 +236,18 @@ bool Host::isAutoReboot()
      * If this property is true (the default) then look at the persistent
      * user setting in the non one-time object, otherwise honor the one-time
      * setting and do not auto reboot.
+     *
+     * Both settings are normally cached, so no D-Bus calls are made here.
      */
-    auto methodOneTime = bus.new_method_call(
-        settings.service(settings.autoReboot, autoRebootIntf).c_str(),
-        settings.autoRebootOneTime.c_str(), SYSTEMD_PROPERTY_IFACE, "Get");
-    methodOneTime.append(autoRebootIntf, "AutoReboot");
-
-    auto methodUserSetting = bus.new_method_call(
-        settings.service(settings.autoReboot, autoRebootIntf).c_str(),
-        settings.autoReboot.c_str(), SYSTEMD_PROPERTY_IFACE, "Get");
-    methodUserSetting.append(autoRebootIntf, "AutoReboot");
-
     try
     {
-        auto reply = bus.call(methodOneTime);
-        std::variant<bool> result;
-        reply.read(result);
-        auto autoReboot = std::get<bool>(result);
+        // The settings objects may not have been found yet
+        settings.resolve();
+
+        // Reading both settings takes no longer than one query
+        utils::Deadline deadline(utils::callTimeout(utils::CallClass::Query));
+
+        auto autoReboot = autoRebootOneTime.get(&deadline);
 
         if (!autoReboot)
         {
@@ -218,9 +257,7 @@ bool Host::isAutoReboot()
         else
         {
             // one-time is true so read the user setting
-            reply = bus.call(methodUserSetting);
-            reply.read(result);
-            autoReboot = std::get<bool>(result);
+            autoReboot = autoRebootUser.get(&deadline);
         }
 
         auto rebootCounterParam = reboot::RebootAttempts::attemptsLeft();
@@ -267,6 +304,13 @@ bool Host::isAutoReboot()
     }
 }
 
+void Host::watchAutoReboot()
+{
+    // The settings service was (re)started, so read them again
+    autoRebootOneTime.watch(settings.autoRebootOneTime);
+    autoRebootUser.watch(settings.autoReboot);
+}
+
 void Host::sysStateChangeJobRemoved(sdbusplus::message_t& msg)
 {
     uint32_t newStateID{};
@@ -298,14 +342,7 @@ void Host::sysStateChangeJobRemoved(sdbusplus::message_t& msg)
         // This file is used to indicate to host related systemd services
         // that the host is already running and they should skip running.
         // Once the host state is back to running we can clear this file.
-        auto size = std::snprintf(nullptr, 0, HOST_RUNNING_FILE, 0);
-        size++; // null
-        std::unique_ptr<char[]> hostFile(new char[size]);
-        std::snprintf(hostFile.get(), size, HOST_RUNNING_FILE, 0);
-        if (std::filesystem::exists(hostFile.get()))
-        {
-            std::filesystem::remove(hostFile.get());
-        }
+        hostRunningFile.remove();
     }
     else if ((newStateUnit == getTarget(server::Host::HostState::Quiesced)) &&
              (newStateResult == "done") &&
@@ -313,8 +350,22 @@ void Host::sysStateChangeJobRemoved(sdbusplus::message_t& msg)
     {
         if (Host::isAutoReboot())
         {
-            info("Beginning reboot...");
-            Host::requestedHostTransition(server::Host::Transition::Reboot);
+            auto delay = crashLoop.rebootDelay();
+            if (delay == 0)
+            {
+                info("Beginning reboot...");
+                Host::requestedHostTransition(server::Host::Transition::Reboot);
+            }
+            else
+            {
+                info(
+                    "Host crashed {COUNT} times within {WINDOW}s, rebooting in {DELAY}s",
+                    "COUNT", crashLoop.inWindow(), "WINDOW",
+                    crashLoop.limits.window.count(), "DELAY", delay);
+                this->currentHostState(server::Host::HostState::Quiesced);
+                rebootBackoffTimer.restartOnce(std::chrono::seconds(delay));
+                crashLoopInterface->property_changed("RebootPending");
+            }
         }
         else
         {
@@ -322,6 +373,11 @@ void Host::sysStateChangeJobRemoved(sdbusplus::message_t& msg)
             this->currentHostState(server::Host::HostState::Quiesced);
         }
     }
+    else if ((newStateUnit == hostResetTarget) && (newStateResult == "done") &&
+             (!hostRunningFile.exists()))
+    {
+        resetSensorStates();
+    }
 }
 
 void Host::sysStateChangeJobNew(sdbusplus::message_t& msg)
@@ -351,6 +407,51 @@ void Host::sysStateChangeJobNew(sdbusplus::message_t& msg)
         // A host crash can cause a reboot of the host so decrement the reboot
         // count
         decrementRebootCount();
+
+        recordCrash();
+    }
+    else if (newStateUnit == getTarget(server::Host::HostState::Off))
+    {
+        this->currentHostState(server::Host::HostState::TransitioningToOff);
+    }
+    else if ((newStateUnit == getTarget(server::Host::HostState::Running)) &&
+             (!hostRunningFile.exists()))
+    {
+        this->currentHostState(
+            server::Host::HostState::TransitioningToRunning);
+    }
+    else if (newStateUnit == chassisPowerOffTarget)
+    {
+        resetOneTimeAutoReboot();
+    }
+}
+
+void Host::resetSensorStates()
+{
+    info("Resetting sensor states of host {ID}", "ID", id);
+    this->bootProgress(bootprogress::Progress::ProgressStages::Unspecified);
+    this->operatingSystemState(osstatus::Status::OSStatus::Inactive);
+    this->restartCause(server::Host::RestartCause::Unknown);
+}
+
+void Host::resetOneTimeAutoReboot()
+{
+    using namespace settings;
+
+    try
+    {
+        settings.resolve();
+
+        auto method = bus.new_method_call(
+            settings.service(settings.autoRebootOneTime, autoRebootIntf)
+                .c_str(),
+            settings.autoRebootOneTime.c_str(), SYSTEMD_PROPERTY_IFACE, "Set");
+        method.append(autoRebootIntf, "AutoReboot", std::variant<bool>(true));
+        utils::call(bus, method, utils::CallClass::Control);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Error resetting one-time AutoReboot: {ERROR}", "ERROR", e);
     }
 }
 
@@ -364,6 +465,129 @@ uint32_t Host::decrementRebootCount()
     return rebootCount;
 }
 
+void Host::recordCrash()
+{
+    crashLoop.record();
+    serialize();
+
+    crashLoopInterface->property_changed("CrashCount");
+    crashLoopInterface->property_changed("LastCrashTime");
+    crashLoopInterface->property_changed("RebootDelay");
+}
+
+void Host::rebootAfterBackoff()
+{
+    crashLoopInterface->property_changed("RebootPending");
+
+    // Someone may have taken care of the host meanwhile
+    if (server::Host::currentHostState() != server::Host::HostState::Quiesced)
+    {
+        info("Host left quiesce, skipping the delayed reboot");
+        return;
+    }
+
+    info("Beginning delayed reboot...");
+    Host::requestedHostTransition(server::Host::Transition::Reboot);
+}
+
+void Host::cancelRebootBackoff()
+{
+    if (rebootBackoffTimer.isEnabled())
+    {
+        info("Cancelling the delayed reboot of host {ID}", "ID", id);
+        rebootBackoffTimer.setEnabled(false);
+        crashLoopInterface->property_changed("RebootPending");
+    }
+}
+
+int Host::getCrashLoopProperty(sd_bus* /* bus */, const char* /* path */,
+                               const char* /* interface */,
+                               const char* property, sd_bus_message* reply,
+                               void* userdata, sd_bus_error* /* error */)
+{
+    const auto& host = *static_cast<const Host*>(userdata);
+    std::string name{property};
+
+    if (name == "CrashWindow")
+    {
+        return sd_bus_message_append(
+            reply, "t", uint64_t(host.crashLoop.limits.window.count()));
+    }
+    if (name == "CrashCount")
+    {
+        return sd_bus_message_append(reply, "u", host.crashLoop.inWindow());
+    }
+    if (name == "LastCrashTime")
+    {
+        return sd_bus_message_append(reply, "t", host.crashLoop.lastCrash());
+    }
+    if (name == "RebootDelay")
+    {
+        return sd_bus_message_append(reply, "t",
+                                     host.crashLoop.rebootDelay());
+    }
+    return sd_bus_message_append(
+        reply, "b", host.rebootBackoffTimer.isEnabled() ? 1 : 0);
+}
+
+void Host::recordHistory()
+{
+    history.add({nowMs(), server::Host::currentHostState(),
+                 bootprogress::Progress::bootProgress(),
+                 osstatus::Status::operatingSystemState(),
+                 server::Host::restartCause()});
+}
+
+int Host::getHistory(sd_bus_message* msg, void* userdata,
+                     sd_bus_error* /* error */)
+{
+    const auto& host = *static_cast<const Host*>(userdata);
+
+    try
+    {
+        sdbusplus::message_t call{msg};
+        auto since = call.unpack<uint64_t>();
+
+        auto reply = call.new_method_return();
+        reply.append(host.history.get(since));
+        reply.method_return();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Failed to send the host history: {ERROR}", "ERROR", e);
+        return -EIO;
+    }
+    return 1;
+}
+
+int Host::getBootTimingProperty(sd_bus* /* bus */, const char* /* path */,
+                                const char* /* interface */,
+                                const char* property, sd_bus_message* reply,
+                                void* userdata, sd_bus_error* /* error */)
+{
+    const auto& host = *static_cast<const Host*>(userdata);
+
+    try
+    {
+        sdbusplus::message_t msg{reply};
+        if (std::string{property} == "Stages")
+        {
+            msg.append(host.bootTiming.stages());
+        }
+        else
+        {
+            msg.append(host.bootTiming.ipl());
+        }
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Failed to get {PROPERTY}: {ERROR}", "PROPERTY", property,
+              "ERROR", e);
+        return -EIO;
+    }
+    return 1;
+}
+
 fs::path Host::serialize()
 {
     fs::path path{fmt::format(HOST_STATE_PERSIST_PATH, id)};
@@ -408,6 +632,9 @@ Host::Transition Host::requestedHostTransition(Transition value)
     }
 #endif
 
+    // Any request replaces a pending automatic reboot
+    cancelRebootBackoff();
+
     // If this is not a power off request then we need to
     // decrement the reboot counter.  This code should
     // never prevent a power on, it should just decrement
@@ -428,8 +655,15 @@ Host::Transition Host::requestedHostTransition(Transition value)
 
 Host::ProgressStages Host::bootProgress(ProgressStages value)
 {
+    if (bootTiming.progress(value))
+    {
+        bootTimingInterface->property_changed("Stages");
+        bootTimingInterface->property_changed("IPL");
+    }
+
     auto retVal = bootprogress::Progress::bootProgress(value);
     serialize();
+    recordHistory();
     return retVal;
 }
 
@@ -437,13 +671,23 @@ Host::OSStatus Host::operatingSystemState(OSStatus value)
 {
     auto retVal = osstatus::Status::operatingSystemState(value);
     serialize();
+    recordHistory();
     return retVal;
 }
 
 Host::HostState Host::currentHostState(HostState value)
 {
     info("Change to Host State: {STATE}", "STATE", value);
-    return server::Host::currentHostState(value);
+    auto retVal = server::Host::currentHostState(value);
+    recordHistory();
+    return retVal;
+}
+
+Host::RestartCause Host::restartCause(RestartCause value)
+{
+    auto retVal = server::Host::restartCause(value);
+    recordHistory();
+    return retVal;
 }
 
 } // namespace manager
@@ -2,19 +2,32 @@
 
 #include "config.h"
 
+#include "boot_timing.hpp"
+#include "crash_loop.hpp"
+#include "host_persist.hpp"
+#include "host_history.hpp"
+#include "marker_file.hpp"
 #include "settings.hpp"
 #include "utils.hpp"
 #include "xyz/openbmc_project/State/Host/server.hpp"
 
 #include <cereal/access.hpp>
 #include <cereal/cereal.hpp>
+#include <fmt/format.h>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
 #include <xyz/openbmc_project/Control/Boot/RebootAttempts/server.hpp>
 #include <xyz/openbmc_project/State/Boot/Progress/server.hpp>
 #include <xyz/openbmc_project/State/OperatingSystem/Status/server.hpp>
 
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 
 namespace phosphor
@@ -67,7 +80,12 @@ class Host : public HostInherit
                 sdbusRule::path("/org/freedesktop/systemd1") +
                 sdbusRule::interface("org.freedesktop.systemd1.Manager"),
             [this](sdbusplus::message_t& m) { sysStateChangeJobNew(m); }),
-        settings(bus, id), id(id)
+        settings(bus, id, [this]() { watchAutoReboot(); }), id(id),
+        hostRunningFile(HOST_RUNNING_FILE, id),
+        history(fmt::format(HOST_HISTORY_PERSIST_PATH, id)),
+        bootTiming(fmt::format(BOOT_TIMING_PERSIST_PATH, id)),
+        rebootBackoffTimer(sdeventplus::Event::get_default(),
+                           [this](auto&) { rebootAfterBackoff(); })
     {
         // Enable systemd signals
         utils::subscribeToSystemdSignals(bus);
@@ -78,10 +96,25 @@ class Host : public HostInherit
         // Will throw exception on fail
         determineInitialState();
 
+        // The stage the host is in was not seen starting, so is not timed
+        bootTiming.resume(sdbusplus::xyz::openbmc_project::State::Boot::
+                              server::Progress::bootProgress());
+
         // Sets auto-reboot attempts to max-allowed
         attemptsLeft(sdbusplus::xyz::openbmc_project::Control::Boot::server::
                          RebootAttempts::retryAttempts());
 
+        crashLoopInterface = std::make_unique<sdbusplus::server::interface_t>(
+            bus, objPath, crashLoopIntf, crashLoopVtable, this);
+        historyInterface = std::make_unique<sdbusplus::server::interface_t>(
+            bus, objPath, historyIntf, historyVtable, this);
+        bootTimingInterface =
+            std::make_unique<sdbusplus::server::interface_t>(
+                bus, objPath, bootTimingIntf, bootTimingVtable, this);
+
+        // Mark where this instance picked up the host
+        recordHistory();
+
         // We deferred this until we could get our property correct
         this->emit_object_added();
     }
@@ -98,6 +131,9 @@ class Host : public HostInherit
     /** @brief Set value of CurrentHostState */
     HostState currentHostState(HostState value) override;
 
+    /** @brief Set value of RestartCause */
+    RestartCause restartCause(RestartCause value) override;
+
     /**
      * @brief Set value for allowable auto-reboot count
      *
@@ -199,6 +235,11 @@ class Host : public HostInherit
      **/
     bool isAutoReboot();
 
+    /** @brief Subscribe to changes of the AutoReboot settings and read their
+     *         initial values, each time the settings objects are found
+     */
+    void watchAutoReboot();
+
     /** @brief Check if systemd state change is relevant to this object
      *
      * Instance specific interface to handle the detected systemd state
@@ -222,6 +263,18 @@ class Host : public HostInherit
      */
     void sysStateChangeJobNew(sdbusplus::message_t& msg);
 
+    /** @brief Reset the host sensors after a BMC reset
+     *
+     * The boot progress, operating system status and restart cause of a
+     * host which is not running are left over from its last boot.
+     */
+    void resetSensorStates();
+
+    /** @brief Reset the one-time AutoReboot setting when the chassis is
+     *         powered off
+     */
+    void resetOneTimeAutoReboot();
+
     /** @brief Decrement reboot count
      *
      * This is used internally to this application to decrement the boot
@@ -232,6 +285,76 @@ class Host : public HostInherit
      */
     uint32_t decrementRebootCount();
 
+    /** @brief Record a host crash in the crash window and persist it */
+    void recordCrash();
+
+    /** @brief Reboot the host once the backoff delay has expired */
+    void rebootAfterBackoff();
+
+    /** @brief Stop a pending automatic reboot, if any */
+    void cancelRebootBackoff();
+
+    /** @brief Get a property of the crash loop interface
+     *
+     * @param[in] property - The property name
+     * @param[in] reply    - The message to append the value to
+     * @param[in] userdata - The Host object
+     */
+    static int getCrashLoopProperty(sd_bus* bus, const char* path,
+                                    const char* interface,
+                                    const char* property,
+                                    sd_bus_message* reply, void* userdata,
+                                    sd_bus_error* error);
+
+    /** @brief The crash loop interface, see getCrashLoopProperty() */
+    static const sdbusplus::vtable_t crashLoopVtable[];
+
+    /** @brief The crash loop interface name, see the README */
+    static constexpr auto crashLoopIntf = "com.ibm.State.Host.CrashLoop";
+
+    /** @brief Add the current states of the host to its history */
+    void recordHistory();
+
+    /** @brief Handle the GetHistory method of the history interface
+     *
+     * Takes the time, in milliseconds since epoch, to get the transitions
+     * after, and returns them as an array of (time, CurrentHostState,
+     * BootProgress, OperatingSystemState, RestartCause), oldest first.
+     *
+     * @param[in] msg      - The method call
+     * @param[in] userdata - The Host object
+     */
+    static int getHistory(sd_bus_message* msg, void* userdata,
+                          sd_bus_error* error);
+
+    /** @brief The history interface, see getHistory() */
+    static const sdbusplus::vtable_t historyVtable[];
+
+    /** @brief The history interface name, see the README */
+    static constexpr auto historyIntf = "com.ibm.State.Host.History";
+
+    /** @brief Get a property of the boot timing interface
+     *
+     * Stages holds the statistics of each BootProgress stage, by stage,
+     * and IPL those of the time from the first stage until the OS is
+     * started. Each is (last, min, max, average, count), in milliseconds.
+     *
+     * @param[in] property - The property name
+     * @param[in] reply    - The message to append the value to
+     * @param[in] userdata - The Host object
+     */
+    static int getBootTimingProperty(sd_bus* bus, const char* path,
+                                     const char* interface,
+                                     const char* property,
+                                     sd_bus_message* reply, void* userdata,
+                                     sd_bus_error* error);
+
+    /** @brief The boot timing interface, see getBootTimingProperty() */
+    static const sdbusplus::vtable_t bootTimingVtable[];
+
+    /** @brief The boot timing interface name, see the README */
+    static constexpr auto bootTimingIntf = "com.ibm.State.Boot.ProgressTiming";
+
     // Allow cereal class access to allow these next two function to be
     // private
     friend class cereal::access;
@@ -248,15 +371,17 @@ class Host : public HostInherit
     {
         // version is not used currently
         (void)(version);
-        archive(sdbusplus::xyz::openbmc_project::Control::Boot::server::
-                    RebootAttempts::retryAttempts(),
-                convertForMessage(sdbusplus::xyz::openbmc_project::State::
-                                      server::Host::requestedHostTransition()),
-                convertForMessage(sdbusplus::xyz::openbmc_project::State::Boot::
-                                      server::Progress::bootProgress()),
-                convertForMessage(
-                    sdbusplus::xyz::openbmc_project::State::OperatingSystem::
-                        server::Status::operatingSystemState()));
+        HostPersist persist{
+            sdbusplus::xyz::openbmc_project::Control::Boot::server::
+                RebootAttempts::retryAttempts(),
+            convertForMessage(sdbusplus::xyz::openbmc_project::State::server::
+                                  Host::requestedHostTransition()),
+            convertForMessage(sdbusplus::xyz::openbmc_project::State::Boot::
+                                  server::Progress::bootProgress()),
+            convertForMessage(sdbusplus::xyz::openbmc_project::State::
+                                  OperatingSystem::server::Status::
+                                      operatingSystemState())};
+        persist.write(archive, crashLoop);
     }
 
     /** @brief Function required by Cereal to perform deserialization.
@@ -269,33 +394,23 @@ class Host : public HostInherit
     template <class Archive>
     void load(Archive& archive, const std::uint32_t version)
     {
-        std::string reqTranState;
-        std::string bootProgress;
-        std::string osState;
-        // Older cereal archive without RetryAttempt may be implemented
-        // just set to (BOOT_COUNT_MAX_ALLOWED)
-        uint32_t retryAttempts = BOOT_COUNT_MAX_ALLOWED;
-        switch (version)
-        {
-            case 2:
-                archive(retryAttempts);
-                [[fallthrough]];
-            case 1:
-                archive(reqTranState, bootProgress, osState);
-                break;
-        }
-        auto reqTran = Host::convertTransitionFromString(reqTranState);
+        HostPersist persist;
+        persist.read(archive, version, crashLoop);
+
+        auto reqTran =
+            Host::convertTransitionFromString(persist.requestedTransition);
         // When restoring, set the requested state with persistent value
         // but don't call the override which would execute it
         sdbusplus::xyz::openbmc_project::State::server::Host::
             requestedHostTransition(reqTran);
         sdbusplus::xyz::openbmc_project::State::Boot::server::Progress::
-            bootProgress(Host::convertProgressStagesFromString(bootProgress));
+            bootProgress(
+                Host::convertProgressStagesFromString(persist.bootProgress));
         sdbusplus::xyz::openbmc_project::State::OperatingSystem::server::
             Status::operatingSystemState(
-                Host::convertOSStatusFromString(osState));
+                Host::convertOSStatusFromString(persist.osState));
         sdbusplus::xyz::openbmc_project::Control::Boot::server::RebootAttempts::
-            retryAttempts(retryAttempts);
+            retryAttempts(persist.retryAttempts);
     }
 
     /** @brief Serialize and persist requested host state
@@ -341,9 +456,21 @@ class Host : public HostInherit
     // Settings host objects of interest
     settings::HostObjects settings;
 
+    /** @brief The one-time AutoReboot setting **/
+    ::settings::BoolSetting autoRebootOneTime{
+        settings, ::settings::autoRebootIntf, "AutoReboot"};
+
+    /** @brief The user AutoReboot setting **/
+    ::settings::BoolSetting autoRebootUser{
+        settings, ::settings::autoRebootIntf, "AutoReboot"};
+
     /** @brief Host id. **/
     const size_t id = 0;
 
+    /** @brief File indicating to the host services that the host was
+     *         already running when the BMC was reset **/
+    const MarkerFile hostRunningFile;
+
     /** @brief HostState to systemd target mapping table. **/
     std::map<HostState, std::string> stateTargetTable;
 
@@ -352,6 +479,40 @@ class Host : public HostInherit
 
     /** @brief Target called when a host crash occurs **/
     std::string hostCrashTarget;
+
+    /** @brief Target which checks if the host is running after a BMC reset **/
+    std::string hostResetTarget;
+
+    /** @brief Target called when the chassis of the host is powered off **/
+    std::string chassisPowerOffTarget;
+
+    /** @brief The last state transitions of the host **/
+    HostHistory history;
+
+    /** @brief Statistics of the BootProgress stages of the host **/
+    BootTiming bootTiming;
+
+    /** @brief The host crashes within the crash window, so a host in a
+     *         crash loop does not keep the BMC busy with back to back
+     *         boots. More than 32 crashes within the window do not change
+     *         the backoff, so only that many are kept **/
+    CrashLoop crashLoop{{std::chrono::seconds(CRASH_WINDOW_SECONDS),
+                         std::chrono::seconds(CRASH_BACKOFF_SECONDS),
+                         std::chrono::seconds(CRASH_BACKOFF_MAX_SECONDS),
+                         32}};
+
+    /** @brief Delays the automatic reboot of a crash looping host **/
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>
+        rebootBackoffTimer;
+
+    /** @brief The crash loop interface on the host object **/
+    std::unique_ptr<sdbusplus::server::interface_t> crashLoopInterface;
+
+    /** @brief The history interface on the host object **/
+    std::unique_ptr<sdbusplus::server::interface_t> historyInterface;
+
+    /** @brief The boot timing interface on the host object **/
+    std::unique_ptr<sdbusplus::server::interface_t> bootTimingInterface;
 };
 
 } // namespace manager
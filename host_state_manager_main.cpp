@@ -5,7 +5,10 @@
 #include <fmt/format.h>
 #include <getopt.h>
 
+#include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/exception.hpp>
 
 #include <cstdlib>
 #include <exception>
@@ -63,10 +66,12 @@ int main(int argc, char** argv)
     // Add sdbusplus ObjectManager.
     sdbusplus::server::manager_t objManager(bus, objPathInst.c_str());
 
-    phosphor::state::manager::Host manager(bus, objPathInst.c_str(), hostId);
+    // The host history is stored as soon as the host is constructed
+    fs::create_directories(fs::path(HOST_STATE_PERSIST_PATH).parent_path());
+    fs::create_directories(fs::path(HOST_HISTORY_PERSIST_PATH).parent_path());
+    fs::create_directories(fs::path(BOOT_TIMING_PERSIST_PATH).parent_path());
 
-    auto dir = fs::path(HOST_STATE_PERSIST_PATH).parent_path();
-    fs::create_directories(dir);
+    phosphor::state::manager::Host manager(bus, objPathInst.c_str(), hostId);
 
     // For backwards compatibility, request a busname without host id if
     // input id is 0.
@@ -77,10 +82,17 @@ int main(int argc, char** argv)
 
     bus.request_name(hostBusName.c_str());
 
-    while (true)
+    // The event loop runs the reboot backoff timer along with the bus
+    try
+    {
+        auto event = sdeventplus::Event::get_default();
+        bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+        return event.loop();
+    }
+    catch (const sdeventplus::SdEventError& e)
     {
-        bus.process_discard();
-        bus.wait();
+        lg2::error("Error occurred during the sdeventplus loop: {ERROR}",
+                   "ERROR", e);
+        return EXIT_FAILURE;
     }
-    return 0;
 }
@@ -0,0 +1,331 @@
+#include "host_transition_scheduler.hpp"
+
+#include "scheduled_host_transition.hpp"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/vector.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+// Need to do this since its not exported outside of the kernel.
+// Refer : https://gist.github.com/lethean/446cea944b7441228298
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+// Needed to make sure timerfd does not misfire even though we set CANCEL_ON_SET
+#define TIME_T_MAX (time_t)((1UL << ((sizeof(time_t) << 3) - 1)) - 1)
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+namespace fs = std::filesystem;
+
+using namespace std::chrono;
+
+namespace
+{
+
+/** @brief Version of the persisted transitions */
+constexpr uint32_t persistVersion = 1;
+
+/** @brief Read the transitions from the json file of an earlier version
+ *
+ * Files from before the binary format hold the one scheduled time and
+ * transition of host 0.
+ *
+ * @param[in] path - The file the transitions are persisted in
+ *
+ * @return The transitions of each host
+ */
+std::map<size_t, StoredTransitions> readJsonStore(const fs::path& path)
+{
+    std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+    cereal::JSONInputArchive iarchive(is);
+    uint64_t time;
+    Transition trans;
+    iarchive(time, trans);
+
+    std::map<size_t, StoredTransitions> store;
+    store[0].scheduled = {time, trans};
+    return store;
+}
+
+} // namespace
+
+HostTransitionScheduler::HostTransitionScheduler(
+    const sdeventplus::Event& event, const fs::path& persistPath) :
+    event(event),
+    persistPath(persistPath),
+    timer(event, [this](auto&) { callback(); })
+{
+    initialize();
+
+    if (!deserializeScheduledValues())
+    {
+        store.clear();
+    }
+}
+
+HostTransitionScheduler::~HostTransitionScheduler()
+{
+    close(timeFd);
+}
+
+void HostTransitionScheduler::addHost(size_t id, ScheduledHostTransition& host)
+{
+    hosts[id] = &host;
+}
+
+void HostTransitionScheduler::removeHost(size_t id)
+{
+    cancel(id);
+    hosts.erase(id);
+}
+
+void HostTransitionScheduler::schedule(size_t id, uint64_t time)
+{
+    auto it = hostDeadlines.find(id);
+    if (it != hostDeadlines.end())
+    {
+        deadlines.erase({it->second, id});
+        it->second = time;
+    }
+    else
+    {
+        hostDeadlines.emplace(id, time);
+    }
+    deadlines.emplace(time, id);
+    armTimer();
+}
+
+void HostTransitionScheduler::cancel(size_t id)
+{
+    auto it = hostDeadlines.find(id);
+    if (it == hostDeadlines.end())
+    {
+        return;
+    }
+    deadlines.erase({it->second, id});
+    hostDeadlines.erase(it);
+    armTimer();
+}
+
+bool HostTransitionScheduler::isScheduled(size_t id) const
+{
+    return hostDeadlines.contains(id);
+}
+
+std::optional<uint64_t> HostTransitionScheduler::getDeadline(size_t id) const
+{
+    auto it = hostDeadlines.find(id);
+    if (it == hostDeadlines.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<StoredTransitions>
+    HostTransitionScheduler::getStoredTransitions(size_t id) const
+{
+    auto it = store.find(id);
+    if (it == store.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void HostTransitionScheduler::storeTransitions(
+    size_t id, const StoredTransitions& transitions)
+{
+    store[id] = transitions;
+    serializeScheduledValues();
+}
+
+void HostTransitionScheduler::armTimer()
+{
+    if (deadlines.empty())
+    {
+        if (timer.isEnabled())
+        {
+            timer.setEnabled(false);
+        }
+        return;
+    }
+
+    auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
+    auto deltaTime = seconds(deadlines.begin()->first) - now;
+    timer.restart(std::max(deltaTime, seconds(0)));
+}
+
+void HostTransitionScheduler::callback()
+{
+    auto now = static_cast<uint64_t>(
+        duration_cast<seconds>(system_clock::now().time_since_epoch())
+            .count());
+
+    // Take the due hosts off first, they schedule their next deadline from
+    // their callback
+    std::vector<size_t> due;
+    while (!deadlines.empty() && (deadlines.begin()->first <= now))
+    {
+        auto id = deadlines.begin()->second;
+        deadlines.erase(deadlines.begin());
+        hostDeadlines.erase(id);
+        due.push_back(id);
+    }
+
+    for (auto id : due)
+    {
+        auto host = hosts.find(id);
+        if (host != hosts.end())
+        {
+            host->second->callback();
+        }
+    }
+
+    armTimer();
+}
+
+void HostTransitionScheduler::initialize()
+{
+    // Subscribe time change event
+    // Choose the MAX time that is possible to avoid mis fires.
+    constexpr itimerspec maxTime = {
+        {0, 0},          // it_interval
+        {TIME_T_MAX, 0}, // it_value
+    };
+
+    // Create and operate on a timer that delivers timer expiration
+    // notifications via a file descriptor.
+    timeFd = timerfd_create(CLOCK_REALTIME, 0);
+    if (timeFd == -1)
+    {
+        auto eno = errno;
+        error("Failed to create timerfd, errno: {ERRNO}, rc: {RC}", "ERRNO",
+              eno, "RC", timeFd);
+        throw std::system_error(eno, std::system_category());
+    }
+
+    // Starts the timer referred to by the file descriptor fd.
+    // If TFD_TIMER_CANCEL_ON_SET is specified along with TFD_TIMER_ABSTIME
+    // and the clock for this timer is CLOCK_REALTIME, then mark this timer
+    // as cancelable if the real-time clock undergoes a discontinuous change.
+    // In this way, we can monitor whether BMC time is changed or not.
+    auto r = timerfd_settime(
+        timeFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &maxTime, nullptr);
+    if (r != 0)
+    {
+        auto eno = errno;
+        error("Failed to set timerfd, errno: {ERRNO}, rc: {RC}", "ERRNO", eno,
+              "RC", r);
+        throw std::system_error(eno, std::system_category());
+    }
+
+    sd_event_source* es;
+    // Add a new I/O event source to an event loop. onTimeChange will be called
+    // when the event source is triggered.
+    r = sd_event_add_io(event.get(), &es, timeFd, EPOLLIN, onTimeChange, this);
+    if (r < 0)
+    {
+        auto eno = errno;
+        error("Failed to add event, errno: {ERRNO}, rc: {RC}", "ERRNO", eno,
+              "RC", r);
+        throw std::system_error(eno, std::system_category());
+    }
+    timeChangeEventSource.reset(es);
+}
+
+int HostTransitionScheduler::onTimeChange(sd_event_source* /* es */, int fd,
+                                          uint32_t /* revents */,
+                                          void* userdata)
+{
+    auto scheduler = static_cast<HostTransitionScheduler*>(userdata);
+
+    std::array<char, 64> time{};
+
+    // We are not interested in the data here.
+    // So read until there is no new data here in the FD
+    while (read(fd, time.data(), time.max_size()) > 0)
+        ;
+
+    debug("BMC system time is changed");
+    for (const auto& [id, host] : scheduler->hosts)
+    {
+        host->handleTimeUpdates();
+    }
+
+    return 0;
+}
+
+void HostTransitionScheduler::serializeScheduledValues()
+{
+    std::ofstream os(persistPath.c_str(), std::ios::binary);
+    cereal::BinaryOutputArchive oarchive(os);
+
+    oarchive(persistVersion, store);
+}
+
+bool HostTransitionScheduler::deserializeScheduledValues()
+{
+    try
+    {
+        if (fs::exists(persistPath))
+        {
+            std::ifstream is(persistPath.c_str(),
+                             std::ios::in | std::ios::binary);
+
+            // Files of the earlier versions are json
+            if (is.peek() == '{')
+            {
+                is.close();
+                store = readJsonStore(persistPath);
+                info("Migrating the scheduled transitions to the binary "
+                     "format");
+                serializeScheduledValues();
+                return true;
+            }
+
+            cereal::BinaryInputArchive iarchive(is);
+            uint32_t version = 0;
+            iarchive(version);
+            if (version != persistVersion)
+            {
+                throw std::runtime_error("Unknown version " +
+                                         std::to_string(version));
+            }
+            iarchive(store);
+            return true;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        error("deserialize exception: {ERROR}", "ERROR", e);
+        fs::remove(persistPath);
+    }
+
+    return false;
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "config.h"
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
+#include <xyz/openbmc_project/State/Host/server.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+using Transition =
+    sdbusplus::xyz::openbmc_project::State::server::Host::Transition;
+
+class ScheduledHostTransition;
+
+/** @brief A pending scheduled transition */
+struct ScheduledEntry
+{
+    /** @brief The seconds since epoch to do the transition */
+    uint64_t time;
+
+    /** @brief The transition to request */
+    Transition transition;
+
+    /** @brief Function required by Cereal to perform serialization */
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(time, transition);
+    }
+};
+
+/** @brief The persisted transitions of a host */
+struct StoredTransitions
+{
+    /** @brief The ScheduledTime and ScheduledTransition properties, a time
+     *         of 0 when none is scheduled */
+    ScheduledEntry scheduled{0, Transition::On};
+
+    /** @brief The transitions added through the queue interface */
+    std::vector<ScheduledEntry> queue;
+
+    /** @brief Function required by Cereal to perform serialization */
+    template <class Archive>
+    void serialize(Archive& archive)
+    {
+        archive(scheduled, queue);
+    }
+};
+
+/** @class HostTransitionScheduler
+ *  @brief Drives the scheduled transitions of all hosts.
+ *  @details Owns the one RealTime timer, armed for the earliest deadline of
+ *  any host, the one time change fd, and the persisted transitions of every
+ *  host.
+ */
+class HostTransitionScheduler
+{
+  public:
+    HostTransitionScheduler() = delete;
+    HostTransitionScheduler(const HostTransitionScheduler&) = delete;
+    HostTransitionScheduler& operator=(const HostTransitionScheduler&) = delete;
+    HostTransitionScheduler(HostTransitionScheduler&&) = delete;
+    HostTransitionScheduler& operator=(HostTransitionScheduler&&) = delete;
+
+    /** @brief Constructs HostTransitionScheduler
+     *
+     * @param[in] event       - The event loop to run the timers on
+     * @param[in] persistPath - The file the transitions are persisted in
+     */
+    explicit HostTransitionScheduler(
+        const sdeventplus::Event& event,
+        const std::filesystem::path& persistPath =
+            SCHEDULED_HOST_TRANSITION_PERSIST_PATH);
+
+    ~HostTransitionScheduler();
+
+    /** @brief Register a host to be called back by the scheduler
+     *
+     * @param[in] id   - The host id
+     * @param[in] host - The host's scheduled transition object
+     */
+    void addHost(size_t id, ScheduledHostTransition& host);
+
+    /** @brief Unregister a host and cancel its deadline
+     *
+     * @param[in] id - The host id
+     */
+    void removeHost(size_t id);
+
+    /** @brief Call back a host at a time, replacing its previous deadline
+     *
+     * @param[in] id   - The host id
+     * @param[in] time - The seconds since epoch to call it back
+     */
+    void schedule(size_t id, uint64_t time);
+
+    /** @brief Cancel the deadline of a host
+     *
+     * @param[in] id - The host id
+     */
+    void cancel(size_t id);
+
+    /** @brief Check if a host has a deadline
+     *
+     * @param[in] id - The host id
+     *
+     * @return bool - true if the host will be called back
+     */
+    bool isScheduled(size_t id) const;
+
+    /** @brief Get the deadline of a host
+     *
+     * @param[in] id - The host id
+     *
+     * @return The seconds since epoch the host is called back, unset if it
+     *         has no deadline
+     */
+    std::optional<uint64_t> getDeadline(size_t id) const;
+
+    /** @brief Get the persisted transitions of a host
+     *
+     * @param[in] id - The host id
+     *
+     * @return The transitions, unset if none were persisted
+     */
+    std::optional<StoredTransitions> getStoredTransitions(size_t id) const;
+
+    /** @brief Persist the transitions of a host
+     *
+     * @param[in] id          - The host id
+     * @param[in] transitions - The host's scheduled and queued transitions
+     */
+    void storeTransitions(size_t id, const StoredTransitions& transitions);
+
+  private:
+    /** @brief Used by the timer to call back the hosts which are due */
+    void callback();
+
+    /** @brief Start the timer for the earliest deadline */
+    void armTimer();
+
+    /** @brief Initialize timerFd related resource */
+    void initialize();
+
+    /** @brief The callback function on system time change
+     *
+     * @param[in] es - Source of the event
+     * @param[in] fd - File descriptor of the timer
+     * @param[in] revents - Not used
+     * @param[in] userdata - User data pointer
+     */
+    static int onTimeChange(sd_event_source* es, int fd, uint32_t revents,
+                            void* userdata);
+
+    /** @brief Serialize the transitions of all hosts */
+    void serializeScheduledValues();
+
+    /** @brief Deserialize the transitions of all hosts
+     *
+     *  @return bool - true if successful, false otherwise
+     */
+    bool deserializeScheduledValues();
+
+    /** @brief sdbusplus event */
+    const sdeventplus::Event& event;
+
+    /** @brief The file the transitions are persisted in */
+    const std::filesystem::path persistPath;
+
+    /** @brief Timer used for the earliest host transition deadline */
+    sdeventplus::utility::Timer<sdeventplus::ClockId::RealTime> timer;
+
+    /** @brief The fd for time change event */
+    int timeFd = -1;
+
+    /** @brief The deleter of sd_event_source */
+    std::function<void(sd_event_source*)> sdEventSourceDeleter =
+        [](sd_event_source* p) {
+        if (p)
+        {
+            sd_event_source_unref(p);
+        }
+    };
+
+    using SdEventSource =
+        std::unique_ptr<sd_event_source, decltype(sdEventSourceDeleter)>;
+
+    /** @brief The event source on system time change */
+    SdEventSource timeChangeEventSource{nullptr, sdEventSourceDeleter};
+
+    /** @brief The registered hosts */
+    std::map<size_t, ScheduledHostTransition*> hosts;
+
+    /** @brief The deadline of each host, ordered by time */
+    std::set<std::pair<uint64_t, size_t>> deadlines;
+
+    /** @brief The deadline of each host, by host id */
+    std::map<size_t, uint64_t> hostDeadlines;
+
+    /** @brief The persisted transitions of each host */
+    std::map<size_t, StoredTransitions> store;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
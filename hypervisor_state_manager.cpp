@@ -2,15 +2,21 @@
 
 #include "hypervisor_state_manager.hpp"
 
+#include "utils.hpp"
+
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/exception.hpp>
 #include <sdbusplus/server.hpp>
 
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
+#include <utility>
+#include <variant>
 
 namespace phosphor
 {
@@ -25,6 +31,14 @@ PHOSPHOR_LOG2_USING;
 namespace server = sdbusplus::xyz::openbmc_project::State::server;
 using namespace phosphor::logging;
 
+/** @brief Hypervisor state for each BootProgress, any other is Off */
+constexpr std::array<std::pair<ProgressStages, server::Host::HostState>, 3>
+    bootProgressStates{{
+        {ProgressStages::SystemInitComplete, server::Host::HostState::Standby},
+        {ProgressStages::OSRunning, server::Host::HostState::Running},
+        {ProgressStages::Unspecified, server::Host::HostState::Off},
+    }};
+
 server::Host::Transition Hypervisor::requestedHostTransition(Transition value)
 {
     info("Hypervisor state transition request of {TRAN_REQUEST}",
@@ -59,49 +73,138 @@ server::Host::HostState Hypervisor::currentHostState()
     return server::Host::currentHostState();
 }
 
-void Hypervisor::updateCurrentHostState(std::string& bootProgress)
+void Hypervisor::updateCurrentHostState(ProgressStages bootProgress)
 {
     debug("New BootProgress: {BOOTPROGRESS}", "BOOTPROGRESS", bootProgress);
 
-    if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                        "ProgressStages.SystemInitComplete")
-    {
-        currentHostState(server::Host::HostState::Standby);
-    }
-    else if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                             "ProgressStages.OSRunning")
+    // BootProgress changed and it is not one in the table so set hypervisor
+    // state to off
+    auto state = server::Host::HostState::Off;
+    auto entry = std::find_if(bootProgressStates.begin(),
+                              bootProgressStates.end(),
+                              [bootProgress](const auto& stage) {
+        return stage.first == bootProgress;
+    });
+    if (entry != bootProgressStates.end())
     {
-        currentHostState(server::Host::HostState::Running);
+        state = entry->second;
     }
-    else if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                             "ProgressStages.Unspecified")
+    currentHostState(state);
+
+    if (bootProgress == ProgressStages::Unspecified)
     {
         // Unspecified is set when the system is powered off so
-        // set the state to off and reset the requested host state
-        // back to its default
-        currentHostState(server::Host::HostState::Off);
+        // reset the requested host state back to its default
         server::Host::requestedHostTransition(server::Host::Transition::Off);
     }
-    else
-    {
-        // BootProgress changed and it is not one of the above so
-        // set hypervisor state to off
-        currentHostState(server::Host::HostState::Off);
-    }
 }
 
 void Hypervisor::bootProgressChangeEvent(sdbusplus::message_t& msg)
 {
     std::string statusInterface;
-    std::map<std::string, std::variant<std::string>> msgData;
-    msg.read(statusInterface, msgData);
+    ProgressProperties msgData;
+    try
+    {
+        msg.read(statusInterface, msgData);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Failed to read BootProgress of host {ID}: {ERROR}", "ID", id,
+              "ERROR", e);
+        return;
+    }
+
+    updateFromProperties(msgData);
+}
+
+void Hypervisor::syncBootProgress()
+{
+    auto hostPath = "/xyz/openbmc_project/state/host" + std::to_string(id);
+    auto hostService = std::string{HOST_BUSNAME} + std::to_string(id);
+
+    // Not waited for, so a host state manager which is slow to answer
+    // doesn't hold up this one. The state is updated from the reply.
+    try
+    {
+        auto method = bus.new_method_call(hostService.c_str(),
+                                          hostPath.c_str(),
+                                          "org.freedesktop.DBus.Properties",
+                                          "GetAll");
+        method.append("xyz.openbmc_project.State.Boot.Progress");
+        bootProgressCall = bus.call_async(
+            method,
+            [this](sdbusplus::message_t reply) { bootProgressDone(reply); },
+            utils::callTimeout(utils::CallClass::Query).count());
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Unable to read BootProgress of host {ID}: {ERROR}", "ID", id,
+              "ERROR", e);
+    }
+}
+
+void Hypervisor::bootProgressDone(sdbusplus::message_t& reply)
+{
+    ProgressProperties properties;
+    try
+    {
+        if (reply.is_method_error())
+        {
+            // The host isn't up yet, hostNameOwnerChangedEvent() syncs when
+            // it is
+            info("Unable to read BootProgress of host {ID}: {ERROR}", "ID",
+                 id, "ERROR", reply.get_error()->name);
+            return;
+        }
+        reply.read(properties);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Invalid BootProgress of host {ID}: {ERROR}", "ID", id, "ERROR",
+              e);
+        return;
+    }
+
+    updateFromProperties(properties);
+}
+
+void Hypervisor::updateFromProperties(const ProgressProperties& properties)
+{
+    auto propertyMap = properties.find("BootProgress");
+    if (propertyMap == properties.end())
+    {
+        return;
+    }
+
+    auto value = std::get_if<std::string>(&propertyMap->second);
+    if (value == nullptr)
+    {
+        return;
+    }
+
+    auto bootProgress =
+        sdbusplus::xyz::openbmc_project::State::Boot::server::Progress::
+            convertStringToProgressStages(*value);
+    if (!bootProgress)
+    {
+        error("Unknown BootProgress {VALUE} of host {ID}", "VALUE", *value,
+              "ID", id);
+        return;
+    }
+    updateCurrentHostState(*bootProgress);
+}
+
+void Hypervisor::hostNameOwnerChangedEvent(sdbusplus::message_t& msg)
+{
+    std::string name;
+    std::string oldOwner;
+    std::string newOwner;
+    msg.read(name, oldOwner, newOwner);
 
-    auto propertyMap = msgData.find("BootProgress");
-    if (propertyMap != msgData.end())
+    if (!newOwner.empty())
     {
-        // Extract the BootProgress
-        auto& bootProgress = std::get<std::string>(propertyMap->second);
-        updateCurrentHostState(bootProgress);
+        info("Host {ID} state manager started, resyncing state", "ID", id);
+        syncBootProgress();
     }
 }
 
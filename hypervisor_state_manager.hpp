@@ -6,6 +6,13 @@
 #include "xyz/openbmc_project/State/Host/server.hpp"
 
 #include <sdbusplus/bus.hpp>
+#include <xyz/openbmc_project/State/Boot/Progress/server.hpp>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
 
 namespace phosphor
 {
@@ -20,6 +27,9 @@ using HypervisorInherit = sdbusplus::server::object_t<
 namespace server = sdbusplus::xyz::openbmc_project::State::server;
 namespace sdbusRule = sdbusplus::bus::match::rules;
 
+using ProgressStages = sdbusplus::xyz::openbmc_project::State::Boot::server::
+    Progress::ProgressStages;
+
 /** @class Host
  *  @brief OpenBMC host state management implementation.
  *  @details A concrete implementation for xyz.openbmc_project.State.Host
@@ -36,22 +46,36 @@ class Hypervisor : public HypervisorInherit
     virtual ~Hypervisor() = default;
 
     /** @brief Constructs Hypervisor State Manager
+     *
+     * @note This constructor passes 'true' to the base class in order to
+     *       defer dbus object registration until the state of the host has
+     *       been read
      *
      * @param[in] bus       - The Dbus bus object
      * @param[in] objPath   - The Dbus object path
+     * @param[in] id        - The id of the host to follow
      */
-    Hypervisor(sdbusplus::bus_t& bus, const char* objPath) :
-        HypervisorInherit(bus, objPath,
-                          HypervisorInherit::action::emit_object_added),
-        bus(bus),
-        bootProgressChangeSignal(bus,
-                                 sdbusRule::propertiesChanged(
-                                     "/xyz/openbmc_project/state/host0",
-                                     "xyz.openbmc_project.State.Boot.Progress"),
-                                 [this](sdbusplus::message_t& m) {
-        bootProgressChangeEvent(m);
-        })
-    {}
+    Hypervisor(sdbusplus::bus_t& bus, const char* objPath, size_t id = 0) :
+        HypervisorInherit(bus, objPath, HypervisorInherit::action::defer_emit),
+        bus(bus), id(id),
+        bootProgressChangeSignal(
+            bus,
+            sdbusRule::propertiesChanged(
+                "/xyz/openbmc_project/state/host" + std::to_string(id),
+                "xyz.openbmc_project.State.Boot.Progress"),
+            [this](sdbusplus::message_t& m) { bootProgressChangeEvent(m); }),
+        hostNameOwnerChangedSignal(
+            bus,
+            sdbusRule::nameOwnerChanged(std::string{HOST_BUSNAME} +
+                                        std::to_string(id)),
+            [this](sdbusplus::message_t& m) { hostNameOwnerChangedEvent(m); })
+    {
+        // The host may already be running if this was restarted
+        syncBootProgress();
+
+        // We deferred this until we could get our property correct
+        this->emit_object_added();
+    }
 
     /** @brief Set value of HostTransition */
     server::Host::Transition
@@ -69,24 +93,74 @@ class Hypervisor : public HypervisorInherit
      * @param[in]  bootProgress     - BootProgress value to check
      *
      */
-    void updateCurrentHostState(std::string& bootProgress);
+    void updateCurrentHostState(ProgressStages bootProgress);
 
-  private:
     /** @brief Process BootProgress property changes
      *
      * Instance specific interface to monitor for changes to the BootProgress
      * property which may impact Hypervisor state.
      *
+     * @note This is public for benchmarking purposes
+     *
      * @param[in]  msg              - Data associated with subscribed signal
      *
      */
     void bootProgressChangeEvent(sdbusplus::message_t& msg);
 
+    /** @brief Handle the reply to the BootProgress read of
+     *         syncBootProgress()
+     *
+     * @note This is public for unit testing purposes
+     *
+     * @param[in]  reply            - The GetAll reply
+     *
+     */
+    void bootProgressDone(sdbusplus::message_t& reply);
+
+  private:
+    /** @brief Properties of the Boot.Progress interface. They are decoded as
+     *         strings as BootProgressOem is free form, not a ProgressStages.
+     */
+    using ProgressProperties =
+        std::map<std::string, std::variant<std::string, uint64_t>>;
+
+    /** @brief Update the hypervisor state from the BootProgress, if there
+     *         is one, of the Boot.Progress properties
+     *
+     * @param[in]  properties       - The properties which were read
+     *
+     */
+    void updateFromProperties(const ProgressProperties& properties);
+
+    /** @brief Read the current BootProgress of the host, the hypervisor
+     *         state is updated from it by bootProgressDone()
+     *
+     * Used when this starts, and when the host state manager restarts, as
+     * no PropertiesChanged is sent for a BootProgress which didn't change.
+     */
+    void syncBootProgress();
+
+    /** @brief Resync the state when the host state manager starts
+     *
+     * @param[in]  msg              - Data associated with subscribed signal
+     *
+     */
+    void hostNameOwnerChangedEvent(sdbusplus::message_t& msg);
+
     /** @brief Persistent sdbusplus DBus bus connection. */
     sdbusplus::bus_t& bus;
 
+    /** @brief Id of the host whose BootProgress is followed **/
+    const size_t id;
+
     /** @brief Watch BootProgress changes to know hypervisor state **/
     sdbusplus::bus::match_t bootProgressChangeSignal;
+
+    /** @brief Watch for the host state manager starting **/
+    sdbusplus::bus::match_t hostNameOwnerChangedSignal;
+
+    /** @brief Outstanding BootProgress read, a newer one replaces it **/
+    std::optional<sdbusplus::slot_t> bootProgressCall;
 };
 
 } // namespace manager
@@ -2,21 +2,61 @@
 
 #include "hypervisor_state_manager.hpp"
 
+#include <getopt.h>
+
 #include <sdbusplus/bus.hpp>
 
 #include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
 
-int main()
+int main(int argc, char** argv)
 {
+    std::vector<size_t> hostIds;
+
+    int arg;
+    int optIndex = 0;
+
+    static struct option longOpts[] = {{"host", required_argument, 0, 'h'},
+                                       {0, 0, 0, 0}};
+
+    while ((arg = getopt_long(argc, argv, "h:", longOpts, &optIndex)) != -1)
+    {
+        switch (arg)
+        {
+            case 'h':
+                hostIds.push_back(std::stoul(optarg));
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Follow host 0 by default, --host can be given once for each hypervisor
+    if (hostIds.empty())
+    {
+        hostIds.push_back(0);
+    }
+
     auto bus = sdbusplus::bus::new_default();
 
-    // For now, we only have one instance of the hypervisor
-    auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
+    std::vector<std::unique_ptr<sdbusplus::server::manager_t>> objManagers;
+    std::vector<std::unique_ptr<phosphor::state::manager::Hypervisor>>
+        managers;
+    for (auto hostId : hostIds)
+    {
+        auto objPathInst = std::string{HYPERVISOR_OBJPATH} +
+                           std::to_string(hostId);
 
-    // Add sdbusplus ObjectManager.
-    sdbusplus::server::manager_t objManager(bus, objPathInst.c_str());
+        // Add sdbusplus ObjectManager.
+        objManagers.emplace_back(std::make_unique<sdbusplus::server::manager_t>(
+            bus, objPathInst.c_str()));
 
-    phosphor::state::manager::Hypervisor manager(bus, objPathInst.c_str());
+        managers.emplace_back(
+            std::make_unique<phosphor::state::manager::Hypervisor>(
+                bus, objPathInst.c_str(), hostId));
+    }
 
     bus.request_name(HYPERVISOR_BUSNAME);
 
@@ -0,0 +1,71 @@
+#include "marker_file.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/printf.h>
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+#include <filesystem>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+MarkerFile::MarkerFile(const char* format, size_t id) :
+    filePath(fmt::sprintf(format, id))
+{}
+
+bool MarkerFile::exists() const
+{
+    return faccessat(AT_FDCWD, filePath.c_str(), F_OK, 0) == 0;
+}
+
+bool MarkerFile::create() const
+{
+    auto fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if ((fd < 0) && (errno == ENOENT))
+    {
+        // The directory is on a tmpfs, so it is gone after a BMC reboot
+        std::error_code ec;
+        std::filesystem::create_directories(
+            std::filesystem::path(filePath).parent_path(), ec);
+        fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    }
+
+    if (fd < 0)
+    {
+        auto eno = errno;
+        error("Failed to create {FILE}, errno: {ERRNO}", "FILE", filePath,
+              "ERRNO", eno);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+bool MarkerFile::remove() const
+{
+    if (unlinkat(AT_FDCWD, filePath.c_str(), 0) == 0)
+    {
+        return true;
+    }
+
+    auto eno = errno;
+    if (eno != ENOENT)
+    {
+        error("Failed to remove {FILE}, errno: {ERRNO}", "FILE", filePath,
+              "ERRNO", eno);
+    }
+    return false;
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class MarkerFile
+ *  @brief A file whose presence tells the systemd services of an instance
+ *         to alter their behavior, e.g. that the host is already running
+ *         after a BMC reset.
+ */
+class MarkerFile
+{
+  public:
+    /** @brief Constructs the marker file of an instance
+     *
+     * @param[in] format - printf format of the path, e.g. HOST_RUNNING_FILE
+     * @param[in] id     - The instance the file is for
+     */
+    MarkerFile(const char* format, size_t id);
+
+    /** @brief Get the path of the file */
+    const std::string& path() const
+    {
+        return filePath;
+    }
+
+    /** @brief Check if the file exists
+     *
+     * @return true if the file exists
+     */
+    bool exists() const;
+
+    /** @brief Create the file, and its directory if needed
+     *
+     * @return true if the file exists afterwards
+     */
+    bool create() const;
+
+    /** @brief Remove the file if it exists
+     *
+     * @return true if the file was removed
+     */
+    bool remove() const;
+
+  private:
+    /** @brief The path of the file of the instance */
+    const std::string filePath;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
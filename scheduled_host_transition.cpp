@@ -3,27 +3,19 @@
 #include "utils.hpp"
 #include "xyz/openbmc_project/State/Host/server.hpp"
 
-#include <sys/timerfd.h>
-#include <unistd.h>
-
-#include <cereal/archives/json.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/elog.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <xyz/openbmc_project/ScheduledTime/error.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <chrono>
-#include <filesystem>
-#include <fstream>
-
-// Need to do this since its not exported outside of the kernel.
-// Refer : https://gist.github.com/lethean/446cea944b7441228298
-#ifndef TFD_TIMER_CANCEL_ON_SET
-#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
-#endif
-
-// Needed to make sure timerfd does not misfire even though we set CANCEL_ON_SET
-#define TIME_T_MAX (time_t)((1UL << ((sizeof(time_t) << 3) - 1)) - 1)
+#include <map>
+#include <string_view>
+#include <tuple>
+#include <variant>
 
 namespace phosphor
 {
@@ -34,8 +26,6 @@ namespace manager
 
 PHOSPHOR_LOG2_USING;
 
-namespace fs = std::filesystem;
-
 using namespace std::chrono;
 using namespace phosphor::logging;
 using namespace xyz::openbmc_project::ScheduledTime;
@@ -47,6 +37,40 @@ using HostState = sdbusplus::xyz::openbmc_project::State::server::Host;
 
 constexpr auto PROPERTY_TRANSITION = "RequestedHostTransition";
 constexpr auto PROPERTY_RESTART_CAUSE = "RestartCause";
+constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+constexpr auto BMC_NOT_READY =
+    "xyz.openbmc_project.State.Host.Error.BMCNotReady";
+
+namespace
+{
+
+/** @brief Check if a failed transition request may succeed later
+ *
+ *  That is when the BMC or the host state manager is not ready yet, or the
+ *  call timed out. Anything else, like a transition the host rejects, would
+ *  only fail again.
+ *
+ *  @param[in] name      - The D-Bus error name
+ *  @param[in] errnoCode - The errno of the error
+ *
+ *  @return bool - true if the transition is to be retried
+ */
+bool isRetryable(std::string_view name, int errnoCode)
+{
+    static constexpr std::array<std::string_view, 6> notReady = {
+        BMC_NOT_READY,
+        "xyz.openbmc_project.Common.Error.ResourceNotFound",
+        "org.freedesktop.DBus.Error.ServiceUnknown",
+        "org.freedesktop.DBus.Error.NameHasNoOwner",
+        "org.freedesktop.DBus.Error.Timeout",
+        "org.freedesktop.DBus.Error.NoReply"};
+
+    return (errnoCode == ETIMEDOUT) ||
+           (std::find(notReady.begin(), notReady.end(), name) !=
+            notReady.end());
+}
+
+} // namespace
 
 uint64_t ScheduledHostTransition::scheduledTime(uint64_t value)
 {
@@ -55,13 +79,8 @@ uint64_t ScheduledHostTransition::scheduledTime(uint64_t value)
     if (value == 0)
     {
         // 0 means the function Scheduled Host Transition is disabled
-        // Stop the timer if it's running
-        if (timer.isEnabled())
-        {
-            timer.setEnabled(false);
-            debug(
-                "scheduledTime: The function Scheduled Host Transition is disabled.");
-        }
+        debug(
+            "scheduledTime: The function Scheduled Host Transition is disabled.");
     }
     else
     {
@@ -73,230 +92,434 @@ uint64_t ScheduledHostTransition::scheduledTime(uint64_t value)
             elog<InvalidTimeError>(
                 InvalidTime::REASON("Scheduled time is in the past"));
         }
-        else
-        {
-            // Start a timer to do host transition at scheduled time
-            timer.restart(deltaTime);
-        }
     }
 
-    // Set scheduledTime
+    // Set scheduledTime, replacing the one scheduled before
     HostTransition::scheduledTime(value);
+    armTimer();
     // Store scheduled values
     serializeScheduledValues();
 
     return value;
 }
 
+Transition ScheduledHostTransition::scheduledTransition(Transition value)
+{
+    // Read when the scheduled time is due, only stored here
+    HostTransition::scheduledTransition(value);
+    serializeScheduledValues();
+
+    return value;
+}
+
 seconds ScheduledHostTransition::getTime()
 {
     auto now = system_clock::now();
     return duration_cast<seconds>(now.time_since_epoch());
 }
 
-void ScheduledHostTransition::hostTransition()
+void ScheduledHostTransition::hostTransition(Transition transition)
 {
     auto hostPath = std::string{HOST_OBJPATH} + std::to_string(id);
 
-    auto reqTrans = convertForMessage(HostTransition::scheduledTransition());
+    // Only look up the host service once, it is cleared on failure in case
+    // it changed
+    if (hostService.empty())
+    {
+        hostService = utils::getService(bus, hostPath, HOST_BUSNAME);
+    }
+
+    auto reqTrans = convertForMessage(transition);
 
     info("Trying to set requestedTransition to {REQUESTED_TRANSITION}",
          "REQUESTED_TRANSITION", reqTrans);
 
-    utils::setProperty(bus, hostPath, HOST_BUSNAME, PROPERTY_TRANSITION,
-                       reqTrans);
+    auto method = bus.new_method_call(hostService.c_str(), hostPath.c_str(),
+                                      PROPERTY_INTERFACE, "Set");
+    method.append(HOST_BUSNAME, PROPERTY_TRANSITION,
+                  std::variant<std::string>(reqTrans));
+    transitionCall = bus.call_async(method, [this](sdbusplus::message_t reply) {
+        transitionDone(reply);
+    });
 
     // Set RestartCause to indicate this transition is occurring due to a
-    // scheduled host transition as long as it's not an off request
-    if (HostTransition::scheduledTransition() != HostState::Transition::Off)
+    // scheduled host transition as long as it's not an off request. This is
+    // sent right behind the transition so the host handles both together.
+    if (transition != HostState::Transition::Off)
     {
         info("Set RestartCause to scheduled power on reason");
         auto resCause =
             convertForMessage(HostState::RestartCause::ScheduledPowerOn);
-        utils::setProperty(bus, hostPath, HOST_BUSNAME, PROPERTY_RESTART_CAUSE,
-                           resCause);
+        method = bus.new_method_call(hostService.c_str(), hostPath.c_str(),
+                                     PROPERTY_INTERFACE, "Set");
+        method.append(HOST_BUSNAME, PROPERTY_RESTART_CAUSE,
+                      std::variant<std::string>(resCause));
+        restartCauseCall = bus.call_async(
+            method, [](sdbusplus::message_t reply) {
+            if (reply.is_method_error())
+            {
+                error("Failed to set RestartCause: {ERROR}", "ERROR",
+                      reply.get_error()->name);
+            }
+        });
     }
 }
 
-void ScheduledHostTransition::callback()
+void ScheduledHostTransition::transitionDone(sdbusplus::message_t& reply)
 {
-    // Stop timer, since we need to do host transition once only
-    timer.setEnabled(false);
-    hostTransition();
-    // Set scheduledTime to 0 to disable host transition and update scheduled
-    // values
-    scheduledTime(0);
+    auto due = std::move(inFlight);
+    inFlight.clear();
+    auto dueTime = inFlightTime;
+    inFlightTime.reset();
+
+    if (!reply.is_method_error())
+    {
+        // Set scheduledTime to 0 to disable host transition, unless another
+        // time was scheduled meanwhile
+        if (dueTime && (HostTransition::scheduledTime() == *dueTime))
+        {
+            HostTransition::scheduledTime(0);
+        }
+
+        // The transition is done, stop retrying it and store the queue
+        // without it. Another transition may have become due meanwhile.
+        stopRetry();
+        armTimer();
+        serializeScheduledValues();
+        return;
+    }
+
+    auto errorName = std::string_view(reply.get_error()->name);
+    if (errorName != BMC_NOT_READY)
+    {
+        error("Failed to set {PROPERTY}: {ERROR}", "PROPERTY",
+              PROPERTY_TRANSITION, "ERROR", errorName);
+        hostService.clear();
+    }
+
+    // Put them back, they are either retried or dropped with any others
+    // which became due meanwhile
+    for (const auto& entry : due)
+    {
+        addScheduledTransition(entry.time, entry.transition);
+    }
+
+    if (isRetryable(errorName, reply.get_errno()))
+    {
+        retryTransition();
+        return;
+    }
+
+    auto dropped = dropDueTransitions();
+    error("Scheduled transition rejected, abandoning {COUNT} scheduled "
+          "transitions",
+          "COUNT", dropped);
 }
 
-void ScheduledHostTransition::initialize()
+void ScheduledHostTransition::addScheduledTransition(uint64_t time,
+                                                     Transition transition)
 {
-    // Subscribe time change event
-    // Choose the MAX time that is possible to avoid mis fires.
-    constexpr itimerspec maxTime = {
-        {0, 0},          // it_interval
-        {TIME_T_MAX, 0}, // it_value
-    };
-
-    // Create and operate on a timer that delivers timer expiration
-    // notifications via a file descriptor.
-    timeFd = timerfd_create(CLOCK_REALTIME, 0);
-    if (timeFd == -1)
-    {
-        auto eno = errno;
-        error("Failed to create timerfd, errno: {ERRNO}, rc: {RC}", "ERRNO",
-              eno, "RC", timeFd);
-        throw std::system_error(eno, std::system_category());
-    }
-
-    // Starts the timer referred to by the file descriptor fd.
-    // If TFD_TIMER_CANCEL_ON_SET is specified along with TFD_TIMER_ABSTIME
-    // and the clock for this timer is CLOCK_REALTIME, then mark this timer
-    // as cancelable if the real-time clock undergoes a discontinuous change.
-    // In this way, we can monitor whether BMC time is changed or not.
-    auto r = timerfd_settime(
-        timeFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &maxTime, nullptr);
-    if (r != 0)
-    {
-        auto eno = errno;
-        error("Failed to set timerfd, errno: {ERRNO}, rc: {RC}", "ERRNO", eno,
-              "RC", r);
-        throw std::system_error(eno, std::system_category());
-    }
-
-    sd_event_source* es;
-    // Add a new I/O event source to an event loop. onTimeChange will be called
-    // when the event source is triggered.
-    r = sd_event_add_io(event.get(), &es, timeFd, EPOLLIN, onTimeChange, this);
-    if (r < 0)
-    {
-        auto eno = errno;
-        error("Failed to add event, errno: {ERRNO}, rc: {RC}", "ERRNO", eno,
-              "RC", r);
-        throw std::system_error(eno, std::system_category());
-    }
-    timeChangeEventSource.reset(es);
+    queue.push_back({time, transition});
+    std::push_heap(queue.begin(), queue.end(), laterEntry);
 }
 
-ScheduledHostTransition::~ScheduledHostTransition()
+void ScheduledHostTransition::queueTransition(uint64_t time,
+                                              Transition transition)
 {
-    close(timeFd);
+    if (seconds(time) < getTime())
+    {
+        error("Queued transition time {TIME} is earlier than current time",
+              "TIME", time);
+        elog<InvalidTimeError>(
+            InvalidTime::REASON("Scheduled time is in the past"));
+    }
+
+    info("Queued transition to {TRANSITION} at {TIME}", "TRANSITION",
+         convertForMessage(transition), "TIME", time);
+    addScheduledTransition(time, transition);
+    armTimer();
+    serializeScheduledValues();
 }
 
-void ScheduledHostTransition::handleTimeUpdates()
+void ScheduledHostTransition::clearTransitions()
+{
+    info("Clearing {COUNT} queued transitions", "COUNT", queue.size());
+    queue.clear();
+    armTimer();
+    serializeScheduledValues();
+}
+
+bool ScheduledHostTransition::runDueTransitions()
 {
-    // Stop the timer if it's running.
-    // Don't return directly when timer is stopped, because the timer is always
-    // disabled after the BMC is rebooted.
-    if (timer.isEnabled())
+    auto now = static_cast<uint64_t>(getTime().count());
+
+    // Take all of the due transitions, in order, off the queue. Only the
+    // latest one needs to be done.
+    std::vector<ScheduledEntry> due;
+    while (!queue.empty() && (queue.front().time <= now))
     {
-        timer.setEnabled(false);
+        std::pop_heap(queue.begin(), queue.end(), laterEntry);
+        due.push_back(queue.back());
+        queue.pop_back();
     }
 
-    // Get scheduled time
+    // The scheduled time is due along with them, its transition is read
+    // now so a change after the time was set is honored
+    std::optional<uint64_t> dueTime;
+    auto transition = due.empty() ? Transition::On : due.back().transition;
     auto schedTime = HostTransition::scheduledTime();
+    if ((schedTime != 0) && (schedTime <= now))
+    {
+        dueTime = schedTime;
+        if (due.empty() || (schedTime >= due.back().time))
+        {
+            transition = HostTransition::scheduledTransition();
+        }
+    }
 
-    if (schedTime == 0)
+    if (due.empty() && !dueTime)
     {
-        debug(
-            "handleTimeUpdates: The function Scheduled Host Transition is disabled.");
-        return;
+        return false;
+    }
+
+    auto count = due.size() + (dueTime ? 1 : 0);
+    if (count > 1)
+    {
+        info("Skipping {COUNT} scheduled transitions superseded by a later one",
+             "COUNT", count - 1);
     }
 
-    auto deltaTime = seconds(schedTime) - getTime();
-    if (deltaTime <= seconds(0))
+    try
     {
-        try
+        hostTransition(transition);
+    }
+    catch (...)
+    {
+        // Put them back so they are retried
+        for (const auto& entry : due)
         {
-            hostTransition();
+            addScheduledTransition(entry.time, entry.transition);
         }
-        catch (const sdbusplus::exception_t& e)
+        hostService.clear();
+        throw;
+    }
+    inFlight = std::move(due);
+    inFlightTime = dueTime;
+    return true;
+}
+
+void ScheduledHostTransition::armTimer()
+{
+    // The scheduled time is left out while it is being requested
+    std::optional<uint64_t> next;
+    auto schedTime = HostTransition::scheduledTime();
+    if ((schedTime != 0) && (inFlightTime != schedTime))
+    {
+        next = schedTime;
+    }
+    if (!queue.empty() && (!next || (queue.front().time < *next)))
+    {
+        next = queue.front().time;
+    }
+
+    if (!next)
+    {
+        scheduler.cancel(id);
+        return;
+    }
+
+    // Get called back to do host transition at scheduled time
+    scheduler.schedule(id, *next);
+}
+
+void ScheduledHostTransition::callback()
+{
+    // The scheduler has already dropped our deadline, doDueTransitions()
+    // sets the one for the next pending transition or retry
+    doDueTransitions();
+}
+
+void ScheduledHostTransition::doDueTransitions()
+{
+    // transitionDone() takes over once the transition in flight completes
+    if (isInFlight())
+    {
+        return;
+    }
+
+    bool requested = false;
+    try
+    {
+        requested = runDueTransitions();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Failed to request scheduled transition: {ERROR}", "ERROR", e);
+        if (isRetryable(e.name(), e.get_errno()))
         {
-            // If error indicates BMC is not at Ready error then reschedule for
-            // 60s later
-            if ((e.name() != nullptr) &&
-                (e.name() ==
-                 std::string_view(
-                     "xyz.openbmc_project.State.Host.Error.BMCNotReady")))
-            {
-                warning(
-                    "BMC is not at ready, reschedule transition request for 60s");
-                timer.restart(seconds(60));
-                return;
-            }
-            else
-            {
-                throw;
-            }
+            retryTransition();
+            return;
         }
-        // Set scheduledTime to 0 to disable host transition and update
-        // scheduled values
-        scheduledTime(0);
+
+        auto dropped = dropDueTransitions();
+        error("Abandoning {COUNT} scheduled transitions", "COUNT", dropped);
+        return;
     }
-    else
+    catch (const std::exception& e)
+    {
+        // The mapper has no host state manager yet
+        error("Failed to request scheduled transition: {ERROR}", "ERROR", e);
+        retryTransition();
+        return;
+    }
+
+    if (!requested)
     {
-        // Start a timer to do host transition at scheduled time
-        timer.restart(deltaTime);
+        stopRetry();
     }
+
+    // Schedule the next pending transition
+    armTimer();
 }
 
-int ScheduledHostTransition::onTimeChange(sd_event_source* /* es */, int fd,
-                                          uint32_t /* revents */,
-                                          void* userdata)
+void ScheduledHostTransition::retryTransition()
 {
-    auto schedHostTran = static_cast<ScheduledHostTransition*>(userdata);
+    auto now = getTime();
+    auto elapsed = monotonicNow() - retryStart;
 
-    std::array<char, 64> time{};
+    if (!retryDelay)
+    {
+        retryStart = monotonicNow();
+        elapsed = {};
+        retryDelay = retryInitialDelay;
+
+        // Don't wait for the next retry if the BMC becomes ready first
+        bmcStateChangeSignal = std::make_unique<sdbusplus::bus::match_t>(
+            bus,
+            sdbusplus::bus::match::rules::propertiesChanged(
+                "/xyz/openbmc_project/state/bmc0",
+                "xyz.openbmc_project.State.BMC"),
+            [this](sdbusplus::message_t& msg) { bmcStateChangeEvent(msg); });
+    }
+    else
+    {
+        retryDelay = std::min(*retryDelay * 2, retryMaxDelay);
+    }
 
-    // We are not interested in the data here.
-    // So read until there is no new data here in the FD
-    while (read(fd, time.data(), time.max_size()) > 0)
-        ;
+    if (elapsed >= retryDeadline)
+    {
+        auto dropped = dropDueTransitions();
+        error(
+            "Scheduled transition failed for {SECONDS}s, abandoning {COUNT} scheduled transitions",
+            "SECONDS", duration_cast<seconds>(elapsed).count(), "COUNT",
+            dropped);
+        return;
+    }
 
-    debug("BMC system time is changed");
-    schedHostTran->handleTimeUpdates();
+    // Spread out the retries by up to a quarter of the delay either way
+    auto spread = retryDelay->count() / 4;
+    std::uniform_int_distribution<seconds::rep> jitter(-spread, spread);
+    auto delay = *retryDelay + seconds(jitter(retryRandom));
 
-    return 0;
+    warning("Scheduled transition failed, retry transition request in "
+            "{SECONDS}s",
+        "SECONDS", delay.count());
+    scheduler.schedule(id, static_cast<uint64_t>((now + delay).count()));
 }
 
-void ScheduledHostTransition::serializeScheduledValues()
+size_t ScheduledHostTransition::dropDueTransitions()
 {
-    fs::path path{SCHEDULED_HOST_TRANSITION_PERSIST_PATH};
-    std::ofstream os(path.c_str(), std::ios::binary);
-    cereal::JSONOutputArchive oarchive(os);
+    auto now = static_cast<uint64_t>(getTime().count());
+
+    size_t dropped = 0;
+    while (!queue.empty() && (queue.front().time <= now))
+    {
+        std::pop_heap(queue.begin(), queue.end(), laterEntry);
+        queue.pop_back();
+        dropped++;
+    }
+
+    auto schedTime = HostTransition::scheduledTime();
+    if ((schedTime != 0) && (schedTime <= now))
+    {
+        HostTransition::scheduledTime(0);
+        dropped++;
+    }
+
+    stopRetry();
+    armTimer();
+    serializeScheduledValues();
+    return dropped;
+}
 
-    oarchive(HostTransition::scheduledTime(),
-             HostTransition::scheduledTransition());
+void ScheduledHostTransition::stopRetry()
+{
+    retryDelay.reset();
+    bmcStateChangeSignal.reset();
 }
 
-bool ScheduledHostTransition::deserializeScheduledValues(uint64_t& time,
-                                                         Transition& trans)
+void ScheduledHostTransition::bmcStateChangeEvent(sdbusplus::message_t& msg)
 {
-    fs::path path{SCHEDULED_HOST_TRANSITION_PERSIST_PATH};
+    std::string statusInterface;
+    std::map<std::string, std::variant<std::string, uint64_t>> msgData;
+    msg.read(statusInterface, msgData);
 
-    try
+    auto propertyMap = msgData.find("CurrentBMCState");
+    if (propertyMap == msgData.end())
     {
-        if (fs::exists(path))
-        {
-            std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
-            cereal::JSONInputArchive iarchive(is);
-            iarchive(time, trans);
-            return true;
-        }
+        return;
     }
-    catch (const std::exception& e)
+
+    auto state = std::get_if<std::string>(&propertyMap->second);
+    if ((state != nullptr) &&
+        (*state == "xyz.openbmc_project.State.BMC.BMCState.Ready"))
+    {
+        // Retry from the scheduler rather than from within this signal
+        // callback, the retry may remove this match
+        info("BMC is ready, retrying scheduled transition");
+        scheduler.schedule(id, static_cast<uint64_t>(getTime().count()));
+    }
+}
+
+ScheduledHostTransition::~ScheduledHostTransition()
+{
+    scheduler.removeHost(id);
+}
+
+void ScheduledHostTransition::handleTimeUpdates()
+{
+    // Drop the deadline if there is one.
+    // Don't return directly when there isn't, because there is never one
+    // after the BMC is rebooted.
+    scheduler.cancel(id);
+
+    if (queue.empty() && (HostTransition::scheduledTime() == 0))
     {
-        error("deserialize exception: {ERROR}", "ERROR", e);
-        fs::remove(path);
+        debug(
+            "handleTimeUpdates: The function Scheduled Host Transition is disabled.");
+        return;
     }
 
-    return false;
+    doDueTransitions();
+}
+
+void ScheduledHostTransition::serializeScheduledValues()
+{
+    scheduler.storeTransitions(id, {{HostTransition::scheduledTime(),
+                                     HostTransition::scheduledTransition()},
+                                    queue});
+
+    // The queue may have changed along with them
+    if (queueInterface)
+    {
+        queueInterface->property_changed("Transitions");
+    }
 }
 
 void ScheduledHostTransition::restoreScheduledValues()
 {
-    uint64_t time;
-    Transition trans;
-    if (!deserializeScheduledValues(time, trans))
+    auto stored = scheduler.getStoredTransitions(id);
+    if (!stored)
     {
         // set to default value
         HostTransition::scheduledTime(0);
@@ -304,14 +527,103 @@ void ScheduledHostTransition::restoreScheduledValues()
     }
     else
     {
-        HostTransition::scheduledTime(time);
-        HostTransition::scheduledTransition(trans);
+        HostTransition::scheduledTime(stored->scheduled.time);
+        HostTransition::scheduledTransition(stored->scheduled.transition);
+        queue = std::move(stored->queue);
+        std::make_heap(queue.begin(), queue.end(), laterEntry);
         // Rebooting BMC is something like the BMC time is changed,
         // so go on with the same process as BMC time changed.
         handleTimeUpdates();
     }
 }
 
+const sdbusplus::vtable_t ScheduledHostTransition::queueVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method("AddTransition", "ts", "", addTransitionMethod),
+    sdbusplus::vtable::method("ClearTransitions", "", "",
+                              clearTransitionsMethod),
+    sdbusplus::vtable::property("Transitions", "a(ts)", getTransitions,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::end()};
+
+int ScheduledHostTransition::addTransitionMethod(sd_bus_message* msg,
+                                                 void* userdata,
+                                                 sd_bus_error* error)
+{
+    auto& host = *static_cast<ScheduledHostTransition*>(userdata);
+
+    try
+    {
+        sdbusplus::message_t call{msg};
+        uint64_t time;
+        std::string transition;
+        call.read(time, transition);
+
+        host.queueTransition(
+            time, HostState::convertTransitionFromString(transition));
+
+        auto reply = call.new_method_return();
+        reply.method_return();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+    return 1;
+}
+
+int ScheduledHostTransition::clearTransitionsMethod(sd_bus_message* msg,
+                                                    void* userdata,
+                                                    sd_bus_error* error)
+{
+    auto& host = *static_cast<ScheduledHostTransition*>(userdata);
+
+    try
+    {
+        host.clearTransitions();
+
+        sdbusplus::message_t call{msg};
+        auto reply = call.new_method_return();
+        reply.method_return();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+    return 1;
+}
+
+int ScheduledHostTransition::getTransitions(
+    sd_bus* /* bus */, const char* /* path */, const char* /* interface */,
+    const char* property, sd_bus_message* reply, void* userdata,
+    sd_bus_error* /* error */)
+{
+    const auto& host = *static_cast<const ScheduledHostTransition*>(userdata);
+
+    auto entries = host.queue;
+    std::sort_heap(entries.begin(), entries.end(), laterEntry);
+
+    // sort_heap leaves the latest first
+    std::vector<std::tuple<uint64_t, std::string>> transitions;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        transitions.emplace_back(it->time, convertForMessage(it->transition));
+    }
+
+    try
+    {
+        sdbusplus::message_t msg{reply};
+        msg.append(transitions);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Failed to get {PROPERTY}: {ERROR}", "PROPERTY", property,
+              "ERROR", e);
+        return -EIO;
+    }
+    return 1;
+}
+
 } // namespace manager
 } // namespace state
 } // namespace phosphor
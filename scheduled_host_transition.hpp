@@ -2,11 +2,21 @@
 
 #include "config.h"
 
+#include "host_transition_scheduler.hpp"
+
 #include <sdbusplus/bus.hpp>
-#include <sdeventplus/event.hpp>
-#include <sdeventplus/utility/timer.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
 #include <xyz/openbmc_project/State/ScheduledHostTransition/server.hpp>
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
 class TestScheduledHostTransition;
 
 namespace phosphor
@@ -16,8 +26,6 @@ namespace state
 namespace manager
 {
 
-using Transition =
-    sdbusplus::xyz::openbmc_project::State::server::Host::Transition;
 using ScheduledHostTransitionInherit = sdbusplus::server::object_t<
     sdbusplus::xyz::openbmc_project::State::server::ScheduledHostTransition>;
 
@@ -30,25 +38,35 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
 {
   public:
     ScheduledHostTransition(sdbusplus::bus_t& bus, const char* objPath,
-                            size_t id, const sdeventplus::Event& event) :
+                            size_t id, HostTransitionScheduler& scheduler) :
         ScheduledHostTransitionInherit(
             bus, objPath, ScheduledHostTransition::action::defer_emit),
-        bus(bus), id(id), event(event),
-        timer(event, [this](auto&) { callback(); })
+        bus(bus), id(id), scheduler(scheduler)
     {
-        initialize();
+        scheduler.addHost(id, *this);
 
         restoreScheduledValues();
 
+        queueInterface = std::make_unique<sdbusplus::server::interface_t>(
+            bus, objPath, queueIntf, queueVtable, this);
+
         // We deferred this until we could get our property correct
         this->emit_object_added();
     }
 
     ~ScheduledHostTransition();
 
+    using HostTransition =
+        sdbusplus::xyz::openbmc_project::State::server::ScheduledHostTransition;
+    using HostTransition::scheduledTime;
+    using HostTransition::scheduledTransition;
+
     /**
      * @brief Handle with scheduled time
      *
+     * Replaces the scheduled time, the scheduled transition is read when it
+     * is due. The transitions of the queue interface are not affected.
+     *
      * @param[in] value - The seconds since epoch
      * @return The time for the transition. It is the same as the input value if
      * it is set successfully. Otherwise, it won't return value, but throw an
@@ -56,8 +74,27 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
      **/
     uint64_t scheduledTime(uint64_t value) override;
 
+    /**
+     * @brief Handle with scheduled transition
+     *
+     * @param[in] value - The transition to request at the scheduled time
+     * @return The transition
+     **/
+    Transition scheduledTransition(Transition value) override;
+
   private:
     friend class TestScheduledHostTransition;
+    friend class HostTransitionScheduler;
+
+    /** @brief Heap comparison, puts the earliest entry at the front */
+    static bool laterEntry(const ScheduledEntry& a, const ScheduledEntry& b)
+    {
+        return a.time > b.time;
+    }
+
+    /** @brief Transitions of the queue interface, a min-heap ordered by
+     *         time */
+    std::vector<ScheduledEntry> queue;
 
     /** @brief sdbusplus bus client connection */
     sdbusplus::bus_t& bus;
@@ -65,14 +102,57 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
     /** @brief Host id. **/
     const size_t id = 0;
 
-    /** @brief sdbusplus event */
-    const sdeventplus::Event& event;
+    /** @brief Scheduler which calls back this host when it is due */
+    HostTransitionScheduler& scheduler;
+
+    /** @brief First delay before retrying a transition the BMC was not
+     *         ready for */
+    static constexpr std::chrono::seconds retryInitialDelay{5};
+
+    /** @brief Longest delay between retries */
+    static constexpr std::chrono::seconds retryMaxDelay{60};
+
+    /** @brief Time after which a transition is abandoned if the BMC is still
+     *         not ready */
+    static constexpr std::chrono::seconds retryDeadline{
+        std::chrono::minutes(30)};
+
+    /** @brief Delay before the next retry, unset when not retrying */
+    std::optional<std::chrono::seconds> retryDelay;
 
-    /** @brief Timer used for host transition with seconds */
-    sdeventplus::utility::Timer<sdeventplus::ClockId::RealTime> timer;
+    /** @brief Time of the first attempt the BMC was not ready for, on the
+     *         monotonic clock so a BMC time change doesn't affect it */
+    std::chrono::steady_clock::time_point retryStart;
 
-    /** @brief The fd for time change event */
-    int timeFd = -1;
+    /** @brief Monotonic clock the retry deadline is measured with
+     *  @note This is replaced for unit testing purposes */
+    std::function<std::chrono::steady_clock::time_point()> monotonicNow =
+        std::chrono::steady_clock::now;
+
+    /** @brief Random source for the retry jitter
+     *  @note This is seeded for unit testing purposes */
+    std::mt19937 retryRandom{std::random_device{}()};
+
+    /** @brief Used to retry as soon as the BMC is ready, only while
+     *         retrying */
+    std::unique_ptr<sdbusplus::bus::match_t> bmcStateChangeSignal;
+
+    /** @brief Host state manager service, looked up on first use **/
+    std::string hostService;
+
+    /** @brief Due transitions taken off the queue while the transition is
+     *         being requested */
+    std::vector<ScheduledEntry> inFlight;
+
+    /** @brief The ScheduledTime being requested, if it is due along with
+     *         the transitions in flight */
+    std::optional<uint64_t> inFlightTime;
+
+    /** @brief Outstanding RequestedHostTransition Set call */
+    std::optional<sdbusplus::slot_t> transitionCall;
+
+    /** @brief Outstanding RestartCause Set call */
+    std::optional<sdbusplus::slot_t> restartCauseCall;
 
     /** @brief Get current time
      *
@@ -82,41 +162,98 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
 
     /** @brief Implement host transition
      *
-     *  @return - Does not return anything. Error will result in exception
-     *            being thrown
+     *  Both property Sets are sent without waiting for a reply, the result
+     *  is handled by transitionDone().
+     *
+     *  @param[in] transition - The transition to request
+     *
+     *  @return - Does not return anything. Error sending the request will
+     *            result in exception being thrown
+     */
+    void hostTransition(Transition transition);
+
+    /** @brief Handle the reply to the RequestedHostTransition Set
+     *
+     *  A transition the BMC or host was not ready for, or which timed out,
+     *  is retried. Any other failure drops the due transitions.
+     *
+     *  @param[in] reply - The method reply
+     */
+    void transitionDone(sdbusplus::message_t& reply);
+
+    /** @brief Add a transition to the queue of pending transitions
+     *
+     *  @param[in] time - The seconds since epoch to do the transition
+     *  @param[in] transition - The transition to request
      */
-    void hostTransition();
+    void addScheduledTransition(uint64_t time, Transition transition);
 
-    /** @brief Used by the timer to do host transition */
+    /** @brief Add a transition to the queue from the queue interface
+     *
+     *  @param[in] time - The seconds since epoch to do the transition
+     *  @param[in] transition - The transition to request
+     *
+     *  @return - Does not return anything. A time in the past results in
+     *            InvalidTime being thrown
+     */
+    void queueTransition(uint64_t time, Transition transition);
+
+    /** @brief Drop the transitions of the queue interface */
+    void clearTransitions();
+
+    /** @brief Check if a transition request is outstanding */
+    bool isInFlight() const
+    {
+        return !inFlight.empty() || inFlightTime;
+    }
+
+    /** @brief Request the latest of the pending transitions which are due
+     *
+     *  The scheduled transition is read from its property when it is due.
+     *  Earlier due transitions are superseded by the latest and dropped.
+     *  They are put back in the queue if the transition fails.
+     *
+     *  @return - true if a transition was requested. Error will result in
+     *            exception being thrown
+     */
+    bool runDueTransitions();
+
+    /** @brief Schedule a call back for the next pending transition */
+    void armTimer();
+
+    /** @brief Used by the scheduler to do host transition */
     void callback();
 
-    /** @brief Initialize timerFd related resource */
-    void initialize();
+    /** @brief Request the due transitions and schedule the next one
+     *
+     *  If the transition could not be requested because the BMC or host
+     *  was not ready, it is retried later.
+     */
+    void doDueTransitions();
 
-    /** @brief The callback function on system time change
+    /** @brief Schedule a retry of the due transitions after a failure
      *
-     * @param[in] es - Source of the event
-     * @param[in] fd - File descriptor of the timer
-     * @param[in] revents - Not used
-     * @param[in] userdata - User data pointer
+     *  The delay doubles on each retry, with some jitter, up to
+     *  retryMaxDelay. The due transitions are dropped once retryDeadline has
+     *  passed since the first attempt.
      */
-    static int onTimeChange(sd_event_source* es, int fd, uint32_t revents,
-                            void* userdata);
+    void retryTransition();
 
-    /** @brief The deleter of sd_event_source */
-    std::function<void(sd_event_source*)> sdEventSourceDeleter =
-        [](sd_event_source* p) {
-        if (p)
-        {
-            sd_event_source_unref(p);
-        }
-    };
+    /** @brief Drop the due transitions after they failed for good and
+     *         schedule the next pending one
+     *
+     *  @return The number of transitions dropped
+     */
+    size_t dropDueTransitions();
 
-    using SdEventSource =
-        std::unique_ptr<sd_event_source, decltype(sdEventSourceDeleter)>;
+    /** @brief Reset the retry state after the due transitions are done */
+    void stopRetry();
 
-    /** @brief The event source on system time change */
-    SdEventSource timeChangeEventSource{nullptr, sdEventSourceDeleter};
+    /** @brief Retry immediately when the BMC becomes ready
+     *
+     *  @param[in] msg - Data associated with the PropertiesChanged signal
+     */
+    void bmcStateChangeEvent(sdbusplus::message_t& msg);
 
     /** @brief Handle with the process when bmc time is changed*/
     void handleTimeUpdates();
@@ -124,18 +261,49 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
     /** @brief Serialize the scheduled values */
     void serializeScheduledValues();
 
-    /** @brief Deserialize the scheduled values
+    /** @brief Restore scheduled time and requested transition from persisted
+     * store */
+    void restoreScheduledValues();
+
+    /** @brief Handle the AddTransition method of the queue interface
      *
-     *  @param[out] time - Deserialized scheduled time
-     *  @param[out] trans - Deserialized requested transition
+     * Takes the time, in seconds since epoch, and the transition to queue.
      *
-     *  @return bool - true if successful, false otherwise
+     * @param[in] msg      - The method call
+     * @param[in] userdata - The ScheduledHostTransition object
      */
-    bool deserializeScheduledValues(uint64_t& time, Transition& trans);
+    static int addTransitionMethod(sd_bus_message* msg, void* userdata,
+                                   sd_bus_error* error);
 
-    /** @brief Restore scheduled time and requested transition from persisted
-     * file */
-    void restoreScheduledValues();
+    /** @brief Handle the ClearTransitions method of the queue interface
+     *
+     * @param[in] msg      - The method call
+     * @param[in] userdata - The ScheduledHostTransition object
+     */
+    static int clearTransitionsMethod(sd_bus_message* msg, void* userdata,
+                                      sd_bus_error* error);
+
+    /** @brief Get the Transitions property of the queue interface
+     *
+     * The queued transitions as an array of (time, transition), in order.
+     *
+     * @param[in] reply    - The message to append the value to
+     * @param[in] userdata - The ScheduledHostTransition object
+     */
+    static int getTransitions(sd_bus* bus, const char* path,
+                              const char* interface, const char* property,
+                              sd_bus_message* reply, void* userdata,
+                              sd_bus_error* error);
+
+    /** @brief The queue interface, see queueTransition() */
+    static const sdbusplus::vtable_t queueVtable[];
+
+    /** @brief The queue interface name, see the README */
+    static constexpr auto queueIntf =
+        "com.ibm.State.ScheduledHostTransition.Queue";
+
+    /** @brief The queue interface on the scheduled transition object */
+    std::unique_ptr<sdbusplus::server::interface_t> queueInterface;
 };
 } // namespace manager
 } // namespace state
@@ -1,18 +1,22 @@
 #include "config.h"
 
+#include "host_transition_scheduler.hpp"
 #include "scheduled_host_transition.hpp"
 
 #include <getopt.h>
 
 #include <sdbusplus/bus.hpp>
 
+#include <algorithm>
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
+#include <memory>
+#include <vector>
 
 int main(int argc, char** argv)
 {
-    size_t hostId = 0;
+    std::vector<size_t> hostIds;
 
     int arg;
     int optIndex = 0;
@@ -25,13 +29,20 @@ int main(int argc, char** argv)
         switch (arg)
         {
             case 'h':
-                hostId = std::stoul(optarg);
+                hostIds.push_back(std::stoul(optarg));
                 break;
             default:
                 break;
         }
     }
 
+    // Serve host 0 by default. The service instance is the host, --host can
+    // be added once for each other host to serve from the same process
+    if (hostIds.empty())
+    {
+        hostIds.push_back(0);
+    }
+
     namespace fs = std::filesystem;
 
     // Get a default event loop
@@ -40,32 +51,59 @@ int main(int argc, char** argv)
     // Get a handle to system dbus
     auto bus = sdbusplus::bus::new_default();
 
-    // For now, we only have one instance of the host
-    auto objPathInst = std::string{HOST_SCHED_OBJPATH} + std::to_string(hostId);
+    // The process serving host 0 keeps SCHEDULED_HOST_TRANSITION_PERSIST_PATH,
+    // any other instance of the service gets its own file so they don't
+    // overwrite each other's transitions
+    bool servesHost0 = std::find(hostIds.begin(), hostIds.end(), 0) !=
+                       hostIds.end();
+    fs::path persistPath{SCHEDULED_HOST_TRANSITION_PERSIST_PATH};
+    if (!servesHost0)
+    {
+        persistPath += std::to_string(hostIds.front());
+    }
 
     // Check SCHEDULED_HOST_TRANSITION_PERSIST_PATH
-    auto dir = fs::path(SCHEDULED_HOST_TRANSITION_PERSIST_PATH).parent_path();
+    auto dir = persistPath.parent_path();
     if (!fs::exists(dir))
     {
         fs::create_directories(dir);
     }
 
-    // Add sdbusplus ObjectManager.
-    sdbusplus::server::manager_t objManager(bus, objPathInst.c_str());
+    // One timer, time change fd and persisted store for all of the hosts
+    phosphor::state::manager::HostTransitionScheduler scheduler(event,
+                                                                persistPath);
 
-    phosphor::state::manager::ScheduledHostTransition manager(
-        bus, objPathInst.c_str(), hostId, event);
+    std::vector<std::unique_ptr<sdbusplus::server::manager_t>> objManagers;
+    std::vector<
+        std::unique_ptr<phosphor::state::manager::ScheduledHostTransition>>
+        managers;
+    for (auto hostId : hostIds)
+    {
+        auto objPathInst = std::string{HOST_SCHED_OBJPATH} +
+                           std::to_string(hostId);
+
+        // Add sdbusplus ObjectManager.
+        objManagers.emplace_back(std::make_unique<sdbusplus::server::manager_t>(
+            bus, objPathInst.c_str()));
+
+        managers.emplace_back(
+            std::make_unique<phosphor::state::manager::ScheduledHostTransition>(
+                bus, objPathInst.c_str(), hostId, scheduler));
+    }
 
     // For backwards compatibility, request a busname without host id if
-    // input id is 0.
-    if (hostId == 0)
+    // host 0 is served
+    if (servesHost0)
     {
         bus.request_name(SCHEDULED_HOST_TRANSITION_BUSNAME);
     }
 
-    bus.request_name((std::string{SCHEDULED_HOST_TRANSITION_BUSNAME} +
-                      std::to_string(hostId))
-                         .c_str());
+    for (auto hostId : hostIds)
+    {
+        bus.request_name((std::string{SCHEDULED_HOST_TRANSITION_BUSNAME} +
+                          std::to_string(hostId))
+                             .c_str());
+    }
 
     // Attach the bus to sd_event to service user requests
     bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
@@ -2,7 +2,13 @@
 
 #include "utils.hpp"
 
+#include <systemd/sd-bus.h>
+
+#include <nlohmann/json.hpp>
 #include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
 
 #include <filesystem>
 #include <fstream>
@@ -12,61 +18,112 @@ PHOSPHOR_LOG2_USING;
 
 constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
 
+// Not a phosphor-dbus-interfaces interface, see the README
+constexpr auto SECURITY_POSTURE_BUSNAME = "com.ibm.State.SecurityPosture";
+constexpr auto SECURITY_POSTURE_OBJPATH = "/com/ibm/state/security_posture";
+constexpr auto SECURITY_POSTURE_INTERFACE = "com.ibm.State.SecurityPosture";
+
+/** @brief The security settings of the BMC found when it booted */
+struct SecurityPosture
+{
+    /** @brief The bmc-secure-boot gpio, -1 if it can not be read */
+    int secureBootGpio = -1;
+
+    /** @brief The secure_boot sysfs value, -1 if it can not be read */
+    int secureBoot = -1;
+
+    /** @brief The abr_image sysfs value, -1 if it can not be read */
+    int abrImage = -1;
+
+    /** @brief NotPresent, Missing, Empty, Invalid or Valid */
+    std::string tpmMeasurement = "NotPresent";
+
+    bool secure() const
+    {
+        return (secureBootGpio == 1) && (secureBoot == 1) && (abrImage == 0);
+    }
+};
+
+/** @brief Create an error log
+ *
+ * The logging service may not be up yet. Failing here would restart this
+ * service and probe the hardware again, so the error is only traced.
+ */
+void logError(
+    sdbusplus::bus_t& bus, const std::string& errorMsg,
+    sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level errLevel,
+    const std::map<std::string, std::string>& additionalData)
+{
+    try
+    {
+        phosphor::state::manager::utils::createError(bus, errorMsg, errLevel,
+                                                     additionalData);
+    }
+    catch (const std::exception& e)
+    {
+        error("Failed to log {ERROR_MSG}: {ERROR}", "ERROR_MSG", errorMsg,
+              "ERROR", e);
+    }
+}
+
 // Check if the TPM measurement file exists and has a valid value.
+std::string checkTpmMeasurement()
+{
+    if (!std::filesystem::exists(std::string(SYSFS_TPM_MEASUREMENT_PATH)))
+    {
+        return "Missing";
+    }
+
+    std::string tpmValueStr;
+    std::ifstream tpmFile(std::string(SYSFS_TPM_MEASUREMENT_PATH));
+
+    tpmFile >> tpmValueStr;
+    if (tpmValueStr.empty())
+    {
+        return "Empty";
+    }
+    if (tpmValueStr == "0")
+    {
+        return "Invalid";
+    }
+    return "Valid";
+}
+
 // If the TPM measurement is invalid, it logs an error message.
-void checkTpmMeasurement()
+void logTpmMeasurement(sdbusplus::bus_t& bus, const std::string& status)
 {
-    bool tpmError = false;
     std::string errorMsg;
-    if (!std::filesystem::exists(std::string(SYSFS_TPM_MEASUREMENT_PATH)))
+    if (status == "Missing")
+    {
+        errorMsg = "TPM measurement file does not exist: ";
+    }
+    else if (status == "Empty")
+    {
+        errorMsg = "TPM measurement value is empty: ";
+    }
+    else if (status == "Invalid")
     {
-        tpmError = true;
-        errorMsg = "TPM measurement file does not exist: " +
-                   std::string(SYSFS_TPM_MEASUREMENT_PATH);
+        errorMsg = "TPM measurement value is 0: ";
     }
     else
     {
-        std::string tpmValueStr;
-        std::ifstream tpmFile(std::string(SYSFS_TPM_MEASUREMENT_PATH));
-
-        tpmFile >> tpmValueStr;
-        if (tpmValueStr.empty())
-        {
-            tpmError = true;
-            errorMsg = "TPM measurement value is empty: " +
-                       std::string(SYSFS_TPM_MEASUREMENT_PATH);
-        }
-        else if (tpmValueStr == "0")
-        {
-            tpmError = true;
-            errorMsg = "TPM measurement value is 0: " +
-                       std::string(SYSFS_TPM_MEASUREMENT_PATH);
-        }
-        tpmFile.close();
+        return;
     }
+    errorMsg += SYSFS_TPM_MEASUREMENT_PATH;
 
-    if (tpmError)
-    {
-        // Doesn't have valid TPM measurement, log an error message
-        std::map<std::string, std::string> additionalData;
-        error("{ERROR}", "ERROR", errorMsg);
-        additionalData.emplace("ERROR", errorMsg);
-        auto bus = sdbusplus::bus::new_default();
-        phosphor::state::manager::utils::createError(
-            bus, "xyz.openbmc_project.State.Error.TpmMeasurementFail",
-            sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level::
-                Error,
-            additionalData);
-    }
-    return;
+    // Doesn't have valid TPM measurement, log an error message
+    error("{ERROR}", "ERROR", errorMsg);
+    logError(bus, "xyz.openbmc_project.State.Error.TpmMeasurementFail",
+             sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level::
+                 Error,
+             {{"ERROR", errorMsg}});
 }
 
 // Utilize the QuiesceOnHwError setting as an indication that the system
 // is operating in an environment where the user should be notified of
 // security settings (i.e. "Manufacturing")
-bool isMfgModeEnabled()
+bool isMfgModeEnabled(sdbusplus::bus_t& bus)
 {
-    auto bus = sdbusplus::bus::new_default();
     std::string path = "/xyz/openbmc_project/logging/settings";
     std::string interface = "xyz.openbmc_project.Logging.Settings";
     std::string propertyName = "QuiesceOnHwError";
@@ -95,16 +152,52 @@ bool isMfgModeEnabled()
     return std::get<bool>(mfgModeEnabled);
 }
 
-int main()
+/** @brief Read an integer from a sysfs file
+ *
+ * @return The value, or -1 if the file is not present or can not be read
+ */
+int readSysfsValue(const char* path, const char* name)
+{
+    if (!std::filesystem::exists(path))
+    {
+        info("sysfs file {NAME} not present", "NAME", name);
+        return -1;
+    }
+
+    std::string dbgVal;
+    std::ifstream dbgFile;
+    dbgFile.exceptions(std::ifstream::failbit | std::ifstream::badbit |
+                       std::ifstream::eofbit);
+    try
+    {
+        dbgFile.open(path);
+        dbgFile >> dbgVal;
+        dbgFile.close();
+        info("Read {VALUE} from {NAME}", "VALUE", dbgVal, "NAME", name);
+        return std::stoi(dbgVal);
+    }
+    catch (const std::exception& e)
+    {
+        error("Failed to read {NAME} sysfs file: {ERROR}", "NAME", name,
+              "ERROR", e);
+        // just continue and error will be logged at end if in mfg mode
+        return -1;
+    }
+}
+
+/** @brief Probe the security settings of the BMC */
+SecurityPosture collectPosture()
 {
+    SecurityPosture posture;
+
     // Read the secure boot gpio
-    auto secureBootGpio =
+    posture.secureBootGpio =
         phosphor::state::manager::utils::getGpioValue("bmc-secure-boot");
-    if (secureBootGpio == -1)
+    if (posture.secureBootGpio == -1)
     {
         debug("bmc-secure-boot gpio not present or can not be read");
     }
-    else if (secureBootGpio == 0)
+    else if (posture.secureBootGpio == 0)
     {
         info("bmc-secure-boot gpio found and indicates it is NOT enabled");
     }
@@ -114,83 +207,169 @@ int main()
     }
 
     // Now read the /sys/kernel/debug/aspeed/ files
-    std::string dbgVal;
-    std::ifstream dbgFile;
-    int secureBootVal = -1;
-    int abrImage = -1;
+    posture.secureBoot = readSysfsValue(SYSFS_SECURE_BOOT_PATH, "secure_boot");
+    posture.abrImage = readSysfsValue(SYSFS_ABR_IMAGE_PATH, "abr_image");
 
-    dbgFile.exceptions(std::ifstream::failbit | std::ifstream::badbit |
-                       std::ifstream::eofbit);
+    // Check the TPM measurement if TPM is enabled
+    if (std::filesystem::exists(std::string(SYSFS_TPM_DEVICE_PATH)))
+    {
+        posture.tpmMeasurement = checkTpmMeasurement();
+    }
+
+    return posture;
+}
 
-    if (std::filesystem::exists(SYSFS_SECURE_BOOT_PATH))
-    {
-        try
-        {
-            dbgFile.open(SYSFS_SECURE_BOOT_PATH);
-            dbgFile >> dbgVal;
-            dbgFile.close();
-            info("Read {SECURE_BOOT_VAL} from secure_boot", "SECURE_BOOT_VAL",
-                 dbgVal);
-            secureBootVal = std::stoi(dbgVal);
-        }
-        catch (std::exception& e)
-        {
-            error("Failed to read secure boot sysfs file: {ERROR}", "ERROR", e);
-            // just continue and error will be logged at end if in mfg mode
-        }
+/** @brief Log the security settings of the BMC which fail */
+void logPosture(sdbusplus::bus_t& bus, const SecurityPosture& posture)
+{
+    bool mfgMode = false;
+    try
+    {
+        mfgMode = isMfgModeEnabled(bus);
     }
-    else
+    catch (const std::exception& e)
     {
-        info("sysfs file secure_boot not present");
+        // Still publish what was found
+        error("Unable to determine manufacturing mode: {ERROR}", "ERROR", e);
     }
 
-    if (std::filesystem::exists(SYSFS_ABR_IMAGE_PATH))
+    if (mfgMode && !posture.secure())
     {
-        try
-        {
-            dbgFile.open(SYSFS_ABR_IMAGE_PATH);
-            dbgFile >> dbgVal;
-            dbgFile.close();
-            info("Read {ABR_IMAGE_VAL} from abr_image", "ABR_IMAGE_VAL",
-                 dbgVal);
-            abrImage = std::stoi(dbgVal);
-        }
-        catch (std::exception& e)
-        {
-            error("Failed to read abr image sysfs file: {ERROR}", "ERROR", e);
-            // just continue and error will be logged at end if in mfg mode
-        }
+        error("The system is not secure");
+        std::map<std::string, std::string> additionalData;
+        additionalData.emplace("SECURE_BOOT_GPIO",
+                               std::to_string(posture.secureBootGpio));
+        additionalData.emplace("SYSFS_SECURE_BOOT_VAL",
+                               std::to_string(posture.secureBoot));
+        additionalData.emplace("SYSFS_ABR_IMAGE_VAL",
+                               std::to_string(posture.abrImage));
+
+        logError(bus, "xyz.openbmc_project.State.Error.SecurityCheckFail",
+                 sdbusplus::xyz::openbmc_project::Logging::server::Entry::
+                     Level::Warning,
+                 additionalData);
     }
-    else
+
+    logTpmMeasurement(bus, posture.tpmMeasurement);
+}
+
+/** @brief Load the posture collected earlier in this boot
+ *
+ * The hardware does not change until the BMC reboots, so a restart of this
+ * service neither probes it again nor logs the same errors twice.
+ */
+bool loadPosture(SecurityPosture& posture)
+{
+    std::ifstream file(SECURITY_POSTURE_FILE);
+    if (!file)
     {
-        info("sysfs file abr_image not present");
+        return false;
     }
 
-    if (isMfgModeEnabled())
+    try
+    {
+        auto data = nlohmann::json::parse(file);
+        posture.secureBootGpio = data.at("SecureBootGpio").get<int>();
+        posture.secureBoot = data.at("SecureBoot").get<int>();
+        posture.abrImage = data.at("AbrImage").get<int>();
+        posture.tpmMeasurement =
+            data.at("TpmMeasurement").get<std::string>();
+        return true;
+    }
+    catch (const nlohmann::json::exception& e)
     {
-        if ((secureBootGpio != 1) || (secureBootVal != 1) || (abrImage != 0))
-        {
-            error("The system is not secure");
-            std::map<std::string, std::string> additionalData;
-            additionalData.emplace("SECURE_BOOT_GPIO",
-                                   std::to_string(secureBootGpio));
-            additionalData.emplace("SYSFS_SECURE_BOOT_VAL",
-                                   std::to_string(secureBootVal));
-            additionalData.emplace("SYSFS_ABR_IMAGE_VAL",
-                                   std::to_string(abrImage));
+        error("Invalid security posture file: {ERROR}", "ERROR", e);
+        return false;
+    }
+}
+
+void storePosture(const SecurityPosture& posture)
+{
+    nlohmann::json data{{"SecureBootGpio", posture.secureBootGpio},
+                        {"SecureBoot", posture.secureBoot},
+                        {"AbrImage", posture.abrImage},
+                        {"TpmMeasurement", posture.tpmMeasurement},
+                        {"Secure", posture.secure()}};
 
-            auto bus = sdbusplus::bus::new_default();
-            phosphor::state::manager::utils::createError(
-                bus, "xyz.openbmc_project.State.Error.SecurityCheckFail",
-                sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level::
-                    Warning,
-                additionalData);
-        }
+    std::error_code ec;
+    std::filesystem::create_directories(BASE_FILE_DIR, ec);
+    std::ofstream file(SECURITY_POSTURE_FILE);
+    file << data;
+    if (!file)
+    {
+        error("Failed to write {FILE}", "FILE", SECURITY_POSTURE_FILE);
     }
-    // Check the TPM measurement if TPM is enabled
-    if (std::filesystem::exists(std::string(SYSFS_TPM_DEVICE_PATH)))
+}
+
+int getPostureProperty(sd_bus* /* bus */, const char* /* path */,
+                       const char* /* interface */, const char* property,
+                       sd_bus_message* reply, void* userdata,
+                       sd_bus_error* /* error */)
+{
+    const auto& posture = *static_cast<const SecurityPosture*>(userdata);
+    std::string name{property};
+
+    if (name == "SecureBootGpio")
+    {
+        return sd_bus_message_append(reply, "i", posture.secureBootGpio);
+    }
+    if (name == "SecureBoot")
+    {
+        return sd_bus_message_append(reply, "i", posture.secureBoot);
+    }
+    if (name == "AbrImage")
+    {
+        return sd_bus_message_append(reply, "i", posture.abrImage);
+    }
+    if (name == "TpmMeasurement")
+    {
+        return sd_bus_message_append(reply, "s",
+                                     posture.tpmMeasurement.c_str());
+    }
+    return sd_bus_message_append(reply, "b", posture.secure() ? 1 : 0);
+}
+
+// The values do not change until the BMC reboots, so clients may cache them
+constexpr auto constProperty = sdbusplus::vtable::property_::const_;
+
+constexpr sdbusplus::vtable_t postureVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("SecureBootGpio", "i", getPostureProperty,
+                                constProperty),
+    sdbusplus::vtable::property("SecureBoot", "i", getPostureProperty,
+                                constProperty),
+    sdbusplus::vtable::property("AbrImage", "i", getPostureProperty,
+                                constProperty),
+    sdbusplus::vtable::property("TpmMeasurement", "s", getPostureProperty,
+                                constProperty),
+    sdbusplus::vtable::property("Secure", "b", getPostureProperty,
+                                constProperty),
+    sdbusplus::vtable::end()};
+
+int main()
+{
+    auto bus = sdbusplus::bus::new_default();
+
+    SecurityPosture posture;
+    if (!loadPosture(posture))
+    {
+        // Stored before logging, so the errors are not logged again if
+        // this service is restarted
+        posture = collectPosture();
+        storePosture(posture);
+        logPosture(bus, posture);
+    }
+
+    sdbusplus::server::interface_t postureInterface(
+        bus, SECURITY_POSTURE_OBJPATH, SECURITY_POSTURE_INTERFACE,
+        postureVtable, &posture);
+
+    bus.request_name(SECURITY_POSTURE_BUSNAME);
+
+    while (true)
     {
-        checkTpmMeasurement();
+        bus.process_discard();
+        bus.wait();
     }
 
     return 0;
@@ -1,11 +1,16 @@
 #include "settings.hpp"
 
+#include "utils.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/exception.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <variant>
+
 namespace settings
 {
 
@@ -18,7 +23,51 @@ constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
 constexpr auto mapperPath = "/xyz/openbmc_project/object_mapper";
 constexpr auto mapperIntf = "xyz.openbmc_project.ObjectMapper";
 
-Objects::Objects(sdbusplus::bus_t& bus, const Path& root) : bus(bus)
+constexpr auto settingsService = "xyz.openbmc_project.Settings";
+
+// How long to wait for the mapper to find the settings objects, doubled
+// each time they are still not found, as some may never exist
+constexpr auto retryInterval = std::chrono::seconds(10);
+constexpr auto maxRetryInterval = std::chrono::seconds(600);
+
+constexpr auto propertyIntf = "org.freedesktop.DBus.Properties";
+
+Objects::Objects(sdbusplus::bus_t& bus, const Path& root) :
+    bus(bus), root(root)
+{
+    resolve();
+}
+
+Objects::Objects(sdbusplus::bus_t& bus, const Path& root,
+                 std::function<void()> onResolved) :
+    bus(bus), root(root), onResolved(std::move(onResolved))
+{
+    namespace rules = sdbusplus::bus::match::rules;
+
+    // The mapper may not have found the objects of a started settings
+    // service yet, which doesn't tell when it has.
+    retryTimer.emplace(sdeventplus::Event::get_default(),
+                       [this](auto&) { resolveAsync(); });
+
+    // Fetch the objects again when the settings service is (re)started, as
+    // it may not have been running yet or its objects may have changed.
+    settingsOwnerChanged = std::make_unique<sdbusplus::bus::match_t>(
+        bus, rules::nameOwnerChanged(settingsService),
+        [this](sdbusplus::message_t& msg) {
+        std::string name;
+        std::string oldOwner;
+        std::string newOwner;
+        msg.read(name, oldOwner, newOwner);
+        if (!newOwner.empty())
+        {
+            resolveAsync();
+        }
+    });
+
+    resolveAsync();
+}
+
+sdbusplus::message_t Objects::newSubTreeCall() const
 {
     std::vector<std::string> settingsIntfs = {autoRebootIntf, powerRestoreIntf};
     auto depth = 0;
@@ -28,14 +77,23 @@ Objects::Objects(sdbusplus::bus_t& bus, const Path& root) : bus(bus)
     mapperCall.append(root);
     mapperCall.append(depth);
     mapperCall.append(settingsIntfs);
+    return mapperCall;
+}
+
+void Objects::resolve()
+{
+    if (isResolved)
+    {
+        return;
+    }
 
-    using Interfaces = std::vector<Interface>;
-    using MapperResponse = std::map<Path, std::map<Service, Interfaces>>;
     MapperResponse result;
 
     try
     {
-        auto response = bus.call(mapperCall);
+        auto mapperCall = newSubTreeCall();
+        auto response =
+            phosphor::state::manager::utils::call(bus, mapperCall);
 
         response.read(result);
         if (result.empty())
@@ -50,6 +108,65 @@ Objects::Objects(sdbusplus::bus_t& bus, const Path& root) : bus(bus)
         elog<InternalFailure>();
     }
 
+    // The answer is in, the reply to an earlier call is no longer needed
+    subTreeCall.reset();
+    store(result);
+}
+
+void Objects::resolveAsync()
+{
+    auto mapperCall = newSubTreeCall();
+    subTreeCall = bus.call_async(mapperCall,
+                                 [this](sdbusplus::message_t reply) {
+        subTreeDone(reply);
+    });
+}
+
+void Objects::subTreeDone(sdbusplus::message_t& reply)
+{
+    MapperResponse result;
+    try
+    {
+        if (!reply.is_method_error())
+        {
+            reply.read(result);
+        }
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        error("Error in mapper GetSubTree: {ERROR}", "ERROR", e);
+    }
+
+    if (result.empty())
+    {
+        if (retryDelay == std::chrono::seconds::zero())
+        {
+            info("Settings objects under {ROOT} not yet available", "ROOT",
+                 root);
+            retryDelay = retryInterval;
+        }
+        else
+        {
+            retryDelay = std::min<std::chrono::seconds>(retryDelay * 2,
+                                                        maxRetryInterval);
+        }
+        if (retryTimer)
+        {
+            retryTimer->restartOnce(retryDelay);
+        }
+        return;
+    }
+
+    store(result);
+}
+
+void Objects::store(const MapperResponse& result)
+{
+    autoReboot.clear();
+    autoRebootOneTime.clear();
+    powerRestorePolicy.clear();
+    powerRestorePolicyOneTime.clear();
+
     for (const auto& iter : result)
     {
         const Path& path = iter.first;
@@ -95,11 +212,40 @@ Objects::Objects(sdbusplus::bus_t& bus, const Path& root) : bus(bus)
             }
         }
     }
+
+    services = result;
+    isResolved = true;
+
+    retryDelay = std::chrono::seconds::zero();
+    if (retryTimer)
+    {
+        retryTimer->setEnabled(false);
+    }
+
+    if (onResolved)
+    {
+        onResolved();
+    }
 }
 
-Service Objects::service(const Path& path, const Interface& interface) const
+Service Objects::service(
+    const Path& path, const Interface& interface,
+    const phosphor::state::manager::utils::Deadline* deadline) const
 {
-    using Interfaces = std::vector<Interface>;
+    // The services were found along with the objects
+    auto object = services.find(path);
+    if (object != services.end())
+    {
+        for (const auto& [service, interfaces] : object->second)
+        {
+            if (std::find(interfaces.begin(), interfaces.end(), interface) !=
+                interfaces.end())
+            {
+                return service;
+            }
+        }
+    }
+
     auto mapperCall = bus.new_method_call(mapperService, mapperPath, mapperIntf,
                                           "GetObject");
     mapperCall.append(path);
@@ -109,7 +255,9 @@ Service Objects::service(const Path& path, const Interface& interface) const
 
     try
     {
-        auto response = bus.call(mapperCall);
+        auto response = phosphor::state::manager::utils::call(
+            bus, mapperCall, phosphor::state::manager::utils::CallClass::Query,
+            deadline);
         response.read(result);
     }
     catch (const sdbusplus::exception_t& e)
@@ -127,8 +275,75 @@ Service Objects::service(const Path& path, const Interface& interface) const
     return result.begin()->first;
 }
 
+BoolSetting::BoolSetting(const Objects& objects, const Interface& interface,
+                         const std::string& property) :
+    objects(objects), interface(interface), property(property)
+{}
+
+void BoolSetting::watch(const Path& path)
+{
+    namespace rules = sdbusplus::bus::match::rules;
+
+    // The object or its service changed, so read it again
+    this->path = path;
+    value.reset();
+
+    // Subscribe before the initial read so no change can be missed
+    signal = std::make_unique<sdbusplus::bus::match_t>(
+        objects.bus, rules::propertiesChanged(path, interface),
+        [this](sdbusplus::message_t& msg) { propertiesChanged(msg); });
+
+    try
+    {
+        get();
+    }
+    catch (const std::exception& e)
+    {
+        error("Error reading {PROPERTY} of {PATH}: {ERROR}", "PROPERTY",
+              property, "PATH", path, "ERROR", e);
+    }
+}
+
+bool BoolSetting::get(const phosphor::state::manager::utils::Deadline* deadline)
+{
+    if (!value)
+    {
+        auto method = objects.bus.new_method_call(
+            objects.service(path, interface, deadline).c_str(), path.c_str(),
+            propertyIntf, "Get");
+        method.append(interface, property);
+
+        std::variant<bool> result;
+        auto reply = phosphor::state::manager::utils::call(
+            objects.bus, method,
+            phosphor::state::manager::utils::CallClass::Query, deadline);
+        reply.read(result);
+        value = std::get<bool>(result);
+    }
+    return *value;
+}
+
+void BoolSetting::propertiesChanged(sdbusplus::message_t& msg)
+{
+    std::string changedInterface;
+    std::map<std::string, std::variant<bool>> properties;
+    msg.read(changedInterface, properties);
+
+    auto changed = properties.find(property);
+    if (changed != properties.end())
+    {
+        value = std::get<bool>(changed->second);
+    }
+}
+
 HostObjects::HostObjects(sdbusplus::bus_t& bus, size_t id) :
     Objects(bus, Path("/xyz/openbmc_project/control/host") + std::to_string(id))
 {}
 
+HostObjects::HostObjects(sdbusplus::bus_t& bus, size_t id,
+                         std::function<void()> onResolved) :
+    Objects(bus, Path("/xyz/openbmc_project/control/host") + std::to_string(id),
+            std::move(onResolved))
+{}
+
 } // namespace settings
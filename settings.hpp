@@ -1,8 +1,20 @@
 #pragma once
 
+#include "utils.hpp"
+
 #include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/slot.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/utility/timer.hpp>
 
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace settings
 {
@@ -17,7 +29,7 @@ constexpr auto powerRestoreIntf =
     "xyz.openbmc_project.Control.Power.RestorePolicy";
 
 /** @class Objects
- *  @brief Fetch paths of settings d-bus objects of interest, upon construction
+ *  @brief Fetch paths of settings d-bus objects of interest
  */
 struct Objects
 {
@@ -26,24 +38,56 @@ struct Objects
      *
      * @param[in] bus  - The Dbus bus object
      * @param[in] root - The root object path
+     *
+     * @return Will throw exceptions on failure
      */
     explicit Objects(sdbusplus::bus_t& bus, const Path& root = defaultRoot);
+
+    /** @brief Constructor - fetch settings objects in the background
+     *
+     * The objects are fetched again whenever the settings service gets a
+     * new owner, and retried on a timer while the mapper does not know of
+     * them, so this does not wait for the settings service to start.
+     *
+     * @param[in] bus        - The Dbus bus object
+     * @param[in] root       - The root object path
+     * @param[in] onResolved - Called each time the objects are fetched
+     */
+    Objects(sdbusplus::bus_t& bus, const Path& root,
+            std::function<void()> onResolved);
+
     Objects(const Objects&) = delete;
     Objects& operator=(const Objects&) = delete;
     Objects(Objects&&) = delete;
     Objects& operator=(Objects&&) = delete;
     ~Objects() = default;
 
+    /** @brief Check if the settings objects have been fetched */
+    bool resolved() const
+    {
+        return isResolved;
+    }
+
+    /** @brief Fetch the settings objects now if they are not yet known
+     *
+     * @return Will throw exceptions on failure
+     */
+    void resolve();
+
     /** @brief Fetch d-bus service, given a path and an interface. The
-     *         service can't be cached because mapper returns unique
-     *         service names.
+     *         services found along with the objects are used, the mapper
+     *         is only asked for objects which were not found.
      *
      * @param[in] path - The Dbus object
      * @param[in] interface - The Dbus interface
+     * @param[in] deadline - The deadline of the operation needing it
      *
      * @return std::string - the dbus service name
      */
-    Service service(const Path& path, const Interface& interface) const;
+    Service service(
+        const Path& path, const Interface& interface,
+        const phosphor::state::manager::utils::Deadline* deadline =
+            nullptr) const;
 
     /** @brief host auto_reboot user settings object */
     Path autoReboot;
@@ -59,6 +103,127 @@ struct Objects
 
     /** @brief The Dbus bus object */
     sdbusplus::bus_t& bus;
+
+    using Interfaces = std::vector<Interface>;
+    using MapperResponse = std::map<Path, std::map<Service, Interfaces>>;
+
+    /** @brief Store the settings objects found by the mapper
+     *
+     * @note This is public for unit testing purposes
+     */
+    void store(const MapperResponse& result);
+
+    /** @brief Handle the reply of the mapper call of resolveAsync()
+     *
+     * @note This is public for unit testing purposes
+     *
+     * @param[in] reply - The reply of the mapper
+     */
+    void subTreeDone(sdbusplus::message_t& reply);
+
+    /** @brief Fetch the objects again while they are not found
+     *
+     * @note This is public for unit testing purposes
+     */
+    std::optional<sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>>
+        retryTimer;
+
+  private:
+    /** @brief Create the mapper call which finds the settings objects */
+    sdbusplus::message_t newSubTreeCall() const;
+
+    /** @brief Fetch the settings objects without waiting for them */
+    void resolveAsync();
+
+    /** @brief The root object path of the settings objects */
+    const Path root;
+
+    /** @brief The services of each settings object */
+    MapperResponse services;
+
+    /** @brief If the settings objects have been fetched */
+    bool isResolved = false;
+
+    /** @brief Called each time the objects are fetched */
+    std::function<void()> onResolved;
+
+    /** @brief The time until the objects are fetched again */
+    std::chrono::seconds retryDelay = std::chrono::seconds::zero();
+
+    /** @brief The pending mapper call */
+    std::optional<sdbusplus::slot_t> subTreeCall;
+
+    /** @brief Watch for the settings service to be started */
+    std::unique_ptr<sdbusplus::bus::match_t> settingsOwnerChanged;
+};
+
+/** @class BoolSetting
+ *  @brief A boolean property of a settings object. Its value is kept from
+ *         the PropertiesChanged signals of the object, so it is only read
+ *         over D-Bus when it is not yet known.
+ */
+class BoolSetting
+{
+  public:
+    BoolSetting(const BoolSetting&) = delete;
+    BoolSetting& operator=(const BoolSetting&) = delete;
+    BoolSetting(BoolSetting&&) = delete;
+    BoolSetting& operator=(BoolSetting&&) = delete;
+    ~BoolSetting() = default;
+
+    /** @brief Constructor
+     *
+     * @param[in] objects   - The settings objects to find the service in
+     * @param[in] interface - The Dbus interface of the property
+     * @param[in] property  - The property name
+     */
+    BoolSetting(const Objects& objects, const Interface& interface,
+                const std::string& property);
+
+    /** @brief Subscribe to changes of the property of an object and read
+     *         its value, forgetting any value of an earlier object
+     *
+     * A failure to read is only traced, it is read again by get().
+     *
+     * @param[in] path - The settings object
+     */
+    void watch(const Path& path);
+
+    /** @brief Get the value, reading it if not yet known
+     *
+     * @param[in] deadline - The deadline of the operation needing it
+     *
+     * @return The value, will throw exceptions on failure
+     */
+    bool get(const phosphor::state::manager::utils::Deadline* deadline =
+                 nullptr);
+
+    /** @brief Handle the PropertiesChanged signal of the object
+     *
+     * @note This is public for unit testing purposes
+     *
+     * @param[in] msg - The signal
+     */
+    void propertiesChanged(sdbusplus::message_t& msg);
+
+  private:
+    /** @brief The settings objects */
+    const Objects& objects;
+
+    /** @brief The Dbus interface of the property */
+    const Interface interface;
+
+    /** @brief The property name */
+    const std::string property;
+
+    /** @brief The settings object watched */
+    Path path;
+
+    /** @brief The value, once known */
+    std::optional<bool> value;
+
+    /** @brief Watch for changes to the property */
+    std::unique_ptr<sdbusplus::bus::match_t> signal;
 };
 
 /** @class HostObjects
@@ -75,6 +240,15 @@ struct HostObjects : public Objects
      * @param[in] id  - The Host id
      */
     HostObjects(sdbusplus::bus_t& bus, size_t id);
+
+    /** @brief Constructor - fetch settings objects of Host in the background
+     *
+     * @param[in] bus        - The Dbus bus object
+     * @param[in] id         - The Host id
+     * @param[in] onResolved - Called each time the objects are fetched
+     */
+    HostObjects(sdbusplus::bus_t& bus, size_t id,
+                std::function<void()> onResolved);
 };
 
 } // namespace settings
@@ -0,0 +1,554 @@
+#include "config.h"
+
+#include <CLI/CLI.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/exception.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace
+{
+
+constexpr auto MAPPER_BUSNAME = "xyz.openbmc_project.ObjectMapper";
+constexpr auto MAPPER_PATH = "/xyz/openbmc_project/object_mapper";
+constexpr auto MAPPER_INTERFACE = "xyz.openbmc_project.ObjectMapper";
+constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+
+constexpr auto STATE_OBJECT = "/xyz/openbmc_project/state";
+constexpr auto LOGGING_BUSNAME = "xyz.openbmc_project.Logging";
+constexpr auto LOGGING_OBJECT = "/xyz/openbmc_project/logging/";
+constexpr auto LOGGING_ENTRY_OBJECT = "/xyz/openbmc_project/logging/entry";
+constexpr auto BOOT_BLOCK_INTERFACE =
+    "xyz.openbmc_project.Logging.ErrorBlocksTransition";
+constexpr auto ASSOCIATION_INTERFACE =
+    "xyz.openbmc_project.Association.Definitions";
+
+/** @brief The object a state lives on, the bmc or the chassis/host instance */
+enum class StateObject
+{
+    bmc,
+    chassis,
+    host,
+};
+
+/** @brief A state property printed by the state queries */
+struct StateQuery
+{
+    const char* command;
+    StateObject object;
+    const char* interface;
+    const char* property;
+};
+
+/** @brief The state queries, in the order `state` prints them */
+constexpr std::array<StateQuery, 5> stateQueries = {{
+    {"bmcstate", StateObject::bmc, "xyz.openbmc_project.State.BMC",
+     "CurrentBMCState"},
+    {"chassisstate", StateObject::chassis, "xyz.openbmc_project.State.Chassis",
+     "CurrentPowerState"},
+    {"hoststate", StateObject::host, "xyz.openbmc_project.State.Host",
+     "CurrentHostState"},
+    {"bootprogress", StateObject::host,
+     "xyz.openbmc_project.State.Boot.Progress", "BootProgress"},
+    {"osstate", StateObject::host,
+     "xyz.openbmc_project.State.OperatingSystem.Status",
+     "OperatingSystemState"},
+}};
+
+/** @brief A requested transition and the state which confirms it */
+struct StateTransition
+{
+    const char* command;
+    const char* query;
+    const char* property;
+    const char* value;
+    const char* requestedState;
+    bool warnBootBlock;
+};
+
+constexpr std::array<StateTransition, 4> stateTransitions = {{
+    {"chassisoff", "chassisstate", "RequestedPowerTransition",
+     "xyz.openbmc_project.State.Chassis.Transition.Off",
+     "xyz.openbmc_project.State.Chassis.PowerState.Off", false},
+    {"chassison", "chassisstate", "RequestedPowerTransition",
+     "xyz.openbmc_project.State.Chassis.Transition.On",
+     "xyz.openbmc_project.State.Chassis.PowerState.On", true},
+    {"poweroff", "hoststate", "RequestedHostTransition",
+     "xyz.openbmc_project.State.Host.Transition.Off",
+     "xyz.openbmc_project.State.Host.HostState.Off", false},
+    {"poweron", "hoststate", "RequestedHostTransition",
+     "xyz.openbmc_project.State.Host.Transition.On",
+     "xyz.openbmc_project.State.Host.HostState.Running", true},
+}};
+
+using PropertyValue =
+    std::variant<std::string, bool, uint8_t, int16_t, uint16_t, int32_t,
+                 uint32_t, int64_t, uint64_t, double, std::vector<std::string>>;
+using PropertyMap = std::map<std::string, PropertyValue>;
+
+/** @brief Object path to service to interfaces, as returned by GetSubTree */
+using SubTree =
+    std::map<std::string, std::map<std::string, std::vector<std::string>>>;
+
+using Associations =
+    std::vector<std::tuple<std::string, std::string, std::string>>;
+
+const StateQuery* findQuery(const std::string& command)
+{
+    for (const auto& query : stateQueries)
+    {
+        if (command == query.command)
+        {
+            return &query;
+        }
+    }
+    return nullptr;
+}
+
+const StateTransition* findTransition(const std::string& command)
+{
+    for (const auto& transition : stateTransitions)
+    {
+        if (command == transition.command)
+        {
+            return &transition;
+        }
+    }
+    return nullptr;
+}
+
+std::string getObjectPath(StateObject object, size_t id)
+{
+    switch (object)
+    {
+        case StateObject::bmc:
+            return std::string{STATE_OBJECT} + "/bmc0";
+        case StateObject::chassis:
+            return std::string{STATE_OBJECT} + "/chassis" + std::to_string(id);
+        case StateObject::host:
+            return std::string{STATE_OBJECT} + "/host" + std::to_string(id);
+    }
+    return {};
+}
+
+SubTree getSubTree(sdbusplus::bus_t& bus, const std::string& path,
+                   const std::vector<std::string>& interfaces)
+{
+    auto method = bus.new_method_call(MAPPER_BUSNAME, MAPPER_PATH,
+                                      MAPPER_INTERFACE, "GetSubTree");
+    method.append(path, 0, interfaces);
+
+    SubTree subTree;
+    auto reply = bus.call(method);
+    reply.read(subTree);
+    return subTree;
+}
+
+/** @brief Find the services of all the state interfaces in one mapper call */
+SubTree getStateServices(sdbusplus::bus_t& bus)
+{
+    std::set<std::string> interfaces;
+    for (const auto& query : stateQueries)
+    {
+        interfaces.emplace(query.interface);
+    }
+    return getSubTree(bus, STATE_OBJECT, {interfaces.begin(), interfaces.end()});
+}
+
+std::optional<std::string> findService(const SubTree& services,
+                                       const std::string& path,
+                                       const std::string& interface)
+{
+    auto object = services.find(path);
+    if (object == services.end())
+    {
+        return std::nullopt;
+    }
+    for (const auto& [service, interfaces] : object->second)
+    {
+        if (std::find(interfaces.begin(), interfaces.end(), interface) !=
+            interfaces.end())
+        {
+            return service;
+        }
+    }
+    return std::nullopt;
+}
+
+PropertyMap getAllProperties(sdbusplus::bus_t& bus, const std::string& service,
+                             const std::string& path,
+                             const std::string& interface)
+{
+    auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                      PROPERTY_INTERFACE, "GetAll");
+    method.append(interface);
+
+    PropertyMap properties;
+    auto reply = bus.call(method);
+    reply.read(properties);
+    return properties;
+}
+
+std::string getStateProperty(sdbusplus::bus_t& bus, const std::string& service,
+                             const std::string& path,
+                             const StateQuery& query)
+{
+    auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                      PROPERTY_INTERFACE, "Get");
+    method.append(query.interface, query.property);
+
+    std::variant<std::string> value;
+    auto reply = bus.call(method);
+    reply.read(value);
+    return std::get<std::string>(value);
+}
+
+void printState(const std::string& property, const std::string& value)
+{
+    std::printf("%-20s: %s\n", property.c_str(), value.c_str());
+}
+
+/** @brief Print the given state queries
+ *
+ * Each interface is read with one GetAll, no matter how many of its
+ * properties are printed.
+ *
+ * @return true if every state could be read
+ */
+bool printStates(sdbusplus::bus_t& bus, const SubTree& services, size_t id,
+                 const std::vector<const StateQuery*>& queries)
+{
+    std::map<std::pair<std::string, std::string>, PropertyMap> cache;
+    bool ok = true;
+
+    for (const auto* query : queries)
+    {
+        auto path = getObjectPath(query->object, id);
+        auto key = std::make_pair(path, std::string{query->interface});
+
+        auto properties = cache.find(key);
+        if (properties == cache.end())
+        {
+            auto service = findService(services, path, query->interface);
+            if (!service)
+            {
+                std::cerr << "No service provides " << query->interface
+                          << " on " << path << std::endl;
+                ok = false;
+                continue;
+            }
+
+            try
+            {
+                properties =
+                    cache
+                        .emplace(key, getAllProperties(bus, *service, path,
+                                                       query->interface))
+                        .first;
+            }
+            catch (const sdbusplus::exception_t& e)
+            {
+                std::cerr << "Failed to read " << query->interface << " on "
+                          << path << ": " << e.what() << std::endl;
+                ok = false;
+                continue;
+            }
+        }
+
+        std::string value;
+        auto property = properties->second.find(query->property);
+        if ((property != properties->second.end()) &&
+            std::holds_alternative<std::string>(property->second))
+        {
+            value = std::get<std::string>(property->second);
+        }
+        printState(query->property, value);
+    }
+
+    return ok;
+}
+
+/** @brief Get the log entries blocking a boot, in one call per block */
+std::vector<std::string> getBootBlockErrors(sdbusplus::bus_t& bus)
+{
+    std::vector<std::string> entries;
+
+    SubTree blocks;
+    try
+    {
+        blocks = getSubTree(bus, LOGGING_OBJECT, {BOOT_BLOCK_INTERFACE});
+    }
+    catch (const sdbusplus::exception_t&)
+    {
+        // No blocking errors, the mapper fails the call when nothing
+        // implements the interface
+        return entries;
+    }
+
+    for (const auto& [path, services] : blocks)
+    {
+        try
+        {
+            auto method = bus.new_method_call(LOGGING_BUSNAME, path.c_str(),
+                                              PROPERTY_INTERFACE, "Get");
+            method.append(ASSOCIATION_INTERFACE, "Associations");
+
+            std::variant<Associations> associations;
+            auto reply = bus.call(method);
+            reply.read(associations);
+
+            for (const auto& [forward, reverse, endpoint] :
+                 std::get<Associations>(associations))
+            {
+                if (endpoint.starts_with(LOGGING_ENTRY_OBJECT))
+                {
+                    entries.push_back(endpoint);
+                }
+            }
+        }
+        catch (const sdbusplus::exception_t& e)
+        {
+            std::cerr << "Failed to read associations of " << path << ": "
+                      << e.what() << std::endl;
+        }
+    }
+
+    return entries;
+}
+
+void warnBootBlock(sdbusplus::bus_t& bus)
+{
+    auto entries = getBootBlockErrors(bus);
+    if (entries.empty())
+    {
+        return;
+    }
+
+    std::cout << "!!!!!!!!!!" << std::endl;
+    std::cout << "WARNING! System has blocking errors that will prevent boot"
+              << std::endl;
+    for (const auto& entry : entries)
+    {
+        std::cout << "Blocking Error: " << entry << std::endl;
+    }
+    std::cout << "!!!!!!!!!!" << std::endl;
+}
+
+/** @brief Request a transition, and optionally wait for it to complete
+ *
+ * The wait is driven by PropertiesChanged signals of the state, which are
+ * subscribed to before the transition is requested so none can be missed.
+ *
+ * @return 0 on success, non-zero if the transition could not be requested
+ *         or confirmed within the timeout
+ */
+int requestTransition(sdbusplus::bus_t& bus, const SubTree& services,
+                      size_t id, const StateTransition& transition,
+                      std::optional<std::chrono::seconds> wait, bool verbose)
+{
+    const auto& query = *findQuery(transition.query);
+    auto path = getObjectPath(query.object, id);
+    auto service = findService(services, path, query.interface);
+    if (!service)
+    {
+        std::cerr << "No service provides " << query.interface << " on "
+                  << path << std::endl;
+        return 1;
+    }
+
+    std::string currentState;
+    std::optional<sdbusplus::bus::match_t> stateChanged;
+    if (wait)
+    {
+        stateChanged.emplace(
+            bus,
+            sdbusplus::bus::match::rules::propertiesChanged(path,
+                                                            query.interface),
+            [&](sdbusplus::message_t& msg) {
+            std::string interface;
+            PropertyMap properties;
+            msg.read(interface, properties);
+
+            auto property = properties.find(query.property);
+            if ((property != properties.end()) &&
+                std::holds_alternative<std::string>(property->second))
+            {
+                currentState = std::get<std::string>(property->second);
+                if (verbose)
+                {
+                    printState(query.property, currentState);
+                }
+            }
+        });
+    }
+
+    try
+    {
+        auto method = bus.new_method_call(service->c_str(), path.c_str(),
+                                          PROPERTY_INTERFACE, "Set");
+        method.append(query.interface, transition.property,
+                      std::variant<std::string>(transition.value));
+        bus.call_noreply(method);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        std::cerr << "Failed to request " << transition.value << ": "
+                  << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!wait)
+    {
+        return 0;
+    }
+
+    try
+    {
+        currentState = getStateProperty(bus, *service, path, query);
+        if (verbose)
+        {
+            printState(query.property, currentState);
+        }
+    }
+    catch (const sdbusplus::exception_t&)
+    {
+        // Wait for the state to be signalled instead
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + *wait;
+    while (currentState != transition.requestedState)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            std::cout << "Unable to confirm '" << transition.command
+                      << "' success within timeout period (" << wait->count()
+                      << "s)" << std::endl;
+            return 1;
+        }
+
+        bus.wait(
+            std::chrono::duration_cast<std::chrono::microseconds>(deadline -
+                                                                  now));
+        while (bus.process_discard())
+        {}
+    }
+
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"OpenBMC state query and transition tool"};
+
+    std::string command;
+    size_t id = 0;
+    bool waitForState = false;
+    unsigned timeout = 30;
+    bool verbose = false;
+
+    std::vector<std::string> commands{"state", "status", "listbootblock"};
+    for (const auto& query : stateQueries)
+    {
+        commands.emplace_back(query.command);
+    }
+    for (const auto& transition : stateTransitions)
+    {
+        commands.emplace_back(transition.command);
+    }
+
+    app.add_option("command", command, "The state to query or change")
+        ->required()
+        ->check(CLI::IsMember(commands));
+    app.add_option("-i,--id", id, "Chassis/host instance id, default 0");
+    app.add_flag("-w,--wait", waitForState,
+                 "Wait for a requested transition to complete");
+    app.add_option("-t,--timeout", timeout,
+                   "Seconds to wait for a transition, default 30");
+    app.add_flag("-v,--verbose", verbose,
+                 "Print the state while waiting for a transition");
+
+    CLI11_PARSE(app, argc, argv);
+
+    auto bus = sdbusplus::bus::new_default();
+
+    if (command == "listbootblock")
+    {
+        auto entries = getBootBlockErrors(bus);
+        if (entries.empty())
+        {
+            std::cout << "No blocking errors present" << std::endl;
+        }
+        for (const auto& entry : entries)
+        {
+            std::cout << "Blocking Error: " << entry << std::endl;
+        }
+        return 0;
+    }
+
+    SubTree services;
+    try
+    {
+        services = getStateServices(bus);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        std::cerr << "Failed to look up the state services: " << e.what()
+                  << std::endl;
+        return 1;
+    }
+
+    if (const auto* transition = findTransition(command))
+    {
+        if (transition->warnBootBlock)
+        {
+            warnBootBlock(bus);
+        }
+
+        std::optional<std::chrono::seconds> wait;
+        if (waitForState)
+        {
+            wait = std::chrono::seconds(timeout);
+        }
+        return requestTransition(bus, services, id, *transition, wait,
+                                 verbose);
+    }
+
+    std::vector<const StateQuery*> queries;
+    if ((command == "state") || (command == "status"))
+    {
+        for (const auto& query : stateQueries)
+        {
+            queries.push_back(&query);
+        }
+    }
+    else
+    {
+        queries.push_back(findQuery(command));
+    }
+
+    bool ok = printStates(bus, services, id, queries);
+
+    if (queries.size() > 1)
+    {
+        warnBootBlock(bus);
+    }
+
+    return ok ? 0 : 1;
+}
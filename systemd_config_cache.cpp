@@ -0,0 +1,351 @@
+#include "systemd_config_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+namespace
+{
+
+/** @brief Identifies a config cache file, "PTMC" */
+constexpr uint32_t configCacheMagic = 0x434d5450;
+
+/** @brief Kind of json file a cache was built from */
+enum class SourceKind : uint8_t
+{
+    target = 0,
+    service = 1,
+};
+
+/** @brief Identity of a json file at the time the cache was written */
+struct SourceStamp
+{
+    uint64_t size;
+
+    /** @brief FNV-1a hash of the contents */
+    uint64_t hash;
+};
+
+std::optional<SourceStamp> getSourceStamp(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    SourceStamp stamp{static_cast<uint64_t>(st.st_size),
+                      0xcbf29ce484222325};
+    if (stamp.size == 0)
+    {
+        close(fd);
+        return stamp;
+    }
+
+    void* map = mmap(nullptr, stamp.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return std::nullopt;
+    }
+
+    auto data = static_cast<const unsigned char*>(map);
+    for (uint64_t i = 0; i < stamp.size; i++)
+    {
+        stamp.hash = (stamp.hash ^ data[i]) * 0x100000001b3;
+    }
+    munmap(map, stamp.size);
+    return stamp;
+}
+
+/** @brief Appends fixed size fields and strings to the cache contents */
+class CacheWriter
+{
+  public:
+    template <typename T>
+    void put(T value)
+    {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(std::string_view value)
+    {
+        put(static_cast<uint32_t>(value.size()));
+        data.append(value);
+    }
+
+    std::string data;
+};
+
+/** @brief Reads fields back out of the mapped cache, with bounds checking */
+class CacheReader
+{
+  public:
+    CacheReader(const char* begin, size_t size) : pos(begin), end(begin + size)
+    {}
+
+    template <typename T>
+    bool get(T& value)
+    {
+        if (static_cast<size_t>(end - pos) < sizeof(value))
+        {
+            return false;
+        }
+        std::memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool get(std::string_view& value)
+    {
+        uint32_t size = 0;
+        if (!get(size) || (static_cast<size_t>(end - pos) < size))
+        {
+            return false;
+        }
+        value = std::string_view(pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool done() const
+    {
+        return pos == end;
+    }
+
+  private:
+    const char* pos;
+    const char* end;
+};
+
+/** @brief Check the json files recorded in the cache are the current ones */
+bool readSources(CacheReader& reader, SourceKind kind,
+                 const std::vector<std::string>& filePaths)
+{
+    uint32_t count = 0;
+    if (!reader.get(count) || (count != filePaths.size()))
+    {
+        return false;
+    }
+
+    for (const auto& filePath : filePaths)
+    {
+        uint8_t cachedKind = 0;
+        std::string_view cachedPath;
+        SourceStamp cachedStamp{};
+        if (!reader.get(cachedKind) || !reader.get(cachedPath) ||
+            !reader.get(cachedStamp.size) || !reader.get(cachedStamp.hash))
+        {
+            return false;
+        }
+
+        auto stamp = getSourceStamp(filePath);
+        if ((cachedKind != static_cast<uint8_t>(kind)) ||
+            (cachedPath != filePath) || !stamp ||
+            (stamp->size != cachedStamp.size) ||
+            (stamp->hash != cachedStamp.hash))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeSources(CacheWriter& writer, SourceKind kind,
+                  const std::vector<std::string>& filePaths)
+{
+    writer.put(static_cast<uint32_t>(filePaths.size()));
+    for (const auto& filePath : filePaths)
+    {
+        auto stamp = getSourceStamp(filePath);
+        if (!stamp)
+        {
+            return false;
+        }
+        writer.put(static_cast<uint8_t>(kind));
+        writer.put(std::string_view(filePath));
+        writer.put(stamp->size);
+        writer.put(stamp->hash);
+    }
+    return true;
+}
+
+bool readCache(CacheReader& reader,
+               const std::vector<std::string>& targetFilePaths,
+               const std::vector<std::string>& serviceFilePaths,
+               TargetErrorData& targetData, ServiceMonitorData& serviceData)
+{
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!reader.get(magic) || (magic != configCacheMagic) ||
+        !reader.get(version) || (version != configCacheVersion))
+    {
+        return false;
+    }
+
+    if (!readSources(reader, SourceKind::target, targetFilePaths) ||
+        !readSources(reader, SourceKind::service, serviceFilePaths))
+    {
+        return false;
+    }
+
+    uint32_t count = 0;
+    if (!reader.get(count))
+    {
+        return false;
+    }
+    targetData.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string_view target;
+        std::string_view errorToLog;
+        targetEntry entry;
+        if (!reader.get(target) || !reader.get(errorToLog) ||
+            !reader.get(entry.errorsToMonitor))
+        {
+            return false;
+        }
+        entry.errorToLog = errorToLog;
+        targetData.emplace(target, std::move(entry));
+    }
+
+    if (!reader.get(count))
+    {
+        return false;
+    }
+    serviceData.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string_view service;
+        if (!reader.get(service))
+        {
+            return false;
+        }
+        serviceData.emplace(service);
+    }
+
+    return reader.done();
+}
+
+} // namespace
+
+bool loadConfigCache(const std::string& cachePath,
+                     const std::vector<std::string>& targetFilePaths,
+                     const std::vector<std::string>& serviceFilePaths,
+                     TargetErrorData& targetData,
+                     ServiceMonitorData& serviceData)
+{
+    int fd = open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0))
+    {
+        close(fd);
+        return false;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    TargetErrorData cachedTargets;
+    ServiceMonitorData cachedServices;
+    CacheReader reader(static_cast<const char*>(map), size);
+    bool loaded = readCache(reader, targetFilePaths, serviceFilePaths,
+                            cachedTargets, cachedServices);
+    munmap(map, size);
+
+    if (!loaded)
+    {
+        if (gVerbose)
+        {
+            std::cout << "Config cache " << cachePath
+                      << " is stale or invalid" << std::endl;
+        }
+        return false;
+    }
+
+    targetData = std::move(cachedTargets);
+    serviceData = std::move(cachedServices);
+    return true;
+}
+
+bool writeConfigCache(const std::string& cachePath,
+                      const std::vector<std::string>& targetFilePaths,
+                      const std::vector<std::string>& serviceFilePaths,
+                      const TargetErrorData& targetData,
+                      const ServiceMonitorData& serviceData)
+{
+    CacheWriter writer;
+    writer.put(configCacheMagic);
+    writer.put(configCacheVersion);
+
+    if (!writeSources(writer, SourceKind::target, targetFilePaths) ||
+        !writeSources(writer, SourceKind::service, serviceFilePaths))
+    {
+        return false;
+    }
+
+    writer.put(static_cast<uint32_t>(targetData.size()));
+    for (const auto& [target, entry] : targetData)
+    {
+        writer.put(std::string_view(target));
+        writer.put(std::string_view(entry.errorToLog));
+        writer.put(entry.errorsToMonitor);
+    }
+
+    writer.put(static_cast<uint32_t>(serviceData.size()));
+    for (const auto& service : serviceData)
+    {
+        writer.put(std::string_view(service));
+    }
+
+    // Write a temporary file and rename it so a partially written cache is
+    // never loaded
+    std::error_code ec;
+    std::filesystem::path path(cachePath);
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    auto tmpPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(writer.data.data(),
+                   static_cast<std::streamsize>(writer.data.size()));
+        if (!file.good())
+        {
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
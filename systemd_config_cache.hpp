@@ -0,0 +1,55 @@
+#pragma once
+
+#include "systemd_service_parser.hpp"
+#include "systemd_target_parser.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** @brief Version of the binary config cache format
+ *
+ * Increment this whenever the layout of the cache file changes so caches
+ * written by older code are ignored
+ */
+constexpr uint32_t configCacheVersion = 2;
+
+/** @brief Load the monitored targets and services from a config cache
+ *
+ * The cache is only used if it was built by writeConfigCache() from the
+ * same json files, and none of those files changed since it was written.
+ *
+ * @param[in] cachePath        - The cache file to load
+ * @param[in] targetFilePaths  - Json file(s) with target/error mappings
+ * @param[in] serviceFilePaths - Json file(s) with services to monitor
+ * @param[out] targetData      - The cached target to error log mappings
+ * @param[out] serviceData     - The cached services to monitor
+ *
+ * @return true if the cache was loaded, false if it is missing, stale or
+ *         invalid and the json files must be parsed instead
+ */
+bool loadConfigCache(const std::string& cachePath,
+                     const std::vector<std::string>& targetFilePaths,
+                     const std::vector<std::string>& serviceFilePaths,
+                     TargetErrorData& targetData,
+                     ServiceMonitorData& serviceData);
+
+/** @brief Write the parsed targets and services to a config cache
+ *
+ * The cache records the size and a hash of the contents of each json file
+ * so loadConfigCache() can detect when it is stale. The modification time
+ * is not used, as reproducible builds clamp it.
+ *
+ * @param[in] cachePath        - The cache file to write
+ * @param[in] targetFilePaths  - Json file(s) targetData was parsed from
+ * @param[in] serviceFilePaths - Json file(s) serviceData was parsed from
+ * @param[in] targetData       - The parsed target to error log mappings
+ * @param[in] serviceData      - The parsed services to monitor
+ *
+ * @return true if the cache was written
+ */
+bool writeConfigCache(const std::string& cachePath,
+                      const std::vector<std::string>& targetFilePaths,
+                      const std::vector<std::string>& serviceFilePaths,
+                      const TargetErrorData& targetData,
+                      const ServiceMonitorData& serviceData);
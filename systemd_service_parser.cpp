@@ -22,7 +22,7 @@ ServiceMonitorData parseServiceFiles(const std::vector<std::string>& filePaths)
                 std::cout << "service: " << service.value() << std::endl;
             }
 
-            systemdServiceMap.push_back(service.value());
+            systemdServiceMap.emplace(service.value());
         }
     }
     return systemdServiceMap;
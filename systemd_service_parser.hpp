@@ -2,12 +2,12 @@
 
 #include <nlohmann/json.hpp>
 
-#include <map>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
-/** @brief Array of services to monitor */
-using ServiceMonitorData = std::vector<std::string>;
+/** @brief Set of services to monitor */
+using ServiceMonitorData = std::unordered_set<std::string>;
 
 using json = nlohmann::json;
 
@@ -1,3 +1,6 @@
+#include "config.h"
+
+#include "systemd_config_cache.hpp"
 #include "systemd_service_parser.hpp"
 #include "systemd_target_parser.hpp"
 #include "systemd_target_signal.hpp"
@@ -6,7 +9,10 @@
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
 #include <sdeventplus/event.hpp>
+#include <sdeventplus/source/signal.hpp>
 
+#include <chrono>
+#include <csignal>
 #include <iostream>
 #include <vector>
 
@@ -21,9 +27,12 @@ void dump_targets(const TargetErrorData& targetData)
     {
         std::cout << target << " " << value.errorToLog << std::endl;
         std::cout << "    ";
-        for (auto& eToMonitor : value.errorsToMonitor)
+        for (const auto& eToMonitor : {"timeout", "failed", "dependency"})
         {
-            std::cout << eToMonitor << ", ";
+            if (value.errorsToMonitor & convertResultToMask(eToMonitor))
+            {
+                std::cout << eToMonitor << ", ";
+            }
         }
         std::cout << std::endl;
     }
@@ -38,22 +47,102 @@ void print_usage(void)
     std::cout << "[-s <file1> -s <file2> ...] : Full path to json file(s) with "
                  "services to monitor for errors"
               << std::endl;
+    std::cout << "[-c <file>] : Full path to the config cache, empty to "
+                 "disable it"
+              << std::endl;
+    std::cout << "[-w <milliseconds>] : Time to collect related failures "
+                 "before logging them"
+              << std::endl;
     return;
 }
 
+/** @brief Reparse the input files and replace the monitored data with them
+ *
+ * The new files are fully parsed and validated before the data in use is
+ * replaced, so an invalid file leaves the current configuration in place.
+ *
+ * @param[in] targetFilePaths  - Json file(s) with target/error mappings
+ * @param[in] serviceFilePaths - Json file(s) with services to monitor
+ * @param[in] cachePath        - Config cache to update, empty if not used
+ * @param[out] targetData      - Targets currently being monitored
+ * @param[out] serviceData     - Services currently being monitored
+ */
+void reloadFiles(const std::vector<std::string>& targetFilePaths,
+                 const std::vector<std::string>& serviceFilePaths,
+                 const std::string& cachePath, TargetErrorData& targetData,
+                 ServiceMonitorData& serviceData)
+{
+    info("Reloading target and service monitor files");
+
+    TargetErrorData newTargetData;
+    ServiceMonitorData newServiceData;
+    try
+    {
+        newTargetData = parseFiles(targetFilePaths);
+        if (!serviceFilePaths.empty())
+        {
+            newServiceData = parseServiceFiles(serviceFilePaths);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        error("Invalid input files, keeping current configuration: {ERROR}",
+              "ERROR", e.what());
+        return;
+    }
+
+    if (newTargetData.empty())
+    {
+        error("No targets found, keeping current configuration");
+        return;
+    }
+
+    // The monitor only looks at this data from the event loop, so swapping
+    // it here can't race with a lookup
+    targetData.swap(newTargetData);
+    serviceData.swap(newServiceData);
+
+    if (!cachePath.empty() &&
+        !writeConfigCache(cachePath, targetFilePaths, serviceFilePaths,
+                          targetData, serviceData))
+    {
+        info("Unable to update config cache {PATH}", "PATH", cachePath);
+    }
+
+    if (gVerbose)
+    {
+        dump_targets(targetData);
+    }
+}
+
 int main(int argc, char* argv[])
 {
+    // SIGHUP reloads the input files once the event loop runs. Block it
+    // before anything else, a SIGHUP sent while starting would otherwise
+    // terminate the process.
+    sigset_t sigset;
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGHUP);
+    sigprocmask(SIG_BLOCK, &sigset, nullptr);
+
     auto bus = sdbusplus::bus::new_default();
     auto event = sdeventplus::Event::get_default();
     bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
     std::vector<std::string> targetFilePaths;
     std::vector<std::string> serviceFilePaths;
+    std::string cachePath = TARGET_MONITOR_CACHE_PATH;
+    uint32_t burstWindow = phosphor::state::manager::SystemdTargetLogging::
+                               defaultBurstWindow.count();
 
     CLI::App app{"OpenBmc systemd target and service monitor"};
     app.add_option("-f,--file", targetFilePaths,
                    "Full path to json file(s) with target/error mappings");
     app.add_option("-s,--service", serviceFilePaths,
                    "Full path to json file(s) with services to monitor");
+    app.add_option("-w,--window", burstWindow,
+                   "Milliseconds to collect related failures before logging");
+    app.add_option("-c,--cache", cachePath,
+                   "Full path to the config cache, empty to disable it");
     app.add_flag("-v", gVerbose, "Enable verbose output");
 
     CLI11_PARSE(app, argc, argv);
@@ -66,30 +155,60 @@ int main(int argc, char* argv[])
         exit(-1);
     }
 
-    TargetErrorData targetData = parseFiles(targetFilePaths);
-    if (targetData.size() == 0)
-    {
-        error("Invalid input files, no targets found");
-        print_usage();
-        exit(-1);
-    }
+    auto startTime = std::chrono::steady_clock::now();
 
+    // Use the config cache written on a previous run if the input files have
+    // not changed since, to avoid parsing json early in the boot
+    TargetErrorData targetData;
     ServiceMonitorData serviceData;
-    if (!serviceFilePaths.empty())
+    bool cached = !cachePath.empty() &&
+                  loadConfigCache(cachePath, targetFilePaths, serviceFilePaths,
+                                  targetData, serviceData);
+    if (!cached)
     {
-        serviceData = parseServiceFiles(serviceFilePaths);
+        targetData = parseFiles(targetFilePaths);
+        if (targetData.size() == 0)
+        {
+            error("Invalid input files, no targets found");
+            print_usage();
+            exit(-1);
+        }
+
+        if (!serviceFilePaths.empty())
+        {
+            serviceData = parseServiceFiles(serviceFilePaths);
+        }
+
+        if (!cachePath.empty() &&
+            !writeConfigCache(cachePath, targetFilePaths, serviceFilePaths,
+                              targetData, serviceData))
+        {
+            info("Unable to write config cache {PATH}", "PATH", cachePath);
+        }
     }
 
     if (gVerbose)
     {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime);
+        std::cout << "Loaded configuration from "
+                  << (cached ? cachePath : "json files") << " in "
+                  << elapsed.count() << "us" << std::endl;
         dump_targets(targetData);
     }
 
-    phosphor::state::manager::SystemdTargetLogging targetMon(targetData,
-                                                             serviceData, bus);
+    phosphor::state::manager::SystemdTargetLogging targetMon(
+        targetData, serviceData, bus, std::chrono::milliseconds(burstWindow));
 
     // Subscribe to systemd D-bus signals indicating target completions
     targetMon.subscribeToSystemdSignals();
 
+    // Reload the input files on SIGHUP without dropping the subscription
+    sdeventplus::source::Signal reloadSignal(
+        event, SIGHUP, [&](sdeventplus::source::Signal&, const auto*) {
+        reloadFiles(targetFilePaths, serviceFilePaths, cachePath, targetData,
+                    serviceData);
+    });
+
     return event.loop();
 }
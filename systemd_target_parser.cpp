@@ -1,27 +1,52 @@
 #include "systemd_target_parser.hpp"
 
-#include <cassert>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
-void validateErrorsToMonitor(std::vector<std::string>& errorsToMonitor)
+ErrorsToMonitor convertResultToMask(std::string_view result)
 {
-    assert(errorsToMonitor.size());
+    if (result == "timeout")
+    {
+        return errorMask::timeout;
+    }
+    if (result == "failed")
+    {
+        return errorMask::failed;
+    }
+    if (result == "dependency")
+    {
+        return errorMask::dependency;
+    }
+    return errorMask::none;
+}
+
+ErrorsToMonitor
+    validateErrorsToMonitor(const std::vector<std::string>& errorsToMonitor)
+{
+    if (errorsToMonitor.empty())
+    {
+        throw std::invalid_argument("No errors to monitor");
+    }
 
-    const std::vector<std::string> validErrorsToMonitor = {
-        "default", "timeout", "failed", "dependency"};
+    ErrorsToMonitor mask = errorMask::none;
+    bool foundDefault = false;
     for (const auto& errorToMonitor : errorsToMonitor)
     {
-        if (std::find(validErrorsToMonitor.begin(), validErrorsToMonitor.end(),
-                      errorToMonitor) == validErrorsToMonitor.end())
+        if (errorToMonitor == "default")
+        {
+            foundDefault = true;
+            continue;
+        }
+        auto bit = convertResultToMask(errorToMonitor);
+        if (bit == errorMask::none)
         {
             throw std::out_of_range("Found invalid error to monitor");
         }
+        mask |= bit;
     }
-    // See if default was in the errors to monitor, if so replace with defaults
-    auto errorItr = std::find(errorsToMonitor.begin(), errorsToMonitor.end(),
-                              "default");
-    if (errorItr != errorsToMonitor.end())
+    // See if default was in the errors to monitor, if so use the defaults
+    if (foundDefault)
     {
         // Verify default is the only entry
         if (errorsToMonitor.size() != 1)
@@ -29,12 +54,9 @@ void validateErrorsToMonitor(std::vector<std::string>& errorsToMonitor)
             throw std::invalid_argument(
                 "default must be only error to monitor");
         }
-        // delete "default" and insert defaults
-        errorsToMonitor.erase(errorItr);
-        errorsToMonitor.push_back("timeout");
-        errorsToMonitor.push_back("failed");
-        errorsToMonitor.push_back("dependency");
+        mask = errorMask::defaults;
     }
+    return mask;
 }
 
 TargetErrorData parseFiles(const std::vector<std::string>& filePaths)
@@ -61,12 +83,20 @@ TargetErrorData parseFiles(const std::vector<std::string>& filePaths)
             // Be unforgiving on invalid json files. Just throw or allow
             // nlohmann to throw an exception if something is off
             auto errorsToMonitor = it.value().find("errorsToMonitor");
-            entry.errorsToMonitor =
-                errorsToMonitor->get<std::vector<std::string>>();
-
-            validateErrorsToMonitor(entry.errorsToMonitor);
+            if (errorsToMonitor == it.value().end())
+            {
+                throw std::invalid_argument("Missing errorsToMonitor for " +
+                                            it.key());
+            }
+            entry.errorsToMonitor = validateErrorsToMonitor(
+                errorsToMonitor->get<std::vector<std::string>>());
 
             auto errorToLog = it.value().find("errorToLog");
+            if (errorToLog == it.value().end())
+            {
+                throw std::invalid_argument("Missing errorToLog for " +
+                                            it.key());
+            }
             entry.errorToLog = errorToLog->get<std::string>();
 
             systemdTargetMap[it.key()] = entry;
@@ -2,24 +2,49 @@
 
 #include <nlohmann/json.hpp>
 
-#include <map>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+/** @brief Bitmask of the systemd job results to monitor for a target */
+using ErrorsToMonitor = uint8_t;
+
+namespace errorMask
+{
+constexpr ErrorsToMonitor none = 0x00;
+constexpr ErrorsToMonitor timeout = 0x01;
+constexpr ErrorsToMonitor failed = 0x02;
+constexpr ErrorsToMonitor dependency = 0x04;
+
+/** @brief Results monitored when "default" is specified */
+constexpr ErrorsToMonitor defaults = timeout | failed | dependency;
+} // namespace errorMask
+
 /** @brief Stores the error to log if errors to monitor is found */
 struct targetEntry
 {
     std::string errorToLog;
-    std::vector<std::string> errorsToMonitor;
+    ErrorsToMonitor errorsToMonitor = errorMask::none;
 };
 
 /** @brief A map of the systemd target to its corresponding targetEntry*/
-using TargetErrorData = std::map<std::string, targetEntry>;
+using TargetErrorData = std::unordered_map<std::string, targetEntry>;
 
 using json = nlohmann::json;
 
 extern bool gVerbose;
 
+/** @brief Convert a systemd job result into its errorsToMonitor bit
+ *
+ * @param[in] result - The systemd job result (i.e. "timeout")
+ *
+ * @return The matching bit, or errorMask::none if the result is not one
+ *         which can be monitored
+ */
+ErrorsToMonitor convertResultToMask(std::string_view result);
+
 /** @brief Parse input json files
  *
  * Will return the parsed data in the TargetErrorData object
@@ -1,7 +1,5 @@
 #include "systemd_target_signal.hpp"
 
-#include "utils.hpp"
-
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/exception.hpp>
@@ -9,6 +7,10 @@
 #include <sdeventplus/event.hpp>
 #include <xyz/openbmc_project/Common/error.hpp>
 
+#include <algorithm>
+#include <set>
+#include <variant>
+
 namespace phosphor
 {
 namespace state
@@ -21,33 +23,368 @@ PHOSPHOR_LOG2_USING;
 
 using sdbusplus::xyz::openbmc_project::Common::Error::InternalFailure;
 
-void SystemdTargetLogging::startBmcQuiesceTarget()
-{
-    auto method = this->bus.new_method_call(
-        "org.freedesktop.systemd1", "/org/freedesktop/systemd1",
-        "org.freedesktop.systemd1.Manager", "StartUnit");
+// TODO: Enhance when needed to support multiple-bmc instance systems
+constexpr auto bmcQuiesceTarget = "obmc-bmc-service-quiesce@0.target";
 
-    // TODO: Enhance when needed to support multiple-bmc instance systems
-    method.append("obmc-bmc-service-quiesce@0.target");
-    method.append("replace");
+bool SystemdTargetLogging::callAsync(
+    sdbusplus::message_t& method,
+    std::function<void(sdbusplus::message_t&)>&& onReply)
+{
+    auto id = nextCallId++;
     try
     {
-        this->bus.call_noreply(method);
+        pendingCalls.emplace(
+            id, this->bus.call_async(
+                    method, [this, id, onReply = std::move(onReply)](
+                                sdbusplus::message_t reply) {
+            onReply(reply);
+            // Releasing the slot may destroy this callback, so it must be
+            // the last thing done here
+            pendingCalls.erase(id);
+            }));
     }
     catch (const sdbusplus::exception_t& e)
     {
-        error("Failed to start BMC quiesce target, exception:{ERROR}", "ERROR",
+        error("Failed to send async method call, exception:{ERROR}", "ERROR",
               e);
-        // just continue, this is error path anyway so we're just doing what
-        // we can
+        return false;
     }
+    return true;
+}
 
-    return;
+void SystemdTargetLogging::startBurstWindow()
+{
+    if (!burstTimer.isEnabled())
+    {
+        burstTimer.restartOnce(burstWindow);
+    }
+}
+
+void SystemdTargetLogging::pruneRecentFailures()
+{
+    // Keep failures from just before the burst started, they are likely the
+    // root cause of the monitored failures which opened the window
+    auto oldest = std::chrono::steady_clock::now() - (2 * burstWindow);
+    std::erase_if(recentFailures, [oldest](const auto& failure) {
+        return failure.second.time < oldest;
+    });
+}
+
+void SystemdTargetLogging::fetchDependencies(const std::string& unit)
+{
+    if (dependencies.contains(unit) || dependencyLookups.contains(unit))
+    {
+        return;
+    }
+
+    // The object path systemd gives the unit, so it need not be looked up
+    auto unitPath =
+        sdbusplus::message::object_path("/org/freedesktop/systemd1/unit") /
+        unit;
+
+    auto& lookup = dependencyLookups[unit];
+    for (const auto& property : {"Requires", "Requisite", "BindsTo"})
+    {
+        auto method = this->bus.new_method_call(
+            "org.freedesktop.systemd1", unitPath.str.c_str(),
+            "org.freedesktop.DBus.Properties", "Get");
+        method.append("org.freedesktop.systemd1.Unit", property);
+
+        if (callAsync(method, [this, unit, generation = dependencyGeneration](
+                                  sdbusplus::message_t& reply) {
+                dependencyReply(unit, generation, reply);
+            }))
+        {
+            lookup.outstanding++;
+        }
+    }
+
+    if (lookup.outstanding == 0)
+    {
+        dependencyLookups.erase(unit);
+        dependencies.emplace(unit, std::vector<std::string>{});
+    }
+}
+
+void SystemdTargetLogging::dependencyReply(const std::string& unit,
+                                           uint64_t generation,
+                                           sdbusplus::message_t& reply)
+{
+    // Dependencies read before a reload may no longer be right
+    if (generation != dependencyGeneration)
+    {
+        return;
+    }
+
+    auto lookup = dependencyLookups.find(unit);
+    if (lookup == dependencyLookups.end())
+    {
+        return;
+    }
+
+    if (reply.is_method_error())
+    {
+        info("Unable to get dependencies of {UNIT}: {ERROR}", "UNIT", unit,
+             "ERROR", reply.get_error()->name);
+    }
+    else
+    {
+        try
+        {
+            std::variant<std::vector<std::string>> units;
+            reply.read(units);
+            auto& values = std::get<std::vector<std::string>>(units);
+            lookup->second.units.insert(lookup->second.units.end(),
+                                        values.begin(), values.end());
+        }
+        catch (const sdbusplus::exception_t& e)
+        {
+            info("Unable to read dependencies of {UNIT}: {ERROR}", "UNIT",
+                 unit, "ERROR", e);
+        }
+    }
+
+    if (--lookup->second.outstanding == 0)
+    {
+        dependencies.insert_or_assign(unit, std::move(lookup->second.units));
+        dependencyLookups.erase(lookup);
+    }
+}
+
+void SystemdTargetLogging::dropDependencies()
+{
+    debug("systemd is reloading, dropping the cached unit dependencies");
+    dependencies.clear();
+    dependencyLookups.clear();
+    dependencyGeneration++;
+}
+
+std::optional<std::string>
+    SystemdTargetLogging::findRootCause(const std::string& unit)
+{
+    std::vector<std::string> toVisit{unit};
+    std::set<std::string> visited{unit};
+
+    while (!toVisit.empty())
+    {
+        auto current = std::move(toVisit.back());
+        toVisit.pop_back();
+
+        auto cached = dependencies.find(current);
+        if (cached == dependencies.end())
+        {
+            continue;
+        }
+
+        // Only follow dependencies which also failed, a "dependency" result
+        // means one of them is the cause of the failure
+        for (const auto& dependency : cached->second)
+        {
+            auto failure = recentFailures.find(dependency);
+            if ((failure == recentFailures.end()) ||
+                !visited.insert(dependency).second)
+            {
+                continue;
+            }
+            if (failure->second.result != "dependency")
+            {
+                return dependency;
+            }
+            toVisit.push_back(dependency);
+        }
+    }
+    return std::nullopt;
+}
+
+void SystemdTargetLogging::queueBmcDump()
+{
+    dumpQueued = true;
+    startBurstWindow();
+}
+
+void SystemdTargetLogging::queueBmcQuiesceTarget()
+{
+    if (quiesceQueued)
+    {
+        return;
+    }
+    quiesceQueued = true;
+    quiesceStartPending = true;
+    startBurstWindow();
+}
+
+void SystemdTargetLogging::queueLogError(const std::string& errorLog,
+                                         const std::string& result,
+                                         const std::string& unit)
+{
+    auto queued = std::find_if(queuedLogs.begin(), queuedLogs.end(),
+                               [&unit](const auto& log) {
+        return log.unit == unit;
+    });
+    if (queued != queuedLogs.end())
+    {
+        debug("Error for unit {UNIT} already queued", "UNIT", unit);
+        return;
+    }
+    queuedLogs.emplace_back(QueuedLog{errorLog, result, unit});
+    startBurstWindow();
+}
+
+void SystemdTargetLogging::processQueuedActions()
+{
+    // Give the dependency lookups of the burst one more window to complete
+    if (!dependencyLookups.empty() && !burstExtended)
+    {
+        burstExtended = true;
+        burstTimer.restartOnce(burstWindow);
+        return;
+    }
+    burstExtended = false;
+
+    if (dumpQueued)
+    {
+        dumpQueued = false;
+        if (dumpInFlight)
+        {
+            info("BMC dump already in progress, not requesting another");
+        }
+        else
+        {
+            createBmcDump();
+        }
+    }
+
+    if (quiesceStartPending)
+    {
+        quiesceStartPending = false;
+        startBmcQuiesceTarget();
+    }
+
+    // Group the failed units by their root cause. Units with no root cause
+    // found within the burst are their own root.
+    std::vector<std::pair<std::string, std::vector<const QueuedLog*>>> groups;
+    for (const auto& log : queuedLogs)
+    {
+        std::string root = log.unit;
+        if (log.result == "dependency")
+        {
+            root = findRootCause(log.unit).value_or(log.unit);
+        }
+
+        auto group = std::find_if(groups.begin(), groups.end(),
+                                  [&root](const auto& g) {
+            return g.first == root;
+        });
+        if (group == groups.end())
+        {
+            groups.emplace_back(root, std::vector<const QueuedLog*>{&log});
+        }
+        else
+        {
+            group->second.push_back(&log);
+        }
+    }
+
+    for (const auto& [root, logs] : groups)
+    {
+        // Log the error of the root unit if it is monitored, otherwise that
+        // of the first monitored unit which failed because of it
+        auto primary = std::find_if(logs.begin(), logs.end(),
+                                    [&root](const auto& log) {
+            return log->unit == root;
+        });
+        if (primary == logs.end())
+        {
+            primary = logs.begin();
+        }
+
+        std::map<std::string, std::string> additionalData;
+        if ((*primary)->unit != root)
+        {
+            auto failure = recentFailures.find(root);
+            additionalData.emplace("SYSTEMD_ROOT_UNIT", root);
+            additionalData.emplace("SYSTEMD_ROOT_RESULT",
+                                   failure->second.result);
+        }
+
+        std::string dependents;
+        for (const auto& log : logs)
+        {
+            if (log == *primary)
+            {
+                continue;
+            }
+            if (!dependents.empty())
+            {
+                dependents += ",";
+            }
+            dependents += log->unit;
+        }
+        if (!dependents.empty())
+        {
+            info("Combining errors of {DEPENDENTS} with root cause {ROOT}",
+                 "DEPENDENTS", dependents, "ROOT", root);
+            additionalData.emplace("SYSTEMD_DEPENDENT_UNITS", dependents);
+        }
+
+        logError((*primary)->error, (*primary)->result, (*primary)->unit,
+                 std::move(additionalData));
+    }
+    queuedLogs.clear();
+    pruneRecentFailures();
+}
+
+void SystemdTargetLogging::createBmcDump()
+{
+    auto method = this->bus.new_method_call(
+        "xyz.openbmc_project.Dump.Manager", "/xyz/openbmc_project/dump/bmc",
+        "xyz.openbmc_project.Dump.Create", "CreateDump");
+    method.append(
+        std::vector<
+            std::pair<std::string, std::variant<std::string, uint64_t>>>());
+
+    dumpInFlight = callAsync(method, [this](sdbusplus::message_t& reply) {
+        dumpInFlight = false;
+        if (reply.is_method_error())
+        {
+            // just continue, this is error path anyway so we're just
+            // collecting what we can
+            error("Failed to create BMC dump, error:{ERROR}", "ERROR",
+                  reply.get_error()->name);
+        }
+    });
+}
+
+void SystemdTargetLogging::startBmcQuiesceTarget()
+{
+    auto method = this->bus.new_method_call(
+        "org.freedesktop.systemd1", "/org/freedesktop/systemd1",
+        "org.freedesktop.systemd1.Manager", "StartUnit");
+
+    method.append(bmcQuiesceTarget);
+    method.append("replace");
+
+    // Once the start job is queued, its JobRemoved signal tells when it
+    // has completed or failed
+    auto sent = callAsync(method, [this](sdbusplus::message_t& reply) {
+        if (reply.is_method_error())
+        {
+            // just continue, this is error path anyway so we're just doing
+            // what we can
+            error("Failed to start BMC quiesce target, error:{ERROR}", "ERROR",
+                  reply.get_error()->name);
+            quiesceQueued = false;
+        }
+    });
+    if (!sent)
+    {
+        quiesceQueued = false;
+    }
 }
 
-void SystemdTargetLogging::logError(const std::string& errorLog,
-                                    const std::string& result,
-                                    const std::string& unit)
+void SystemdTargetLogging::logError(
+    const std::string& errorLog, const std::string& result,
+    const std::string& unit, std::map<std::string, std::string> additionalData)
 {
     auto method = this->bus.new_method_call(
         "xyz.openbmc_project.Logging", "/xyz/openbmc_project/logging",
@@ -55,19 +392,19 @@ void SystemdTargetLogging::logError(const std::string& errorLog,
     // Signature is ssa{ss}
     method.append(errorLog);
     method.append("xyz.openbmc_project.Logging.Entry.Level.Critical");
-    method.append(std::array<std::pair<std::string, std::string>, 2>(
-        {std::pair<std::string, std::string>({"SYSTEMD_RESULT", result}),
-         std::pair<std::string, std::string>({"SYSTEMD_UNIT", unit})}));
-    try
-    {
-        this->bus.call_noreply(method);
-    }
-    catch (const sdbusplus::exception_t& e)
-    {
-        error("Failed to create systemd target error, error:{ERROR_MSG}, "
-              "result:{RESULT}, exception:{ERROR}",
-              "ERROR_MSG", errorLog, "RESULT", result, "ERROR", e);
-    }
+    additionalData.emplace("SYSTEMD_RESULT", result);
+    additionalData.emplace("SYSTEMD_UNIT", unit);
+    method.append(additionalData);
+
+    callAsync(method, [errorLog, result](sdbusplus::message_t& reply) {
+        if (reply.is_method_error())
+        {
+            error("Failed to create systemd target error, error:{ERROR_MSG}, "
+                  "result:{RESULT}, exception:{ERROR}",
+                  "ERROR_MSG", errorLog, "RESULT", result, "ERROR",
+                  reply.get_error()->name);
+        }
+    });
 }
 
 const std::string SystemdTargetLogging::processError(const std::string& unit,
@@ -77,37 +414,31 @@ const std::string SystemdTargetLogging::processError(const std::string& unit,
     if (targetEntry != this->targetData.end())
     {
         // Check if its result matches any of our monitored errors
-        if (std::find(targetEntry->second.errorsToMonitor.begin(),
-                      targetEntry->second.errorsToMonitor.end(),
-                      result) != targetEntry->second.errorsToMonitor.end())
+        if (targetEntry->second.errorsToMonitor & convertResultToMask(result))
         {
             info(
                 "Monitored systemd unit has hit an error, unit:{UNIT}, result:{RESULT}",
                 "UNIT", unit, "RESULT", result);
 
             // Generate a BMC dump when a monitored target fails
-            utils::createBmcDump(this->bus);
+            queueBmcDump();
             return (targetEntry->second.errorToLog);
         }
     }
 
     // Check if it's in our list of services to monitor
-    if (std::find(this->serviceData.begin(), this->serviceData.end(), unit) !=
-        this->serviceData.end())
+    if ((result == "failed") && this->serviceData.contains(unit))
     {
-        if (result == "failed")
-        {
-            info(
-                "Monitored systemd service has hit an error, unit:{UNIT}, result:{RESULT}",
-                "UNIT", unit, "RESULT", result);
+        info(
+            "Monitored systemd service has hit an error, unit:{UNIT}, result:{RESULT}",
+            "UNIT", unit, "RESULT", result);
 
-            // Generate a BMC dump when a critical service fails
-            utils::createBmcDump(this->bus);
-            // Enter BMC Quiesce when a critical service fails
-            startBmcQuiesceTarget();
-            return (std::string{
-                "xyz.openbmc_project.State.Error.CriticalServiceFailure"});
-        }
+        // Generate a BMC dump when a critical service fails
+        queueBmcDump();
+        // Enter BMC Quiesce when a critical service fails
+        queueBmcQuiesceTarget();
+        return (std::string{
+            "xyz.openbmc_project.State.Error.CriticalServiceFailure"});
     }
 
     return (std::string{});
@@ -122,15 +453,36 @@ void SystemdTargetLogging::systemdUnitChange(sdbusplus::message_t& msg)
 
     msg.read(id, objPath, unit, result);
 
+    // A later critical failure may quiesce the BMC again once the start of
+    // the quiesce target has completed or failed
+    if (unit == bmcQuiesceTarget)
+    {
+        quiesceQueued = false;
+    }
+
     // In most cases it will just be success, in which case just return
     if (result != "done")
     {
+        // Track all failures, monitored or not, as possible root causes of
+        // the monitored failures
+        pruneRecentFailures();
+        recentFailures.insert_or_assign(
+            unit, RecentFailure{result, std::chrono::steady_clock::now()});
+
+        // The dependencies of a unit which failed because of one of them
+        // are read while the burst goes on, to find its root cause
+        if (result == "dependency")
+        {
+            fetchDependencies(unit);
+        }
+
         const std::string error = processError(unit, result);
 
-        // If this is a monitored error then log it
+        // If this is a monitored error then log it once the current burst
+        // of signals has been processed
         if (!error.empty())
         {
-            logError(error, result, unit);
+            queueLogError(error, result, unit);
         }
     }
     return;
@@ -5,6 +5,19 @@
 
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/slot.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 extern bool gVerbose;
 
@@ -28,9 +41,23 @@ class SystemdTargetLogging
     SystemdTargetLogging& operator=(SystemdTargetLogging&&) = delete;
     virtual ~SystemdTargetLogging() = default;
 
-    SystemdTargetLogging(const TargetErrorData& targetData,
-                         const ServiceMonitorData& serviceData,
-                         sdbusplus::bus_t& bus) :
+    /** @brief Default time to collect related failures before logging */
+    static constexpr std::chrono::milliseconds defaultBurstWindow{1000};
+
+    /** @brief Constructs SystemdTargetLogging
+     *
+     * @param[in] targetData   - Systemd targets to monitor, the owner may
+     *                           replace the contents to reload them
+     * @param[in] serviceData  - Systemd services to monitor, the owner may
+     *                           replace the contents to reload them
+     * @param[in] bus          - The Dbus bus object
+     * @param[in] burstWindow  - Time to collect related failures before
+     *                           logging them
+     */
+    SystemdTargetLogging(
+        const TargetErrorData& targetData,
+        const ServiceMonitorData& serviceData, sdbusplus::bus_t& bus,
+        std::chrono::milliseconds burstWindow = defaultBurstWindow) :
         targetData(targetData),
         serviceData(serviceData), bus(bus),
         systemdJobRemovedSignal(
@@ -44,7 +71,19 @@ class SystemdTargetLogging
             [this](sdbusplus::message_t& m) { systemdUnitChange(m); }),
         systemdNameOwnedChangedSignal(
             bus, sdbusplus::bus::match::rules::nameOwnerChanged(),
-            [this](sdbusplus::message_t& m) { processNameChangeSignal(m); })
+            [this](sdbusplus::message_t& m) { processNameChangeSignal(m); }),
+        systemdReloadingSignal(
+            bus,
+            sdbusplus::bus::match::rules::type::signal() +
+                sdbusplus::bus::match::rules::member("Reloading") +
+                sdbusplus::bus::match::rules::path(
+                    "/org/freedesktop/systemd1") +
+                sdbusplus::bus::match::rules::interface(
+                    "org.freedesktop.systemd1.Manager"),
+            [this](sdbusplus::message_t&) { dropDependencies(); }),
+        burstWindow(burstWindow),
+        burstTimer(sdeventplus::Event::get_default(),
+                   [this](auto&) { processQueuedActions(); })
     {}
 
     /**
@@ -68,28 +107,144 @@ class SystemdTargetLogging
     const std::string processError(const std::string& unit,
                                    const std::string& result);
 
+    /** @brief Check if systemd state change is one to monitor
+     *
+     * Instance specific interface to handle the detected systemd state
+     * change
+     *
+     * @note This is public for benchmarking purposes
+     *
+     * @param[in]  msg       - Data associated with subscribed signal
+     *
+     */
+    void systemdUnitChange(sdbusplus::message_t& msg);
+
+    /** @brief Correlate the failures of the burst and issue all queued
+     *         failure actions as async D-Bus calls
+     *
+     * @note This is public for unit testing purposes
+     */
+    void processQueuedActions();
+
+    /** @brief Handle the reply to a read of the dependencies of a unit
+     *
+     * A unit whose dependencies could not be read is cached without any,
+     * so it is not read again within the burst
+     *
+     * @note This is public for unit testing purposes
+     *
+     * @param[in]  unit       - The systemd unit
+     * @param[in]  generation - The dependency cache generation of the read
+     * @param[in]  reply      - The reply to the read
+     */
+    void dependencyReply(const std::string& unit, uint64_t generation,
+                         sdbusplus::message_t& reply);
+
+    /** @brief Drop the cached dependencies as systemd reloads its units
+     *
+     * @note This is public for unit testing purposes
+     */
+    void dropDependencies();
+
   private:
-    /** @brief Start BMC Quiesce Target to indicate critical service failure */
-    void startBmcQuiesceTarget();
+    /** @brief A queued error log for a failed unit */
+    struct QueuedLog
+    {
+        std::string error;
+        std::string result;
+        std::string unit;
+    };
 
-    /** @brief Call phosphor-logging to create error
+    /** @brief A unit which recently hit a non "done" job result */
+    struct RecentFailure
+    {
+        std::string result;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    /** @brief The dependencies of a unit being read from systemd */
+    struct DependencyLookup
+    {
+        std::vector<std::string> units;
+        size_t outstanding = 0;
+    };
+
+    /** @brief Start the burst window if it is not already running */
+    void startBurstWindow();
+
+    /** @brief Drop failures too old to be related to a new burst */
+    void pruneRecentFailures();
+
+    /** @brief Start reading the Requires, Requisite and BindsTo units of
+     *         the input unit from systemd, if they are not already known
+     *
+     * @param[in]  unit       - The systemd unit
+     */
+    void fetchDependencies(const std::string& unit);
+
+    /** @brief Find the unit whose failure caused the input unit to fail
+     *
+     * Walks the dependency graph through units which failed within the
+     * burst until a unit which did not fail due to a dependency is found.
+     * Units whose dependencies are not known yet are not followed.
+     *
+     * @param[in]  unit       - The failed systemd unit
+     *
+     * @return The root cause unit, or std::nullopt if none was found
+     */
+    std::optional<std::string> findRootCause(const std::string& unit);
+
+    /** @brief Queue a BMC dump
+     *
+     * Only one dump is requested per burst of failures, and none while a
+     * previous dump request is still outstanding
+     */
+    void queueBmcDump();
+
+    /** @brief Queue the BMC Quiesce Target to indicate critical service
+     *         failure. It is not queued again until the previous start of
+     *         it has completed or failed.
+     */
+    void queueBmcQuiesceTarget();
+
+    /** @brief Queue a phosphor-logging error for a failed unit
+     *
+     * Only the first error reported for a unit within a burst is logged, and
+     * failures sharing a root cause are combined into a single error
      *
      * @param[in]  error      - The error to log
      * @param[in]  result     - The failure code from the systemd unit
      * @param[in]  unit       - The name of the failed unit
      */
-    void logError(const std::string& error, const std::string& result,
-                  const std::string& unit);
+    void queueLogError(const std::string& error, const std::string& result,
+                       const std::string& unit);
 
-    /** @brief Check if systemd state change is one to monitor
+    /** @brief Call phosphor-dump-manager to create a BMC dump */
+    void createBmcDump();
+
+    /** @brief Start BMC Quiesce Target to indicate critical service failure */
+    void startBmcQuiesceTarget();
+
+    /** @brief Call phosphor-logging to create error
      *
-     * Instance specific interface to handle the detected systemd state
-     * change
+     * @param[in]  error          - The error to log
+     * @param[in]  result         - The failure code from the systemd unit
+     * @param[in]  unit           - The name of the failed unit
+     * @param[in]  additionalData - Extra data to add to the log
+     */
+    void logError(const std::string& error, const std::string& result,
+                  const std::string& unit,
+                  std::map<std::string, std::string> additionalData = {});
+
+    /** @brief Send a method call without waiting for its reply
      *
-     * @param[in]  msg       - Data associated with subscribed signal
+     * @param[in]  method     - The method call to send
+     * @param[in]  onReply    - Called with the reply, or error reply
      *
+     * @return true if the call was sent, false otherwise
      */
-    void systemdUnitChange(sdbusplus::message_t& msg);
+    bool callAsync(sdbusplus::message_t& method,
+                   std::function<void(sdbusplus::message_t&)>&& onReply);
 
     /** @brief Wait for systemd to show up on dbus
      *
@@ -115,6 +270,53 @@ class SystemdTargetLogging
 
     /** @brief Used to know when systemd has registered on dbus **/
     sdbusplus::bus::match_t systemdNameOwnedChangedSignal;
+
+    /** @brief Used to know when systemd reloads its units **/
+    sdbusplus::bus::match_t systemdReloadingSignal;
+
+    /** @brief Time to collect related failures before logging them **/
+    const std::chrono::milliseconds burstWindow;
+
+    /** @brief Timer used to close the burst window **/
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> burstTimer;
+
+    /** @brief The burst was extended to wait for dependency lookups **/
+    bool burstExtended = false;
+
+    /** @brief A BMC dump has been queued for this burst **/
+    bool dumpQueued = false;
+
+    /** @brief A BMC dump request is outstanding **/
+    bool dumpInFlight = false;
+
+    /** @brief The BMC quiesce target has been queued, or its start is
+     *         in progress **/
+    bool quiesceQueued = false;
+
+    /** @brief The BMC quiesce target still needs to be started **/
+    bool quiesceStartPending = false;
+
+    /** @brief Error logs queued for this burst **/
+    std::vector<QueuedLog> queuedLogs;
+
+    /** @brief Units which recently failed, monitored or not **/
+    std::unordered_map<std::string, RecentFailure> recentFailures;
+
+    /** @brief Cached systemd dependency graph **/
+    std::unordered_map<std::string, std::vector<std::string>> dependencies;
+
+    /** @brief Dependency lookups in progress, by unit **/
+    std::unordered_map<std::string, DependencyLookup> dependencyLookups;
+
+    /** @brief Changed on each reload, so replies of reads made before it
+     *         are dropped **/
+    uint64_t dependencyGeneration = 0;
+
+    /** @brief Async D-Bus calls awaiting a reply, by call id **/
+    std::map<uint64_t, sdbusplus::slot_t> pendingCalls;
+
+    /** @brief Id to assign to the next async D-Bus call **/
+    uint64_t nextCallId = 0;
 };
 
 } // namespace manager
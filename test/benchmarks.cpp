@@ -0,0 +1,364 @@
+#include "config.h"
+
+#include <unistd.h>
+
+#include <host_transition_scheduler.hpp>
+#include <hypervisor_state_manager.hpp>
+#include <nlohmann/json.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+#include <sdeventplus/event.hpp>
+#include <systemd_config_cache.hpp>
+#include <systemd_service_parser.hpp>
+#include <systemd_target_parser.hpp>
+#include <systemd_target_signal.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+
+// Keep the parsers quiet within the timed loops
+bool gVerbose = false;
+
+// The Host and Chassis signal handlers and their serialize()/deserialize()
+// are not benchmarked here. Both objects call systemd, the mapper and the
+// settings while they are constructed, and persist their state to the fixed
+// paths of config.h, so they can't run against a mocked bus. The power cycle
+// test measures them on a private bus instead.
+
+namespace fs = std::filesystem;
+
+using namespace phosphor::state::manager;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::StrEq;
+
+namespace
+{
+
+// Size the data like a system with an extended critical service list
+constexpr auto numTargets = 256;
+constexpr auto numServices = 256;
+
+/** @brief Directory for the files written by the benchmarks
+ *
+ * Point TMPDIR at a tmpfs to keep the storage out of the results.
+ */
+class ScratchDir
+{
+  public:
+    ScratchDir() :
+        path(fs::temp_directory_path() /
+             ("psm-benchmarks-" + std::to_string(getpid())))
+    {
+        fs::create_directories(path);
+    }
+
+    ~ScratchDir()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    const fs::path path;
+};
+
+const fs::path& scratchDir()
+{
+    static ScratchDir dir;
+    return dir.path;
+}
+
+std::string targetName(int i)
+{
+    return "obmc-test-" + std::to_string(i) + "@0.target";
+}
+
+std::string serviceName(int i)
+{
+    return "xyz.openbmc_project.Test" + std::to_string(i) + ".service";
+}
+
+TargetErrorData makeTargetData()
+{
+    TargetErrorData targetData;
+    for (auto i = 0; i < numTargets; i++)
+    {
+        targetData.emplace(targetName(i),
+                           targetEntry{"xyz.openbmc_project.Test.Error",
+                                       errorMask::timeout});
+    }
+    return targetData;
+}
+
+ServiceMonitorData makeServiceData()
+{
+    ServiceMonitorData serviceData;
+    for (auto i = 0; i < numServices; i++)
+    {
+        serviceData.emplace(serviceName(i));
+    }
+    return serviceData;
+}
+
+std::string writeTargetFile()
+{
+    nlohmann::json targets;
+    for (auto i = 0; i < numTargets; i++)
+    {
+        targets[targetName(i)] = {
+            {"errorsToMonitor", {"timeout", "failed"}},
+            {"errorToLog", "xyz.openbmc_project.Test.Error"}};
+    }
+
+    auto path = scratchDir() / "targets.json";
+    std::ofstream file(path);
+    file << nlohmann::json{{"targets", targets}};
+    return path;
+}
+
+std::string writeServiceFile()
+{
+    nlohmann::json services = nlohmann::json::array();
+    for (auto i = 0; i < numServices; i++)
+    {
+        services.push_back(serviceName(i));
+    }
+
+    auto path = scratchDir() / "services.json";
+    std::ofstream file(path);
+    file << nlohmann::json{{"services", services}};
+    return path;
+}
+
+/** @brief Read strings from a mocked message, cycling through values */
+auto readStrings(std::vector<const char*> values)
+{
+    return Invoke([values, next = size_t{0}](sd_bus_message*, char,
+                                             void* p) mutable {
+        *static_cast<const char**>(p) = values[next++ % values.size()];
+        return 0;
+    });
+}
+
+/** @brief Mock a JobRemoved signal of a unit with a result */
+void mockJobRemoved(NiceMock<sdbusplus::SdBusMock>& sdbusMock,
+                    const char* unit, const char* result)
+{
+    ON_CALL(sdbusMock, sd_bus_message_read_basic(_, 'u', _))
+        .WillByDefault(Invoke([](sd_bus_message*, char, void* p) {
+        *static_cast<uint32_t*>(p) = 1;
+        return 0;
+    }));
+    ON_CALL(sdbusMock, sd_bus_message_read_basic(_, 'o', _))
+        .WillByDefault(readStrings({"/org/freedesktop/systemd1/job/1"}));
+    ON_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+        .WillByDefault(readStrings({unit, result}));
+}
+
+} // namespace
+
+static void BM_ProcessErrorLookup(benchmark::State& state)
+{
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto targetData = makeTargetData();
+    auto serviceData = makeServiceData();
+    SystemdTargetLogging targetMon(targetData, serviceData, bus);
+
+    // Only lookups which do not result in an error being logged, so that no
+    // D-Bus calls are made within the timed loop
+    const auto lastTarget = targetName(numTargets - 1);
+    const auto lastService = serviceName(numServices - 1);
+    const std::string unknownService = "xyz.openbmc_project.Unknown.service";
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(targetMon.processError(lastTarget, "done"));
+        benchmark::DoNotOptimize(
+            targetMon.processError(lastService, "timeout"));
+        benchmark::DoNotOptimize(
+            targetMon.processError(unknownService, "failed"));
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(BM_ProcessErrorLookup);
+
+static void BM_SystemdUnitChange(benchmark::State& state, const char* result)
+{
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto targetData = makeTargetData();
+    auto serviceData = makeServiceData();
+    SystemdTargetLogging targetMon(targetData, serviceData, bus);
+
+    // An unmonitored unit, so a failure is only recorded as a possible
+    // root cause and nothing is logged
+    mockJobRemoved(sdbusMock, "unmonitored.service", result);
+    sdbusplus::message_t msg(nullptr, &sdbusMock);
+
+    for (auto _ : state)
+    {
+        targetMon.systemdUnitChange(msg);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_SystemdUnitChange, done, "done");
+BENCHMARK_CAPTURE(BM_SystemdUnitChange, failed, "failed");
+
+static void BM_HypervisorBootProgressChange(benchmark::State& state)
+{
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
+
+    // The host has no BootProgress yet when this starts
+    ON_CALL(sdbusMock, sd_bus_message_at_end(_, _)).WillByDefault(Return(1));
+    Hypervisor hypObj(bus, objPathInst.c_str(), 0);
+
+    // Each PropertiesChanged holds only BootProgress, alternating between
+    // two stages so every signal changes the hypervisor state
+    ON_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+        .WillByDefault(Invoke([next = 0](sd_bus_message*, int) mutable {
+        return next++ % 2;
+    }));
+    ON_CALL(sdbusMock, sd_bus_message_verify_type(_, 'v', StrEq("s")))
+        .WillByDefault(Return(1));
+    ON_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+        .WillByDefault(readStrings(
+            {"xyz.openbmc_project.State.Boot.Progress", "BootProgress",
+             "xyz.openbmc_project.State.Boot.Progress.ProgressStages."
+             "OSRunning",
+             "xyz.openbmc_project.State.Boot.Progress", "BootProgress",
+             "xyz.openbmc_project.State.Boot.Progress.ProgressStages."
+             "SystemInitComplete"}));
+    sdbusplus::message_t msg(nullptr, &sdbusMock);
+
+    for (auto _ : state)
+    {
+        hypObj.bootProgressChangeEvent(msg);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HypervisorBootProgressChange);
+
+static void BM_ParseTargetFiles(benchmark::State& state)
+{
+    std::vector<std::string> filePaths{writeTargetFile()};
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parseFiles(filePaths));
+    }
+    state.SetItemsProcessed(state.iterations() * numTargets);
+}
+BENCHMARK(BM_ParseTargetFiles);
+
+static void BM_ParseServiceFiles(benchmark::State& state)
+{
+    std::vector<std::string> filePaths{writeServiceFile()};
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parseServiceFiles(filePaths));
+    }
+    state.SetItemsProcessed(state.iterations() * numServices);
+}
+BENCHMARK(BM_ParseServiceFiles);
+
+static void BM_LoadConfigCache(benchmark::State& state)
+{
+    std::vector<std::string> targetFilePaths{writeTargetFile()};
+    std::vector<std::string> serviceFilePaths{writeServiceFile()};
+    auto cachePath = scratchDir() / "config.cache";
+    writeConfigCache(cachePath, targetFilePaths, serviceFilePaths,
+                     parseFiles(targetFilePaths),
+                     parseServiceFiles(serviceFilePaths));
+
+    for (auto _ : state)
+    {
+        TargetErrorData targetData;
+        ServiceMonitorData serviceData;
+        if (!loadConfigCache(cachePath, targetFilePaths, serviceFilePaths,
+                             targetData, serviceData))
+        {
+            state.SkipWithError("Config cache was not loaded");
+            break;
+        }
+        benchmark::DoNotOptimize(targetData);
+    }
+    state.SetItemsProcessed(state.iterations() * (numTargets + numServices));
+}
+BENCHMARK(BM_LoadConfigCache);
+
+namespace
+{
+
+/** @brief Persist a day of hourly transitions for each of a number of hosts
+ *
+ * @return The file the transitions are persisted in
+ */
+fs::path storeScheduledTransitions(const sdeventplus::Event& event,
+                                   size_t hosts)
+{
+    auto persistPath = scratchDir() / "scheduledHostTransition";
+    fs::remove(persistPath);
+
+    StoredTransitions transitions;
+    for (uint64_t hour = 1; hour <= 24; hour++)
+    {
+        transitions.queue.push_back({hour * 3600, Transition::Reboot});
+    }
+
+    HostTransitionScheduler scheduler(event, persistPath);
+    for (size_t id = 0; id < hosts; id++)
+    {
+        scheduler.storeTransitions(id, transitions);
+    }
+    return persistPath;
+}
+
+} // namespace
+
+static void BM_ScheduledTransitionsSerialize(benchmark::State& state)
+{
+    auto event = sdeventplus::Event::get_default();
+    auto hosts = static_cast<size_t>(state.range(0));
+    auto persistPath = storeScheduledTransitions(event, hosts);
+
+    HostTransitionScheduler scheduler(event, persistPath);
+    auto transitions = scheduler.getStoredTransitions(0).value();
+
+    // Every store writes the transitions of all hosts
+    for (auto _ : state)
+    {
+        scheduler.storeTransitions(0, transitions);
+    }
+    state.SetItemsProcessed(state.iterations() * hosts *
+                            transitions.queue.size());
+}
+BENCHMARK(BM_ScheduledTransitionsSerialize)->Arg(1)->Arg(8);
+
+static void BM_ScheduledTransitionsDeserialize(benchmark::State& state)
+{
+    auto event = sdeventplus::Event::get_default();
+    auto hosts = static_cast<size_t>(state.range(0));
+    auto persistPath = storeScheduledTransitions(event, hosts);
+
+    // The transitions are only read back when the scheduler starts
+    for (auto _ : state)
+    {
+        HostTransitionScheduler scheduler(event, persistPath);
+        benchmark::DoNotOptimize(scheduler.getStoredTransitions(0));
+    }
+    state.SetItemsProcessed(state.iterations() * hosts);
+}
+BENCHMARK(BM_ScheduledTransitionsDeserialize)->Arg(1)->Arg(8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+#include "boot_timing.hpp"
+#include "temp_path.hpp"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+using namespace std::chrono_literals;
+using ProgressStages = BootTiming::ProgressStages;
+
+constexpr auto primaryProcInit =
+    "xyz.openbmc_project.State.Boot.Progress.ProgressStages.PrimaryProcInit";
+constexpr auto memoryInit =
+    "xyz.openbmc_project.State.Boot.Progress.ProgressStages.MemoryInit";
+constexpr auto osStart =
+    "xyz.openbmc_project.State.Boot.Progress.ProgressStages.OSStart";
+
+class TestBootTiming : public testing::Test
+{
+  public:
+    /** @brief Boot through the stages, taking the given ms in each */
+    void boot(BootTiming& timing, uint64_t primaryMs, uint64_t memoryMs)
+    {
+        timing.progress(ProgressStages::PrimaryProcInit, now);
+        now += std::chrono::milliseconds(primaryMs);
+        timing.progress(ProgressStages::MemoryInit, now);
+        now += std::chrono::milliseconds(memoryMs);
+        timing.progress(ProgressStages::OSStart, now);
+        now += 5s;
+        timing.progress(ProgressStages::OSRunning, now);
+        now += 1h;
+        timing.progress(ProgressStages::Unspecified, now);
+    }
+
+    const TempPath path{"psm-boot-timing"};
+    BootTiming::Clock::time_point now{};
+};
+
+TEST_F(TestBootTiming, timesStages)
+{
+    BootTiming timing(path);
+    boot(timing, 1000, 3000);
+
+    auto stages = timing.stages();
+    EXPECT_EQ(std::get<0>(stages.at(primaryProcInit)), 1000);
+    EXPECT_EQ(std::get<0>(stages.at(memoryInit)), 3000);
+    EXPECT_EQ(std::get<0>(stages.at(osStart)), 5000);
+
+    // The OS running is not part of the boot
+    EXPECT_EQ(stages.size(), 3);
+
+    auto ipl = timing.ipl();
+    EXPECT_EQ(std::get<0>(ipl), 4000);
+    EXPECT_EQ(std::get<4>(ipl), 1);
+}
+
+TEST_F(TestBootTiming, rollingStatistics)
+{
+    BootTiming timing(path);
+    boot(timing, 1000, 3000);
+    boot(timing, 3000, 3000);
+    boot(timing, 2000, 3000);
+
+    auto [last, min, max, average, count] = timing.stages().at(primaryProcInit);
+    EXPECT_EQ(last, 2000);
+    EXPECT_EQ(min, 1000);
+    EXPECT_EQ(max, 3000);
+    EXPECT_EQ(count, 3);
+
+    // 1000, then 1000 + 0.25 * 2000 = 1500, then 1500 + 0.25 * 500
+    EXPECT_DOUBLE_EQ(average, 1625);
+}
+
+TEST_F(TestBootTiming, stageNotSeenStartingIsNotTimed)
+{
+    BootTiming timing(path);
+
+    // The BMC was reset during the memory init
+    timing.resume(ProgressStages::MemoryInit);
+    now += 1s;
+    EXPECT_FALSE(timing.progress(ProgressStages::OSStart, now));
+    EXPECT_TRUE(timing.stages().empty());
+    EXPECT_EQ(std::get<4>(timing.ipl()), 0);
+}
+
+TEST_F(TestBootTiming, warmReboot)
+{
+    BootTiming timing(path);
+    timing.progress(ProgressStages::PrimaryProcInit, now);
+    now += 1s;
+    timing.progress(ProgressStages::OSRunning, now);
+    now += 1h;
+
+    // Straight from the OS to the next boot
+    EXPECT_FALSE(timing.progress(ProgressStages::PrimaryProcInit, now));
+    now += 2s;
+    timing.progress(ProgressStages::OSStart, now);
+
+    EXPECT_EQ(std::get<0>(timing.stages().at(primaryProcInit)), 2000);
+    EXPECT_EQ(std::get<0>(timing.ipl()), 2000);
+    EXPECT_EQ(std::get<4>(timing.ipl()), 2);
+}
+
+TEST_F(TestBootTiming, persisted)
+{
+    {
+        BootTiming timing(path);
+        boot(timing, 1000, 3000);
+    }
+
+    BootTiming timing(path);
+    EXPECT_EQ(std::get<0>(timing.stages().at(memoryInit)), 3000);
+    EXPECT_EQ(std::get<0>(timing.ipl()), 4000);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,229 @@
+#include "config.h"
+
+#include "chassis_state_manager.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+#include <sdeventplus/event.hpp>
+#include <xyz/openbmc_project/Common/error.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace phosphor::state::manager;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+using PowerStatus = sdbusplus::xyz::openbmc_project::State::server::Chassis::
+    PowerStatus;
+using Transition =
+    sdbusplus::xyz::openbmc_project::State::server::Chassis::Transition;
+
+namespace
+{
+
+/** @brief Read a string from a mocked message */
+auto readString(const char* value)
+{
+    return Invoke([value](sd_bus_message*, char, void* p) {
+        *static_cast<const char**>(p) = value;
+        return 0;
+    });
+}
+
+} // namespace
+
+class TestChassis : public testing::Test
+{
+  public:
+    /** @brief A method call made by the chassis */
+    struct Call
+    {
+        std::string member;
+        std::vector<std::string> strings;
+        std::vector<uint32_t> numbers;
+    };
+
+    TestChassis() : bus(sdbusplus::get_mocked_new(&sdbusMock))
+    {
+        // Record the method calls made, each with its own message
+        ON_CALL(sdbusMock, sd_bus_message_new_method_call(_, _, _, _, _, _))
+            .WillByDefault(Invoke([this](sd_bus*, sd_bus_message** m,
+                                         const char*, const char*,
+                                         const char*, const char* member) {
+            calls.push_back({member, {}, {}});
+            *m = reinterpret_cast<sd_bus_message*>(calls.size());
+            return 0;
+        }));
+        ON_CALL(sdbusMock, sd_bus_message_append_basic(_, _, _))
+            .WillByDefault(Invoke(
+                [this](sd_bus_message* m, char type, const void* value) {
+            auto index = reinterpret_cast<size_t>(m);
+            if ((index == 0) || (index > calls.size()))
+            {
+                return 0;
+            }
+            if (type == 's')
+            {
+                calls[index - 1].strings.emplace_back(
+                    static_cast<const char*>(value));
+            }
+            else if (type == 'u')
+            {
+                calls[index - 1].numbers.push_back(
+                    *static_cast<const uint32_t*>(value));
+            }
+            return 0;
+        }));
+        ON_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+            .WillByDefault(Invoke([](sd_bus*, sd_bus_slot** slot,
+                                     sd_bus_message*, sd_bus_message_handler_t,
+                                     void*, uint64_t) {
+            *slot = nullptr;
+            return 0;
+        }));
+
+        // The replies are empty, there is no UPS, power supply or pgood
+        ON_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+            .WillByDefault(Return(1));
+
+        chassis = std::make_unique<Chassis>(
+            bus, (std::string{CHASSIS_OBJPATH} + '0').c_str(), 0);
+        calls.clear();
+    }
+
+    /** @brief Have the chassis handle a JobNew signal of a unit */
+    void jobNew(uint32_t jobId, const char* unit)
+    {
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 'u', _))
+            .WillOnce(Invoke([jobId](sd_bus_message*, char, void* p) {
+            *static_cast<uint32_t*>(p) = jobId;
+            return 0;
+        }));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 'o', _))
+            .WillOnce(readString("/org/freedesktop/systemd1/job/1"));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+            .WillOnce(readString(unit));
+
+        auto msg = sdbusplus::message_t(nullptr, &sdbusMock);
+        chassis->sysStateChangeJobNew(msg);
+    }
+
+    /** @brief Have the chassis handle a JobRemoved signal of a unit */
+    void jobRemoved(const char* unit, const char* result)
+    {
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 'u', _))
+            .WillOnce(Invoke([](sd_bus_message*, char, void* p) {
+            *static_cast<uint32_t*>(p) = 42;
+            return 0;
+        }));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 'o', _))
+            .WillOnce(readString("/org/freedesktop/systemd1/job/1"));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+            .WillOnce(readString(unit))
+            .WillOnce(readString(result));
+
+        auto msg = sdbusplus::message_t(nullptr, &sdbusMock);
+        chassis->sysStateChange(msg);
+    }
+
+    /** @brief Get the calls made of a method */
+    std::vector<Call> made(const std::string& member) const
+    {
+        std::vector<Call> found;
+        std::copy_if(calls.begin(), calls.end(), std::back_inserter(found),
+                     [&member](const auto& call) {
+            return call.member == member;
+        });
+        return found;
+    }
+
+    sdeventplus::Event event = sdeventplus::Event::get_default();
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    sdbusplus::bus_t bus;
+    std::vector<Call> calls;
+    std::unique_ptr<Chassis> chassis;
+};
+
+TEST_F(TestChassis, powerOnNotAllowed)
+{
+#if ONLY_ALLOW_BOOT_WHEN_BMC_READY
+    GTEST_SKIP() << "The BMC is never ready on the mocked bus";
+#endif
+    chassis->currentPowerStatus(PowerStatus::BrownOut);
+
+    EXPECT_THROW(chassis->requestedPowerTransition(Transition::On),
+                 sdbusplus::xyz::openbmc_project::Common::Error::NotAllowed);
+    EXPECT_TRUE(made("StartUnit").empty());
+
+    // The user is told why the system doesn't power on
+    auto logs = made("Create");
+    ASSERT_EQ(logs.size(), 1);
+    EXPECT_EQ(logs[0].strings.front(),
+              "xyz.openbmc_project.State.ChassisPowerBad");
+
+    // Powering off is still allowed
+    chassis->requestedPowerTransition(Transition::Off);
+    auto starts = made("StartUnit");
+    ASSERT_EQ(starts.size(), 1);
+    EXPECT_EQ(starts[0].strings.front(), "obmc-chassis-poweroff@0.target");
+}
+
+TEST_F(TestChassis, queuedPowerOnStopped)
+{
+    chassis->currentPowerStatus(PowerStatus::BrownOut);
+
+    jobNew(42, "obmc-chassis-poweron@0.target");
+
+    // The poweroff target flushes the queued power on jobs
+    auto starts = made("StartUnit");
+    ASSERT_EQ(starts.size(), 1);
+    EXPECT_EQ(starts[0].strings,
+              (std::vector<std::string>{"obmc-chassis-poweroff@0.target",
+                                        "replace"}));
+    EXPECT_EQ(made("Create").size(), 1);
+}
+
+TEST_F(TestChassis, powerStartWithBadPower)
+{
+    chassis->currentPowerStatus(PowerStatus::BrownOut);
+
+    jobNew(42, "obmc-chassis-poweron@0.target");
+
+    // Even if the power start service still completes, the chassis is
+    // not powered on
+    jobRemoved("obmc-power-start@0.service", "done");
+
+    EXPECT_TRUE(made("setPowerState").empty());
+    auto starts = made("StartUnit");
+    ASSERT_EQ(starts.size(), 2);
+    EXPECT_EQ(starts[1].strings.front(), "obmc-chassis-poweroff@0.target");
+}
+
+TEST_F(TestChassis, queuedPowerOnStarted)
+{
+    jobNew(42, "obmc-chassis-poweron@0.target");
+
+    EXPECT_TRUE(made("CancelJob").empty());
+    auto logs = made("Create");
+    ASSERT_EQ(logs.size(), 1);
+    EXPECT_EQ(logs[0].strings.front(),
+              "xyz.openbmc_project.State.Info.ChassisPowerOnStarted");
+}
+
+TEST_F(TestChassis, otherJobsIgnored)
+{
+    chassis->currentPowerStatus(PowerStatus::BrownOut);
+
+    jobNew(42, "obmc-chassis-poweroff@0.target");
+
+    EXPECT_TRUE(calls.empty());
+}
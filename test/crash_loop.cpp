@@ -0,0 +1,163 @@
+#include "crash_loop.hpp"
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/deque.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+using namespace std::chrono_literals;
+
+class TestCrashLoop : public testing::Test
+{
+  public:
+    /** @brief Get a time, in milliseconds since epoch */
+    static uint64_t at(std::chrono::seconds time)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(time)
+            .count();
+    }
+
+    const CrashLoop::Limits limits{600s, 30s, 300s, 32};
+};
+
+TEST_F(TestCrashLoop, noCrashes)
+{
+    CrashLoop crashLoop(limits);
+    EXPECT_EQ(crashLoop.inWindow(at(1000s)), 0);
+    EXPECT_EQ(crashLoop.rebootDelay(at(1000s)), 0);
+    EXPECT_EQ(crashLoop.lastCrash(), 0);
+}
+
+TEST_F(TestCrashLoop, backoff)
+{
+    CrashLoop crashLoop(limits);
+
+    // The first crash reboots right away
+    crashLoop.record(at(1000s));
+    EXPECT_EQ(crashLoop.rebootDelay(at(1000s)), 0);
+
+    // Then the delay doubles from the backoff up to the max backoff
+    auto now = at(1000s);
+    for (auto expected : {30, 60, 120, 240, 300, 300})
+    {
+        now += 1000;
+        crashLoop.record(now);
+        EXPECT_EQ(crashLoop.rebootDelay(now), expected);
+    }
+    EXPECT_EQ(crashLoop.inWindow(at(1010s)), 7);
+    EXPECT_EQ(crashLoop.lastCrash(), at(1006s));
+}
+
+TEST_F(TestCrashLoop, windowPruning)
+{
+    CrashLoop crashLoop(limits);
+    crashLoop.record(at(1000s));
+    crashLoop.record(at(1100s));
+    EXPECT_EQ(crashLoop.rebootDelay(at(1100s)), 30);
+
+    // The first crash ages out of the window
+    EXPECT_EQ(crashLoop.inWindow(at(1650s)), 1);
+    EXPECT_EQ(crashLoop.rebootDelay(at(1650s)), 0);
+
+    // And is dropped by the next one
+    crashLoop.record(at(1650s));
+    EXPECT_EQ(crashLoop.inWindow(at(1650s)), 2);
+    EXPECT_EQ(crashLoop.rebootDelay(at(1650s)), 30);
+
+    // Then all age out
+    EXPECT_EQ(crashLoop.inWindow(at(3000s)), 0);
+}
+
+TEST_F(TestCrashLoop, clockSetBack)
+{
+    CrashLoop crashLoop(limits);
+    crashLoop.record(at(10000s));
+    crashLoop.record(at(10001s));
+
+    // The crashes after it are from before the clock was set back
+    crashLoop.record(at(5000s));
+    EXPECT_EQ(crashLoop.inWindow(at(5000s)), 1);
+    EXPECT_EQ(crashLoop.rebootDelay(at(5000s)), 0);
+    EXPECT_EQ(crashLoop.lastCrash(), at(5000s));
+
+    // So they are not counted once the clock passes them again
+    EXPECT_EQ(crashLoop.inWindow(at(10002s)), 0);
+}
+
+TEST_F(TestCrashLoop, clockNearEpoch)
+{
+    // The window starts at the epoch, not before it
+    CrashLoop crashLoop(limits);
+    crashLoop.record(at(0s));
+    crashLoop.record(at(10s));
+    EXPECT_EQ(crashLoop.inWindow(at(10s)), 2);
+}
+
+TEST_F(TestCrashLoop, maxCrashes)
+{
+    CrashLoop crashLoop({600s, 30s, 300s, 2});
+    crashLoop.record(at(1000s));
+    crashLoop.record(at(1001s));
+    crashLoop.record(at(1002s));
+
+    EXPECT_EQ(crashLoop.inWindow(at(1002s)), 2);
+    EXPECT_EQ(crashLoop.lastCrash(), at(1002s));
+}
+
+TEST_F(TestCrashLoop, archive)
+{
+    CrashLoop crashLoop(limits);
+    crashLoop.record(at(1000s));
+    crashLoop.record(at(1001s));
+
+    std::stringstream stream;
+    {
+        cereal::BinaryOutputArchive archive(stream);
+        archive(crashLoop);
+    }
+
+    CrashLoop restored(limits);
+    {
+        cereal::BinaryInputArchive archive(stream);
+        archive(restored);
+    }
+    EXPECT_EQ(restored.inWindow(at(1001s)), 2);
+    EXPECT_EQ(restored.lastCrash(), at(1001s));
+}
+
+TEST_F(TestCrashLoop, archiveOfVersion3)
+{
+    // Version 3 of the host state starts with the crash times, oldest
+    // first, followed by the reboot attempts left
+    std::stringstream stream;
+    {
+        cereal::BinaryOutputArchive archive(stream);
+        archive(std::deque<uint64_t>{at(1000s), at(1001s)}, uint32_t{3});
+    }
+
+    CrashLoop crashLoop(limits);
+    uint32_t retryAttempts = 0;
+    {
+        cereal::BinaryInputArchive archive(stream);
+        archive(crashLoop, retryAttempts);
+    }
+    EXPECT_EQ(crashLoop.inWindow(at(1001s)), 2);
+    EXPECT_EQ(crashLoop.lastCrash(), at(1001s));
+    EXPECT_EQ(retryAttempts, 3);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,574 @@
+/**
+ * A stand-in for systemd, the object mapper, the settings daemon and the
+ * pgood service, used to run the state managers on a private bus.
+ *
+ * Starting a target runs the jobs of the units it pulls in, one after the
+ * other, with JobNew and JobRemoved signals just like systemd. The job of
+ * each unit takes a configurable delay.
+ */
+#include <systemd/sd-bus.h>
+
+#include <CLI/CLI.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/message.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace
+{
+
+using namespace std::chrono;
+
+constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
+constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
+constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
+constexpr auto SYSTEMD_INTERFACE_UNIT = "org.freedesktop.systemd1.Unit";
+constexpr auto SYSTEMD_UNIT_PATH = "/org/freedesktop/systemd1/unit/";
+constexpr auto SYSTEMD_JOB_PATH = "/org/freedesktop/systemd1/job/";
+
+constexpr auto MAPPER_BUSNAME = "xyz.openbmc_project.ObjectMapper";
+constexpr auto MAPPER_PATH = "/xyz/openbmc_project/object_mapper";
+constexpr auto MAPPER_INTERFACE = "xyz.openbmc_project.ObjectMapper";
+
+constexpr auto SETTINGS_BUSNAME = "xyz.openbmc_project.Settings";
+constexpr auto SETTINGS_PATH = "/xyz/openbmc_project/control";
+constexpr auto AUTO_REBOOT_INTERFACE =
+    "xyz.openbmc_project.Control.Boot.RebootPolicy";
+constexpr auto RESTORE_POLICY_INTERFACE =
+    "xyz.openbmc_project.Control.Power.RestorePolicy";
+
+constexpr auto POWER_BUSNAME = "org.openbmc.control.Power";
+constexpr auto POWER_PATH = "/org/openbmc/control/power0";
+
+constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+
+/** @brief The units pulled in by starting a target, in the order their jobs
+ *         complete. Any other unit only runs its own job.
+ */
+const std::map<std::string, std::vector<std::string>> transactionPatterns = {
+    {"obmc-host-start@{}.target",
+     {"obmc-power-start@{}.service", "obmc-chassis-poweron@{}.target",
+      "obmc-host-startmin@{}.target", "obmc-host-start@{}.target"}},
+    {"obmc-host-shutdown@{}.target",
+     {"obmc-host-stop@{}.target", "obmc-chassis-poweroff@{}.target",
+      "obmc-host-shutdown@{}.target"}},
+    {"obmc-host-reboot@{}.target",
+     {"obmc-host-stop@{}.target", "obmc-host-reboot@{}.target",
+      "obmc-host-startmin@{}.target"}},
+    {"obmc-host-warm-reboot@{}.target",
+     {"obmc-host-stop@{}.target", "obmc-host-warm-reboot@{}.target",
+      "obmc-host-startmin@{}.target"}},
+    {"obmc-chassis-poweroff@{}.target",
+     {"obmc-host-stop@{}.target", "obmc-chassis-poweroff@{}.target"}},
+};
+
+/** @brief The units stopped when a unit becomes active */
+const std::map<std::string, std::vector<std::string>> conflictPatterns = {
+    {"obmc-host-startmin@{}.target",
+     {"obmc-host-stop@{}.target", "obmc-host-shutdown@{}.target",
+      "obmc-host-reboot@{}.target", "obmc-host-warm-reboot@{}.target"}},
+    {"obmc-host-start@{}.target", {"obmc-host-shutdown@{}.target"}},
+    {"obmc-host-stop@{}.target",
+     {"obmc-host-startmin@{}.target", "obmc-host-start@{}.target"}},
+    {"obmc-host-shutdown@{}.target", {"obmc-host-start@{}.target"}},
+    {"obmc-chassis-poweron@{}.target", {"obmc-chassis-poweroff@{}.target"}},
+    {"obmc-chassis-poweroff@{}.target", {"obmc-chassis-poweron@{}.target"}},
+};
+
+/** @brief The units which are active when this starts */
+const std::vector<std::string> initialActivePatterns = {
+    "obmc-host-stop@{}.target",
+    "obmc-chassis-poweroff@{}.target",
+};
+
+std::string instance(const std::string& pattern, size_t id)
+{
+    auto unit = pattern;
+    auto pos = unit.find("{}");
+    if (pos != std::string::npos)
+    {
+        unit.replace(pos, 2, std::to_string(id));
+    }
+    return unit;
+}
+
+/** @brief Escape a unit name into an object path element, like systemd */
+std::string escapeUnit(const std::string& unit)
+{
+    static constexpr auto hex = "0123456789abcdef";
+
+    std::string escaped;
+    for (unsigned char c : unit)
+    {
+        if (std::isalnum(c))
+        {
+            escaped += static_cast<char>(c);
+        }
+        else
+        {
+            escaped += '_';
+            escaped += hex[c >> 4];
+            escaped += hex[c & 0xf];
+        }
+    }
+    return escaped;
+}
+
+class FakeSystemd
+{
+  public:
+    FakeSystemd(sdbusplus::bus_t& bus, const sdeventplus::Event& event,
+                const std::vector<size_t>& ids, milliseconds defaultDelay,
+                const std::map<std::string, milliseconds>& unitDelays) :
+        bus(bus),
+        timer(event, [this](auto&) { runJob(); }), defaultDelay(defaultDelay),
+        unitDelays(unitDelays)
+    {
+        activeUnits.insert("multi-user.target");
+
+        for (auto id : ids)
+        {
+            for (const auto& [pattern, units] : transactionPatterns)
+            {
+                auto& transaction = transactions[instance(pattern, id)];
+                for (const auto& unit : units)
+                {
+                    transaction.push_back(instance(unit, id));
+                }
+            }
+            for (const auto& [pattern, units] : conflictPatterns)
+            {
+                auto& conflict = conflicts[instance(pattern, id)];
+                for (const auto& unit : units)
+                {
+                    conflict.push_back(instance(unit, id));
+                }
+            }
+            for (const auto& pattern : initialActivePatterns)
+            {
+                activeUnits.insert(instance(pattern, id));
+            }
+
+            auto control = std::string{SETTINGS_PATH} + "/host" +
+                           std::to_string(id);
+            settings.emplace(control + "/auto_reboot", AUTO_REBOOT_INTERFACE);
+            settings.emplace(control + "/auto_reboot/one_time",
+                             AUTO_REBOOT_INTERFACE);
+            settings.emplace(control + "/power_restore_policy",
+                             RESTORE_POLICY_INTERFACE);
+            settings.emplace(control + "/power_restore_policy/one_time",
+                             RESTORE_POLICY_INTERFACE);
+        }
+
+        sd_bus_add_fallback(bus.get(), nullptr, SYSTEMD_OBJ_PATH,
+                            &FakeSystemd::onSystemdCall, this);
+        sd_bus_add_object(bus.get(), nullptr, MAPPER_PATH,
+                          &FakeSystemd::onMapperCall, this);
+        sd_bus_add_fallback(bus.get(), nullptr, SETTINGS_PATH,
+                            &FakeSystemd::onSettingsCall, this);
+        sd_bus_add_object(bus.get(), nullptr, POWER_PATH,
+                          &FakeSystemd::onPowerCall, this);
+    }
+
+  private:
+    struct Job
+    {
+        uint32_t id;
+        std::string unit;
+    };
+
+    static int onSystemdCall(sd_bus_message* m, void* userdata,
+                             sd_bus_error* retError)
+    {
+        sdbusplus::message_t msg(m);
+        return static_cast<FakeSystemd*>(userdata)->systemdCall(msg,
+                                                                retError);
+    }
+
+    static int onMapperCall(sd_bus_message* m, void* userdata,
+                            sd_bus_error* retError)
+    {
+        sdbusplus::message_t msg(m);
+        return static_cast<FakeSystemd*>(userdata)->mapperCall(msg, retError);
+    }
+
+    static int onSettingsCall(sd_bus_message* m, void* userdata,
+                              sd_bus_error* /* retError */)
+    {
+        sdbusplus::message_t msg(m);
+        return static_cast<FakeSystemd*>(userdata)->settingsCall(msg);
+    }
+
+    static int onPowerCall(sd_bus_message* m, void* /* userdata */,
+                           sd_bus_error* /* retError */)
+    {
+        sdbusplus::message_t msg(m);
+        std::string member = msg.get_member();
+        if (member == "setPowerState")
+        {
+            msg.new_method_return().method_return();
+            return 1;
+        }
+        if (member != "Get")
+        {
+            return 0;
+        }
+
+        // The chassis is always found off when the managers start
+        auto reply = msg.new_method_return();
+        reply.append(std::variant<int>(0));
+        reply.method_return();
+        return 1;
+    }
+
+    int systemdCall(sdbusplus::message_t& msg, sd_bus_error* retError)
+    {
+        std::string interface = msg.get_interface();
+        std::string member = msg.get_member();
+        std::string path = msg.get_path();
+
+        if (interface == SYSTEMD_INTERFACE)
+        {
+            if ((member == "StartUnit") || (member == "RestartUnit"))
+            {
+                std::string unit;
+                std::string mode;
+                msg.read(unit, mode);
+
+                auto reply = msg.new_method_return();
+                reply.append(startUnit(unit));
+                reply.method_return();
+                return 1;
+            }
+            if (member == "GetUnit")
+            {
+                // Every unit is loaded, and inactive until started
+                std::string unit;
+                msg.read(unit);
+
+                auto reply = msg.new_method_return();
+                reply.append(sdbusplus::message::object_path(unitPath(unit)));
+                reply.method_return();
+                return 1;
+            }
+            if ((member == "Subscribe") || (member == "Unsubscribe") ||
+                (member == "StopUnit") || (member == "ResetFailedUnit"))
+            {
+                auto reply = msg.new_method_return();
+                if (member == "StopUnit")
+                {
+                    std::string unit;
+                    std::string mode;
+                    msg.read(unit, mode);
+                    activeUnits.erase(unit);
+                    reply.append(
+                        sdbusplus::message::object_path(jobPath(nextJobId++)));
+                }
+                reply.method_return();
+                return 1;
+            }
+            return 0;
+        }
+
+        if ((interface == PROPERTY_INTERFACE) && (member == "Get") &&
+            path.starts_with(SYSTEMD_UNIT_PATH))
+        {
+            std::string propInterface;
+            std::string property;
+            msg.read(propInterface, property);
+            if (propInterface != SYSTEMD_INTERFACE_UNIT)
+            {
+                return sd_bus_error_setf(
+                    retError, "org.freedesktop.DBus.Error.UnknownInterface",
+                    "Unknown interface %s", propInterface.c_str());
+            }
+
+            auto unit = unitNames.find(path);
+            bool active = (unit != unitNames.end()) &&
+                          activeUnits.contains(unit->second);
+
+            std::string value;
+            if (property == "ActiveState")
+            {
+                value = active ? "active" : "inactive";
+            }
+            else if (property == "SubState")
+            {
+                value = active ? "active" : "dead";
+            }
+            else if (property == "LoadState")
+            {
+                value = "loaded";
+            }
+            else
+            {
+                return sd_bus_error_setf(
+                    retError, "org.freedesktop.DBus.Error.UnknownProperty",
+                    "Unknown property %s.%s", propInterface.c_str(),
+                    property.c_str());
+            }
+
+            auto reply = msg.new_method_return();
+            reply.append(std::variant<std::string>(value));
+            reply.method_return();
+            return 1;
+        }
+
+        return 0;
+    }
+
+    int mapperCall(sdbusplus::message_t& msg, sd_bus_error* retError)
+    {
+        using Interfaces = std::vector<std::string>;
+
+        std::string member = msg.get_member();
+        if (member == "GetSubTree")
+        {
+            std::string root;
+            int32_t depth;
+            Interfaces interfaces;
+            msg.read(root, depth, interfaces);
+
+            std::map<std::string, std::map<std::string, Interfaces>> subTree;
+            for (const auto& [path, interface] : settings)
+            {
+                bool inTree = (root == "/") || (path == root) ||
+                              path.starts_with(root + "/");
+                bool matches = interfaces.empty() ||
+                               std::find(interfaces.begin(), interfaces.end(),
+                                         interface) != interfaces.end();
+                if (inTree && matches)
+                {
+                    subTree[path][SETTINGS_BUSNAME].push_back(interface);
+                }
+            }
+
+            auto reply = msg.new_method_return();
+            reply.append(subTree);
+            reply.method_return();
+            return 1;
+        }
+        if (member == "GetObject")
+        {
+            std::string path;
+            Interfaces interfaces;
+            msg.read(path, interfaces);
+
+            if (path == POWER_PATH)
+            {
+                std::map<std::string, Interfaces> object{
+                    {POWER_BUSNAME, {POWER_BUSNAME}}};
+                auto reply = msg.new_method_return();
+                reply.append(object);
+                reply.method_return();
+                return 1;
+            }
+
+            auto setting = settings.find(path);
+            if (setting == settings.end())
+            {
+                return sd_bus_error_setf(
+                    retError, "xyz.openbmc_project.Common.Error."
+                              "ResourceNotFound",
+                    "No object at %s", path.c_str());
+            }
+
+            std::map<std::string, Interfaces> object{
+                {SETTINGS_BUSNAME, {setting->second}}};
+            auto reply = msg.new_method_return();
+            reply.append(object);
+            reply.method_return();
+            return 1;
+        }
+        return 0;
+    }
+
+    int settingsCall(sdbusplus::message_t& msg)
+    {
+        std::string member = msg.get_member();
+        if (member == "Set")
+        {
+            // Nothing reads back what the managers set
+            msg.new_method_return().method_return();
+            return 1;
+        }
+        if (member != "Get")
+        {
+            return 0;
+        }
+
+        std::string interface;
+        std::string property;
+        msg.read(interface, property);
+
+        auto reply = msg.new_method_return();
+        if (property == "AutoReboot")
+        {
+            reply.append(std::variant<bool>(true));
+        }
+        else if (property == "PowerRestoreDelay")
+        {
+            reply.append(std::variant<uint64_t>(uint64_t{0}));
+        }
+        else
+        {
+            reply.append(std::variant<std::string>(
+                "xyz.openbmc_project.Control.Power.RestorePolicy.Policy."
+                "None"));
+        }
+        reply.method_return();
+        return 1;
+    }
+
+    /** @brief Queue the jobs of a unit and the units it pulls in
+     *
+     * @return The path of the job of the unit itself
+     */
+    sdbusplus::message::object_path startUnit(const std::string& unit)
+    {
+        std::vector<std::string> units{unit};
+        auto transaction = transactions.find(unit);
+        if (transaction != transactions.end())
+        {
+            units = transaction->second;
+        }
+
+        uint32_t unitJob = 0;
+        for (const auto& jobUnit : units)
+        {
+            auto id = nextJobId++;
+            if (jobUnit == unit)
+            {
+                unitJob = id;
+            }
+            auto signal = bus.new_signal(SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE,
+                                         "JobNew");
+            signal.append(id, sdbusplus::message::object_path(jobPath(id)),
+                          jobUnit);
+            signal.signal_send();
+
+            queue.push_back({id, jobUnit});
+        }
+
+        if (!timer.isEnabled())
+        {
+            timer.restart(getDelay(queue.front().unit));
+        }
+        return jobPath(unitJob);
+    }
+
+    /** @brief Complete the job at the head of the queue */
+    void runJob()
+    {
+        auto job = queue.front();
+        queue.pop_front();
+
+        activeUnits.insert(job.unit);
+        auto conflict = conflicts.find(job.unit);
+        if (conflict != conflicts.end())
+        {
+            for (const auto& unit : conflict->second)
+            {
+                activeUnits.erase(unit);
+            }
+        }
+
+        auto signal = bus.new_signal(SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE,
+                                     "JobRemoved");
+        signal.append(job.id, sdbusplus::message::object_path(jobPath(job.id)),
+                      job.unit, "done");
+        signal.signal_send();
+
+        if (!queue.empty())
+        {
+            timer.restart(getDelay(queue.front().unit));
+        }
+    }
+
+    milliseconds getDelay(const std::string& unit) const
+    {
+        auto delay = unitDelays.find(unit);
+        return (delay != unitDelays.end()) ? delay->second : defaultDelay;
+    }
+
+    std::string unitPath(const std::string& unit)
+    {
+        auto path = std::string{SYSTEMD_UNIT_PATH} + escapeUnit(unit);
+        unitNames.emplace(path, unit);
+        return path;
+    }
+
+    static std::string jobPath(uint32_t id)
+    {
+        return std::string{SYSTEMD_JOB_PATH} + std::to_string(id);
+    }
+
+    sdbusplus::bus_t& bus;
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> timer;
+    const milliseconds defaultDelay;
+    const std::map<std::string, milliseconds> unitDelays;
+
+    std::map<std::string, std::vector<std::string>> transactions;
+    std::map<std::string, std::vector<std::string>> conflicts;
+    std::set<std::string> activeUnits;
+    std::map<std::string, std::string> unitNames;
+    std::map<std::string, std::string> settings;
+    std::deque<Job> queue;
+    uint32_t nextJobId = 1;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"systemd stand-in for the state manager power cycle test"};
+
+    std::vector<size_t> ids{0};
+    unsigned delay = 10;
+    std::vector<std::string> unitDelayArgs;
+
+    app.add_option("-i,--instance", ids, "Chassis/host instances, default 0");
+    app.add_option("-d,--delay", delay, "Milliseconds each job takes");
+    app.add_option("-u,--unit-delay", unitDelayArgs,
+                   "Milliseconds the job of a unit takes, as <unit>=<ms>");
+
+    CLI11_PARSE(app, argc, argv);
+
+    std::map<std::string, milliseconds> unitDelays;
+    for (const auto& arg : unitDelayArgs)
+    {
+        auto pos = arg.find('=');
+        if (pos == std::string::npos)
+        {
+            std::cerr << "Invalid unit delay " << arg << std::endl;
+            return 1;
+        }
+        unitDelays.emplace(arg.substr(0, pos),
+                           milliseconds(std::stoul(arg.substr(pos + 1))));
+    }
+
+    auto bus = sdbusplus::bus::new_default();
+    auto event = sdeventplus::Event::get_default();
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+
+    FakeSystemd systemd(bus, event, ids, milliseconds(delay), unitDelays);
+
+    bus.request_name(SYSTEMD_SERVICE);
+    bus.request_name(MAPPER_BUSNAME);
+    bus.request_name(SETTINGS_BUSNAME);
+    bus.request_name(POWER_BUSNAME);
+
+    return event.loop();
+}
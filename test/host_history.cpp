@@ -0,0 +1,123 @@
+#include "host_history.hpp"
+#include "temp_path.hpp"
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+using HostState = HostHistory::HostState;
+using ProgressStages = HostHistory::ProgressStages;
+using OSStatus = HostHistory::OSStatus;
+using RestartCause = HostHistory::RestartCause;
+
+class TestHostHistory : public testing::Test
+{
+  public:
+    static HostHistory::Entry entry(uint64_t time, HostState state)
+    {
+        return {time, state, ProgressStages::Unspecified, OSStatus::Inactive,
+                RestartCause::Unknown};
+    }
+
+    const TempPath path{"psm-host-history"};
+};
+
+TEST_F(TestHostHistory, emptyWithoutFile)
+{
+    HostHistory history(path);
+    EXPECT_EQ(history.size(), 0);
+    EXPECT_TRUE(history.get(0).empty());
+}
+
+TEST_F(TestHostHistory, skipsUnchangedStates)
+{
+    HostHistory history(path);
+    EXPECT_TRUE(history.add(entry(1, HostState::Off)));
+    EXPECT_FALSE(history.add(entry(2, HostState::Off)));
+    EXPECT_TRUE(history.add(entry(3, HostState::Running)));
+    EXPECT_EQ(history.size(), 2);
+}
+
+TEST_F(TestHostHistory, getSince)
+{
+    HostHistory history(path);
+    history.add(entry(10, HostState::Off));
+    history.add(entry(20, HostState::TransitioningToRunning));
+    history.add(entry(30, HostState::Running));
+
+    auto records = history.get(10);
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(std::get<0>(records[0]), 20);
+    EXPECT_EQ(std::get<1>(records[0]),
+              "xyz.openbmc_project.State.Host.HostState."
+              "TransitioningToRunning");
+    EXPECT_EQ(std::get<0>(records[1]), 30);
+    EXPECT_EQ(std::get<2>(records[1]),
+              "xyz.openbmc_project.State.Boot.Progress.ProgressStages."
+              "Unspecified");
+}
+
+TEST_F(TestHostHistory, replacesOldestWhenFull)
+{
+    HostHistory history(path);
+    for (uint64_t time = 1; time <= HostHistory::capacity + 2; time++)
+    {
+        history.add(entry(time, (time % 2) ? HostState::Running
+                                           : HostState::Off));
+    }
+
+    auto records = history.get(0);
+    ASSERT_EQ(records.size(), HostHistory::capacity);
+    EXPECT_EQ(std::get<0>(records.front()), 3);
+    EXPECT_EQ(std::get<0>(records.back()), HostHistory::capacity + 2);
+}
+
+TEST_F(TestHostHistory, persisted)
+{
+    {
+        HostHistory history(path);
+        history.add(entry(1, HostState::Off));
+        history.add({2, HostState::Running, ProgressStages::OSRunning,
+                     OSStatus::BootComplete, RestartCause::HostCrash});
+    }
+
+    HostHistory history(path);
+    auto records = history.get(0);
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(std::get<0>(records[1]), 2);
+    EXPECT_EQ(std::get<1>(records[1]),
+              "xyz.openbmc_project.State.Host.HostState.Running");
+    EXPECT_EQ(std::get<3>(records[1]),
+              "xyz.openbmc_project.State.OperatingSystem.Status.OSStatus."
+              "BootComplete");
+    EXPECT_EQ(std::get<4>(records[1]),
+              "xyz.openbmc_project.State.Host.RestartCause.HostCrash");
+
+    // The newest entry is known, so the same states are not added again
+    EXPECT_FALSE(history.add({3, HostState::Running, ProgressStages::OSRunning,
+                              OSStatus::BootComplete,
+                              RestartCause::HostCrash}));
+}
+
+TEST_F(TestHostHistory, corruptFileDropped)
+{
+    {
+        std::ofstream os(path.path);
+        os << "not a history";
+    }
+
+    HostHistory history(path);
+    EXPECT_EQ(history.size(), 0);
+    EXPECT_TRUE(history.add(entry(1, HostState::Off)));
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,139 @@
+#include "host_persist.hpp"
+
+#include <cereal/archives/json.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+using namespace std::chrono_literals;
+
+/** @brief Archives the persisted fields as the Host does */
+struct TestHost
+{
+    CrashLoop crashLoop{{600s, 30s, 300s, 32}};
+    HostPersist persist;
+
+    template <class Archive>
+    void save(Archive& archive, const std::uint32_t /* version */) const
+    {
+        persist.write(archive, crashLoop);
+    }
+
+    template <class Archive>
+    void load(Archive& archive, const std::uint32_t version)
+    {
+        persist.read(archive, version, crashLoop);
+    }
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
+
+CEREAL_CLASS_VERSION(phosphor::state::manager::TestHost,
+                     phosphor::state::manager::hostPersistVersion)
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+namespace
+{
+
+constexpr auto transitionOn = "xyz.openbmc_project.State.Host.Transition.On";
+constexpr auto osRunning =
+    "xyz.openbmc_project.State.Boot.Progress.ProgressStages.OSRunning";
+constexpr auto standby =
+    "xyz.openbmc_project.State.OperatingSystem.Status.OSStatus.Standby";
+
+/** @brief Load a host from its json file */
+void loadHost(const std::string& json, TestHost& host)
+{
+    std::istringstream is(json);
+    cereal::JSONInputArchive iarchive(is);
+    iarchive(host);
+}
+
+} // namespace
+
+TEST(HostPersist, loadVersion2)
+{
+    // As written before the crash times were persisted
+    auto json = std::string{R"({
+    "value0": {
+        "cereal_class_version": 2,
+        "value0": 2,
+        "value1": ")"} + transitionOn + R"(",
+        "value2": ")" + osRunning + R"(",
+        "value3": ")" + standby + R"("
+    }
+})";
+
+    TestHost host;
+    loadHost(json, host);
+    EXPECT_EQ(host.persist.retryAttempts, 2);
+    EXPECT_EQ(host.persist.requestedTransition, transitionOn);
+    EXPECT_EQ(host.persist.bootProgress, osRunning);
+    EXPECT_EQ(host.persist.osState, standby);
+    EXPECT_EQ(host.crashLoop.lastCrash(), 0);
+}
+
+TEST(HostPersist, loadVersion1)
+{
+    auto json = std::string{R"({
+    "value0": {
+        "cereal_class_version": 1,
+        "value0": ")"} + transitionOn + R"(",
+        "value1": ")" + osRunning + R"(",
+        "value2": ")" + standby + R"("
+    }
+})";
+
+    // All of the reboot attempts are left
+    TestHost host;
+    loadHost(json, host);
+    EXPECT_EQ(host.persist.retryAttempts, BOOT_COUNT_MAX_ALLOWED);
+    EXPECT_EQ(host.persist.requestedTransition, transitionOn);
+    EXPECT_EQ(host.persist.osState, standby);
+}
+
+TEST(HostPersist, roundTrip)
+{
+    TestHost host;
+    host.crashLoop.record(1000000);
+    host.persist = {1, transitionOn, osRunning, standby};
+
+    std::stringstream stream;
+    {
+        cereal::JSONOutputArchive oarchive(stream);
+        oarchive(host);
+    }
+    EXPECT_NE(stream.str().find("\"cereal_class_version\": 3"),
+              std::string::npos);
+
+    TestHost restored;
+    loadHost(stream.str(), restored);
+    EXPECT_EQ(restored.crashLoop.lastCrash(), 1000000);
+    EXPECT_EQ(restored.persist.retryAttempts, 1);
+    EXPECT_EQ(restored.persist.requestedTransition, transitionOn);
+    EXPECT_EQ(restored.persist.bootProgress, osRunning);
+    EXPECT_EQ(restored.persist.osState, standby);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
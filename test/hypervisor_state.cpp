@@ -2,12 +2,43 @@
 
 #include <hypervisor_state_manager.hpp>
 #include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
 #include <sdeventplus/event.hpp>
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 namespace server = sdbusplus::xyz::openbmc_project::State::server;
 
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::StrEq;
+
+namespace
+{
+
+/** @brief Read a string from a mocked message */
+auto readString(const char* value)
+{
+    return Invoke([value](sd_bus_message*, char, void* p) {
+        *static_cast<const char**>(p) = value;
+        return 0;
+    });
+}
+
+/** @brief Send a mocked async call, which is never answered */
+auto asyncCall(int rc)
+{
+    return Invoke([rc](sd_bus*, sd_bus_slot** slot, sd_bus_message*,
+                       sd_bus_message_handler_t, void*, uint64_t) {
+        *slot = nullptr;
+        return rc;
+    });
+}
+
+} // namespace
+
 TEST(updateCurrentHostState, BasicPaths)
 {
     auto bus = sdbusplus::bus::new_default();
@@ -17,22 +48,137 @@ TEST(updateCurrentHostState, BasicPaths)
 
     phosphor::state::manager::Hypervisor hypObj(bus, objPathInst.c_str());
 
-    std::string bootProgress = "Invalid.Boot.Progress";
-    hypObj.updateCurrentHostState(bootProgress);
+    // Any BootProgress not in the table is Off
+    hypObj.updateCurrentHostState(
+        phosphor::state::manager::ProgressStages::PCIInit);
     EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Off);
 
-    bootProgress = "xyz.openbmc_project.State.Boot.Progress."
-                   "ProgressStages.SystemInitComplete";
-    hypObj.updateCurrentHostState(bootProgress);
+    hypObj.updateCurrentHostState(
+        phosphor::state::manager::ProgressStages::SystemInitComplete);
     EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Standby);
 
-    bootProgress = "xyz.openbmc_project.State.Boot.Progress."
-                   "ProgressStages.OSRunning";
-    hypObj.updateCurrentHostState(bootProgress);
+    hypObj.updateCurrentHostState(
+        phosphor::state::manager::ProgressStages::OSRunning);
     EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Running);
 
-    bootProgress = "xyz.openbmc_project.State.Boot.Progress."
-                   "ProgressStages.Unspecified";
-    hypObj.updateCurrentHostState(bootProgress);
+    hypObj.updateCurrentHostState(
+        phosphor::state::manager::ProgressStages::Unspecified);
     EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Off);
 }
+
+TEST(syncBootProgress, RunningAfterRestart)
+{
+    sdbusplus::SdBusMock sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
+
+    // The BootProgress is read without waiting for the reply
+    EXPECT_CALL(sdbusMock, sd_bus_call(_, _, _, _, _)).Times(0);
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+        .WillOnce(asyncCall(0));
+    phosphor::state::manager::Hypervisor hypObj(bus, objPathInst.c_str(), 0);
+    EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Off);
+
+    // The GetAll reply holds only BootProgress, the host is already running
+    EXPECT_CALL(sdbusMock, sd_bus_message_is_method_error(_, _))
+        .WillOnce(Return(0));
+    EXPECT_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+        .WillOnce(Return(0))
+        .WillRepeatedly(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_verify_type(_, 'v', StrEq("s")))
+        .WillOnce(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+        .WillOnce(readString("BootProgress"))
+        .WillOnce(readString("xyz.openbmc_project.State.Boot.Progress."
+                             "ProgressStages.OSRunning"));
+
+    // A newly started hypervisor state manager picks up the host state
+    auto reply = sdbusplus::message_t(nullptr, &sdbusMock);
+    hypObj.bootProgressDone(reply);
+    EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Running);
+}
+
+TEST(syncBootProgress, HostNotUp)
+{
+    sdbusplus::SdBusMock sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+        .WillOnce(asyncCall(0));
+    phosphor::state::manager::Hypervisor hypObj(bus, objPathInst.c_str(), 0);
+
+    // The host state manager isn't on dbus
+    sd_bus_error replyError{"org.freedesktop.DBus.Error.ServiceUnknown",
+                            nullptr, 0};
+    EXPECT_CALL(sdbusMock, sd_bus_message_is_method_error(_, _))
+        .WillOnce(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_get_error(_))
+        .WillRepeatedly(Return(&replyError));
+
+    auto reply = sdbusplus::message_t(nullptr, &sdbusMock);
+    hypObj.bootProgressDone(reply);
+    EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Off);
+}
+
+TEST(syncBootProgress, OemProgress)
+{
+    sdbusplus::SdBusMock sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+        .WillOnce(asyncCall(0));
+    phosphor::state::manager::Hypervisor hypObj(bus, objPathInst.c_str(), 0);
+
+    // The GetAll reply also holds the free form BootProgressOem
+    EXPECT_CALL(sdbusMock, sd_bus_message_is_method_error(_, _))
+        .WillOnce(Return(0));
+    EXPECT_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+        .WillOnce(Return(0))
+        .WillOnce(Return(0))
+        .WillRepeatedly(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_verify_type(_, 'v', StrEq("s")))
+        .Times(2)
+        .WillRepeatedly(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+        .WillOnce(readString("BootProgressOem"))
+        .WillOnce(readString("Vendor step 7"))
+        .WillOnce(readString("BootProgress"))
+        .WillOnce(readString("xyz.openbmc_project.State.Boot.Progress."
+                             "ProgressStages.OSRunning"));
+
+    auto reply = sdbusplus::message_t(nullptr, &sdbusMock);
+    hypObj.bootProgressDone(reply);
+    EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Running);
+}
+
+TEST(bootProgressChangeEvent, OemProgress)
+{
+    sdbusplus::SdBusMock sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+    auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
+
+    // The host isn't up when this starts
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+        .WillOnce(asyncCall(-EHOSTUNREACH));
+    phosphor::state::manager::Hypervisor hypObj(bus, objPathInst.c_str(), 0);
+
+    // A change of BootProgress along with BootProgressOem is followed
+    EXPECT_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+        .WillOnce(Return(0))
+        .WillOnce(Return(0))
+        .WillRepeatedly(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_verify_type(_, 'v', StrEq("s")))
+        .Times(2)
+        .WillRepeatedly(Return(1));
+    EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+        .WillOnce(readString("xyz.openbmc_project.State.Boot.Progress"))
+        .WillOnce(readString("BootProgress"))
+        .WillOnce(readString("xyz.openbmc_project.State.Boot.Progress."
+                             "ProgressStages.SystemInitComplete"))
+        .WillOnce(readString("BootProgressOem"))
+        .WillOnce(readString("Vendor step 7"));
+
+    auto msg = sdbusplus::message_t(nullptr, &sdbusMock);
+    hypObj.bootProgressChangeEvent(msg);
+    EXPECT_EQ(hypObj.currentHostState(), server::Host::HostState::Standby);
+}
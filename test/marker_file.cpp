@@ -0,0 +1,95 @@
+#include "marker_file.hpp"
+#include "temp_path.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+namespace fs = std::filesystem;
+
+class TestMarkerFile : public testing::Test
+{
+  public:
+    /** @brief Get the format of a marker file path within the test dir */
+    std::string format(const std::string& name) const
+    {
+        return (dir.path / name).string();
+    }
+
+    const TempPath dir{"psm-marker-file"};
+};
+
+TEST_F(TestMarkerFile, pathOfInstance)
+{
+    MarkerFile file(format("host@%d-on").c_str(), 2);
+    EXPECT_EQ(file.path(), (dir.path / "host@2-on").string());
+}
+
+TEST_F(TestMarkerFile, create)
+{
+    fs::create_directories(dir.path);
+    MarkerFile file(format("host@%d-on").c_str(), 0);
+    EXPECT_FALSE(file.exists());
+
+    EXPECT_TRUE(file.create());
+    EXPECT_TRUE(file.exists());
+    EXPECT_TRUE(fs::is_regular_file(file.path()));
+
+    // Creating it again leaves it in place
+    EXPECT_TRUE(file.create());
+    EXPECT_TRUE(file.exists());
+}
+
+TEST_F(TestMarkerFile, createMissingParent)
+{
+    // The directory is gone, as after a BMC reboot
+    MarkerFile file(format("openbmc/chassis@%d-on").c_str(), 0);
+    ASSERT_FALSE(fs::exists(dir.path));
+
+    EXPECT_TRUE(file.create());
+    EXPECT_TRUE(file.exists());
+}
+
+TEST_F(TestMarkerFile, createFails)
+{
+    // The parent is a file, so neither it nor the marker can be created
+    fs::create_directories(dir.path);
+    std::ofstream{dir.path / "openbmc"};
+    MarkerFile file(format("openbmc/chassis@%d-on").c_str(), 0);
+
+    EXPECT_FALSE(file.create());
+    EXPECT_FALSE(file.exists());
+}
+
+TEST_F(TestMarkerFile, remove)
+{
+    MarkerFile file(format("host@%d-on").c_str(), 0);
+    ASSERT_TRUE(file.create());
+
+    EXPECT_TRUE(file.remove());
+    EXPECT_FALSE(file.exists());
+}
+
+TEST_F(TestMarkerFile, removeMissing)
+{
+    // A file that does not exist is not an error
+    MarkerFile file(format("host@%d-on").c_str(), 0);
+    EXPECT_FALSE(file.remove());
+    EXPECT_FALSE(file.exists());
+
+    MarkerFile inMissingDir(format("openbmc/host@%d-on").c_str(), 0);
+    EXPECT_FALSE(inMissingDir.remove());
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,359 @@
+/**
+ * Drives host power cycles through the state managers and reports the
+ * throughput, the latency of each stage, and the memory and fd growth of
+ * the managers, as json.
+ */
+#include "config.h"
+
+#include <CLI/CLI.hpp>
+#include <nlohmann/json.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/exception.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace
+{
+
+using namespace std::chrono;
+
+constexpr auto HOST_INTERFACE = "xyz.openbmc_project.State.Host";
+constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+
+constexpr auto HOST_OFF = "xyz.openbmc_project.State.Host.HostState.Off";
+constexpr auto HOST_RUNNING =
+    "xyz.openbmc_project.State.Host.HostState.Running";
+
+/** @brief A transition of each cycle, and the stages it goes through */
+struct CycleStep
+{
+    const char* transition;
+    std::vector<std::pair<const char*, const char*>> stages;
+};
+
+const std::vector<CycleStep> cycleSteps = {
+    {"xyz.openbmc_project.State.Host.Transition.On", {{"on", HOST_RUNNING}}},
+    {"xyz.openbmc_project.State.Host.Transition.Reboot",
+     {{"reboot-off", HOST_OFF}, {"reboot-on", HOST_RUNNING}}},
+    {"xyz.openbmc_project.State.Host.Transition.Off", {{"off", HOST_OFF}}},
+};
+
+/** @brief Memory and fd usage of a process */
+struct ProcessUsage
+{
+    long rssKb = 0;
+    long fds = 0;
+};
+
+std::optional<ProcessUsage> getProcessUsage(pid_t pid)
+{
+    auto proc = std::filesystem::path("/proc") / std::to_string(pid);
+
+    std::ifstream status(proc / "status");
+    if (!status)
+    {
+        return std::nullopt;
+    }
+
+    ProcessUsage usage;
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.starts_with("VmRSS:"))
+        {
+            usage.rssKb = std::stol(line.substr(6));
+        }
+    }
+
+    std::error_code ec;
+    for (auto it = std::filesystem::directory_iterator(proc / "fd", ec);
+         !ec && (it != std::filesystem::directory_iterator()); it.increment(ec))
+    {
+        usage.fds++;
+    }
+    return usage;
+}
+
+std::string getProcessName(pid_t pid)
+{
+    std::ifstream comm(std::filesystem::path("/proc") / std::to_string(pid) /
+                       "comm");
+    std::string name;
+    std::getline(comm, name);
+    return name;
+}
+
+/** @brief Usage of a process over the run */
+struct ProcessTrack
+{
+    pid_t pid;
+    std::string name;
+    ProcessUsage start;
+    ProcessUsage end;
+    ProcessUsage max;
+};
+
+void sample(std::vector<ProcessTrack>& processes)
+{
+    for (auto& process : processes)
+    {
+        auto usage = getProcessUsage(process.pid);
+        if (!usage)
+        {
+            continue;
+        }
+        process.end = *usage;
+        process.max.rssKb = std::max(process.max.rssKb, usage->rssKb);
+        process.max.fds = std::max(process.max.fds, usage->fds);
+    }
+}
+
+double percentile(std::vector<double> values, double pct)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    auto index = static_cast<size_t>(pct / 100 * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+class HostDriver
+{
+  public:
+    HostDriver(sdbusplus::bus_t& bus, size_t id) :
+        bus(bus), service(std::string{HOST_BUSNAME} + std::to_string(id)),
+        path(std::string{HOST_OBJPATH} + std::to_string(id)),
+        stateChanged(bus,
+                     sdbusplus::bus::match::rules::propertiesChanged(
+                         path, HOST_INTERFACE),
+                     [this](sdbusplus::message_t& msg) {
+        std::string interface;
+        std::map<std::string, std::variant<std::string, uint32_t, bool>>
+            properties;
+        msg.read(interface, properties);
+
+        auto state = properties.find("CurrentHostState");
+        if ((state != properties.end()) &&
+            std::holds_alternative<std::string>(state->second))
+        {
+            states.push_back(std::get<std::string>(state->second));
+        }
+    })
+    {}
+
+    std::string currentState()
+    {
+        auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                          PROPERTY_INTERFACE, "Get");
+        method.append(HOST_INTERFACE, "CurrentHostState");
+
+        std::variant<std::string> state;
+        auto reply = bus.call(method);
+        reply.read(state);
+        return std::get<std::string>(state);
+    }
+
+    void request(const char* transition)
+    {
+        states.clear();
+
+        auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                          PROPERTY_INTERFACE, "Set");
+        method.append(HOST_INTERFACE, "RequestedHostTransition",
+                      std::variant<std::string>(transition));
+        bus.call_noreply(method);
+    }
+
+    /** @brief Wait for the host to reach a state
+     *
+     * @return The time the state was signalled, or nullopt on timeout
+     */
+    std::optional<steady_clock::time_point>
+        waitFor(const std::string& state, steady_clock::time_point deadline)
+    {
+        while (true)
+        {
+            while (!states.empty())
+            {
+                auto reached = (states.front() == state);
+                states.pop_front();
+                if (reached)
+                {
+                    return steady_clock::now();
+                }
+            }
+
+            auto now = steady_clock::now();
+            if (now >= deadline)
+            {
+                return std::nullopt;
+            }
+            bus.wait(duration_cast<microseconds>(deadline - now));
+            while (bus.process_discard())
+            {}
+        }
+    }
+
+  private:
+    sdbusplus::bus_t& bus;
+    const std::string service;
+    const std::string path;
+    std::deque<std::string> states;
+    sdbusplus::bus::match_t stateChanged;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"Power cycle a host through the state managers"};
+
+    unsigned cycles = 100;
+    size_t id = 0;
+    unsigned timeout = 30;
+    unsigned sampleEvery = 10;
+    std::vector<pid_t> pids;
+
+    app.add_option("-c,--cycles", cycles, "On, reboot, off cycles to run");
+    app.add_option("-i,--host", id, "Host instance, default 0");
+    app.add_option("-t,--timeout", timeout, "Seconds to wait for each stage");
+    app.add_option("-p,--pid", pids, "Processes to track the usage of");
+    app.add_option("-s,--sample-every", sampleEvery,
+                   "Cycles between usage samples");
+
+    CLI11_PARSE(app, argc, argv);
+
+    auto bus = sdbusplus::bus::new_default();
+    HostDriver host(bus, id);
+
+    std::vector<ProcessTrack> processes;
+    for (auto pid : pids)
+    {
+        auto usage = getProcessUsage(pid).value_or(ProcessUsage{});
+        processes.push_back({pid, getProcessName(pid), usage, usage, usage});
+    }
+
+    std::map<std::string, std::vector<double>> stageLatencies;
+    unsigned transitions = 0;
+    unsigned failures = 0;
+
+    try
+    {
+        if (host.currentState() != HOST_OFF)
+        {
+            host.request("xyz.openbmc_project.State.Host.Transition.Off");
+            host.waitFor(HOST_OFF, steady_clock::now() + seconds(timeout));
+        }
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        std::cerr << "Host state manager is not responding: " << e.what()
+                  << std::endl;
+        return 1;
+    }
+
+    auto start = steady_clock::now();
+    for (unsigned cycle = 0; cycle < cycles; cycle++)
+    {
+        for (const auto& step : cycleSteps)
+        {
+            auto requested = steady_clock::now();
+            try
+            {
+                host.request(step.transition);
+            }
+            catch (const sdbusplus::exception_t& e)
+            {
+                std::cerr << "Cycle " << cycle << ": " << step.transition
+                          << " failed: " << e.what() << std::endl;
+                failures++;
+                continue;
+            }
+
+            auto stageStart = requested;
+            bool completed = true;
+            for (const auto& [stage, state] : step.stages)
+            {
+                auto reached = host.waitFor(state,
+                                            requested + seconds(timeout));
+                if (!reached)
+                {
+                    std::cerr << "Cycle " << cycle << ": " << stage
+                              << " timed out" << std::endl;
+                    completed = false;
+                    break;
+                }
+                stageLatencies[stage].push_back(
+                    duration<double, std::milli>(*reached - stageStart)
+                        .count());
+                stageStart = *reached;
+            }
+
+            if (completed)
+            {
+                transitions++;
+            }
+            else
+            {
+                failures++;
+            }
+        }
+
+        if ((sampleEvery != 0) && ((cycle + 1) % sampleEvery == 0))
+        {
+            sample(processes);
+        }
+    }
+    auto elapsed = duration<double>(steady_clock::now() - start).count();
+    sample(processes);
+
+    nlohmann::json results;
+    results["cycles"] = cycles;
+    results["transitions"] = transitions;
+    results["failures"] = failures;
+    results["elapsed_s"] = elapsed;
+    results["transitions_per_second"] =
+        (elapsed > 0) ? (transitions / elapsed) : 0;
+
+    for (const auto& [stage, latencies] : stageLatencies)
+    {
+        results["stages"][stage] = {
+            {"count", latencies.size()},
+            {"p50_ms", percentile(latencies, 50)},
+            {"p90_ms", percentile(latencies, 90)},
+            {"p99_ms", percentile(latencies, 99)},
+            {"max_ms", percentile(latencies, 100)}};
+    }
+
+    results["processes"] = nlohmann::json::array();
+    for (const auto& process : processes)
+    {
+        results["processes"].push_back(
+            {{"pid", process.pid},
+             {"name", process.name},
+             {"rss_kb_start", process.start.rssKb},
+             {"rss_kb_end", process.end.rssKb},
+             {"rss_kb_max", process.max.rssKb},
+             {"rss_kb_growth", process.end.rssKb - process.start.rssKb},
+             {"fds_start", process.start.fds},
+             {"fds_end", process.end.fds},
+             {"fds_growth", process.end.fds - process.start.fds}});
+    }
+
+    std::cout << results.dump(4) << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+#include "settings.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::StrEq;
+
+namespace
+{
+
+constexpr auto settingsService = "xyz.openbmc_project.Settings";
+constexpr auto hostRoot = "/xyz/openbmc_project/control/host0";
+constexpr auto userPath = "/xyz/openbmc_project/control/host0/auto_reboot";
+constexpr auto oneTimePath =
+    "/xyz/openbmc_project/control/host0/auto_reboot/one_time";
+constexpr auto restorePath =
+    "/xyz/openbmc_project/control/host0/power_restore_policy";
+constexpr auto restoreOneTimePath =
+    "/xyz/openbmc_project/control/host0/power_restore_policy/one_time";
+
+/** @brief Read a string from a mocked message */
+auto readString(const char* value)
+{
+    return Invoke([value](sd_bus_message*, char, void* p) {
+        *static_cast<const char**>(p) = value;
+        return 0;
+    });
+}
+
+} // namespace
+
+class TestSettings : public testing::Test
+{
+  public:
+    /** @brief A method call made */
+    struct Call
+    {
+        std::string destination;
+        std::string path;
+        std::string member;
+    };
+
+    TestSettings() : bus(sdbusplus::get_mocked_new(&sdbusMock))
+    {
+        // Record the method calls made, each with its own message
+        ON_CALL(sdbusMock, sd_bus_message_new_method_call(_, _, _, _, _, _))
+            .WillByDefault(Invoke([this](sd_bus*, sd_bus_message** m,
+                                         const char* destination,
+                                         const char* path, const char*,
+                                         const char* member) {
+            calls.push_back({destination, path, member});
+            *m = reinterpret_cast<sd_bus_message*>(calls.size());
+            return 0;
+        }));
+        ON_CALL(sdbusMock, sd_bus_add_match(_, _, _, _, _))
+            .WillByDefault(Invoke([](sd_bus*, sd_bus_slot** slot, const char*,
+                                     sd_bus_message_handler_t, void*) {
+            *slot = nullptr;
+            return 0;
+        }));
+        ON_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+            .WillByDefault(Invoke([](sd_bus*, sd_bus_slot** slot,
+                                     sd_bus_message*, sd_bus_message_handler_t,
+                                     void*, uint64_t) {
+            *slot = nullptr;
+            return 0;
+        }));
+
+        // A Get of a setting answers with the value on the bus, or fails
+        ON_CALL(sdbusMock, sd_bus_call(_, _, _, _, _))
+            .WillByDefault(Invoke([this](sd_bus*, sd_bus_message*, uint64_t,
+                                         sd_bus_error* error,
+                                         sd_bus_message**) {
+            return getFails ? sd_bus_error_set_errno(error, EIO) : 0;
+        }));
+        ON_CALL(sdbusMock, sd_bus_message_verify_type(_, 'v', StrEq("b")))
+            .WillByDefault(Return(1));
+        ON_CALL(sdbusMock, sd_bus_message_read_basic(_, 'b', _))
+            .WillByDefault(Invoke([this](sd_bus_message*, char, void* p) {
+            *static_cast<int*>(p) = busValue;
+            return 0;
+        }));
+        ON_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+            .WillByDefault(Return(1));
+
+        // The errors of failed calls are built by sd-bus
+        ON_CALL(sdbusMock, sd_bus_error_get_errno(_))
+            .WillByDefault(Invoke(sd_bus_error_get_errno));
+        ON_CALL(sdbusMock, sd_bus_error_is_set(_))
+            .WillByDefault(Invoke(sd_bus_error_is_set));
+        ON_CALL(sdbusMock, sd_bus_error_free(_))
+            .WillByDefault(Invoke(sd_bus_error_free));
+
+        objects = std::make_unique<settings::Objects>(
+            bus, hostRoot, [this]() { resolved++; });
+        setting = std::make_unique<settings::BoolSetting>(
+            *objects, settings::autoRebootIntf, "AutoReboot");
+        calls.clear();
+    }
+
+    /** @brief Have the settings objects found, as by the mapper */
+    void found()
+    {
+        objects->store(
+            {{oneTimePath, {{settingsService, {settings::autoRebootIntf}}}}});
+    }
+
+    /** @brief Set the value on the bus and signal it, as the settings
+     *         service does
+     *
+     * @param[in] property - The property changed
+     * @param[in] value    - The new value
+     */
+    void changed(const char* property, bool value)
+    {
+        busValue = value;
+
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+            .WillOnce(readString(settings::autoRebootIntf))
+            .WillOnce(readString(property))
+            .RetiresOnSaturation();
+        EXPECT_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+            .WillOnce(Return(0))
+            .RetiresOnSaturation();
+
+        auto msg = sdbusplus::message_t(nullptr, &sdbusMock);
+        setting->propertiesChanged(msg);
+    }
+
+    /** @brief Get the calls made of a method */
+    std::vector<Call> made(const std::string& member) const
+    {
+        std::vector<Call> found;
+        std::copy_if(calls.begin(), calls.end(), std::back_inserter(found),
+                     [&member](const auto& call) {
+            return call.member == member;
+        });
+        return found;
+    }
+
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    sdbusplus::bus_t bus;
+    std::vector<Call> calls;
+    bool busValue = true;
+    bool getFails = false;
+    size_t resolved = 0;
+    std::unique_ptr<settings::Objects> objects;
+    std::unique_ptr<settings::BoolSetting> setting;
+};
+
+TEST_F(TestSettings, readWhenWatched)
+{
+    found();
+    setting->watch(oneTimePath);
+
+    auto gets = made("Get");
+    ASSERT_EQ(gets.size(), 1);
+    EXPECT_EQ(gets[0].destination, settingsService);
+    EXPECT_EQ(gets[0].path, oneTimePath);
+
+    // Known, so not read again
+    EXPECT_TRUE(setting->get());
+    EXPECT_EQ(made("Get").size(), 1);
+}
+
+TEST_F(TestSettings, followsPropertiesChanged)
+{
+    found();
+    setting->watch(oneTimePath);
+
+    changed("AutoReboot", false);
+    EXPECT_FALSE(setting->get());
+
+    changed("AutoReboot", true);
+    EXPECT_TRUE(setting->get());
+
+    EXPECT_EQ(made("Get").size(), 1);
+}
+
+TEST_F(TestSettings, otherPropertiesIgnored)
+{
+    found();
+    setting->watch(oneTimePath);
+
+    changed("Other", false);
+    EXPECT_TRUE(setting->get());
+    EXPECT_EQ(made("Get").size(), 1);
+}
+
+TEST_F(TestSettings, readFallback)
+{
+    found();
+
+    // The initial read fails, which is only traced
+    getFails = true;
+    busValue = false;
+    setting->watch(oneTimePath);
+    EXPECT_EQ(made("Get").size(), 1);
+
+    // So it is read when needed, and kept once read
+    EXPECT_THROW(setting->get(), sdbusplus::exception_t);
+    getFails = false;
+    EXPECT_FALSE(setting->get());
+    EXPECT_FALSE(setting->get());
+    EXPECT_EQ(made("Get").size(), 3);
+}
+
+TEST_F(TestSettings, watchAgainReads)
+{
+    found();
+    setting->watch(oneTimePath);
+
+    // The settings service was restarted with another value
+    busValue = false;
+    setting->watch(oneTimePath);
+    EXPECT_FALSE(setting->get());
+    EXPECT_EQ(made("Get").size(), 2);
+}
+
+TEST_F(TestSettings, asyncConstructor)
+{
+    // Nothing is waited for, the mapper is asked in the background
+    EXPECT_CALL(sdbusMock, sd_bus_call(_, _, _, _, _)).Times(0);
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _)).Times(1);
+
+    settings::Objects async(bus, hostRoot, []() {});
+    EXPECT_FALSE(async.resolved());
+
+    auto subTrees = made("GetSubTree");
+    ASSERT_EQ(subTrees.size(), 1);
+    EXPECT_EQ(subTrees[0].destination, "xyz.openbmc_project.ObjectMapper");
+}
+
+TEST_F(TestSettings, store)
+{
+    objects->store(
+        {{userPath, {{settingsService, {settings::autoRebootIntf}}}},
+         {oneTimePath, {{settingsService, {settings::autoRebootIntf}}}},
+         {restorePath, {{settingsService, {settings::powerRestoreIntf}}}},
+         {restoreOneTimePath,
+          {{settingsService, {settings::powerRestoreIntf}}}}});
+
+    EXPECT_TRUE(objects->resolved());
+    EXPECT_EQ(resolved, 1);
+    EXPECT_EQ(objects->autoReboot, userPath);
+    EXPECT_EQ(objects->autoRebootOneTime, oneTimePath);
+    EXPECT_EQ(objects->powerRestorePolicy, restorePath);
+    EXPECT_EQ(objects->powerRestorePolicyOneTime, restoreOneTimePath);
+
+    // Objects no longer found are forgotten
+    found();
+    EXPECT_EQ(resolved, 2);
+    EXPECT_TRUE(objects->autoReboot.empty());
+    EXPECT_EQ(objects->autoRebootOneTime, oneTimePath);
+    EXPECT_TRUE(objects->powerRestorePolicy.empty());
+}
+
+TEST_F(TestSettings, serviceCache)
+{
+    found();
+
+    // Found along with the object
+    EXPECT_EQ(objects->service(oneTimePath, settings::autoRebootIntf),
+              settingsService);
+    EXPECT_TRUE(made("GetObject").empty());
+
+    // Not found with the objects, so the mapper is asked, which has no
+    // answer on the mocked bus
+    EXPECT_ANY_THROW(
+        objects->service(oneTimePath, settings::powerRestoreIntf));
+    EXPECT_ANY_THROW(objects->service(userPath, settings::autoRebootIntf));
+    EXPECT_EQ(made("GetObject").size(), 2);
+}
+
+TEST_F(TestSettings, notFoundRetried)
+{
+    // The mapper does not know the objects of the settings service yet
+    auto reply = sdbusplus::message_t(nullptr, &sdbusMock);
+    objects->subTreeDone(reply);
+
+    EXPECT_FALSE(objects->resolved());
+    ASSERT_TRUE(objects->retryTimer->isEnabled());
+    auto first = objects->retryTimer->getRemaining();
+    EXPECT_GT(first, std::chrono::seconds(0));
+
+    // Waiting longer each time they are not found
+    objects->subTreeDone(reply);
+    ASSERT_TRUE(objects->retryTimer->isEnabled());
+    EXPECT_GT(objects->retryTimer->getRemaining(), first);
+
+    // Until they are
+    found();
+    EXPECT_FALSE(objects->retryTimer->isEnabled());
+}
@@ -1,3 +1,4 @@
+#include <systemd_config_cache.hpp>
 #include <systemd_target_parser.hpp>
 
 #include <cstdio>
@@ -63,10 +64,12 @@ TEST(TargetJsonParser, BasicGoodPath)
     targetEntry tgt = targetData["obmc-chassis-poweron@0.target"];
     EXPECT_EQ(tgt.errorToLog,
               "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure");
-    EXPECT_EQ(tgt.errorsToMonitor.size(), 2);
+    EXPECT_EQ(tgt.errorsToMonitor, errorMask::timeout | errorMask::failed);
     // Check a target with "default" for errorsToMonitor, should have 3 defaults
     tgt = targetData["obmc-host-start@0.target"];
-    EXPECT_EQ(tgt.errorsToMonitor.size(), 3);
+    EXPECT_EQ(tgt.errorsToMonitor, errorMask::defaults);
+    tgt = targetData["obmc-host-stop@0.target"];
+    EXPECT_EQ(tgt.errorsToMonitor, errorMask::dependency);
 
     std::remove("/tmp/good_file1.json");
     std::remove("/tmp/good_file2.json");
@@ -136,3 +139,186 @@ TEST(TargetJsonParser, NotJustDefault)
                  std::invalid_argument);
     std::remove("/tmp/not_just_default_file.json");
 }
+
+TEST(TargetJsonParser, EmptyErrorsToMonitor)
+{
+    auto emptyErrors = R"(
+        {
+            "targets" : {
+                "obmc-chassis-poweron@0.target" : {
+                    "errorsToMonitor": [],
+                    "errorToLog": "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure"}
+                }
+        }
+    )"_json;
+
+    std::FILE* tmpf = fopen("/tmp/empty_errors_file.json", "w");
+    std::fputs(emptyErrors.dump().c_str(), tmpf);
+    std::fclose(tmpf);
+
+    std::vector<std::string> filePaths;
+    filePaths.push_back("/tmp/empty_errors_file.json");
+
+    // Verify exception thrown on no errorsToMonitor
+    EXPECT_THROW(TargetErrorData targetData = parseFiles(filePaths),
+                 std::invalid_argument);
+    std::remove("/tmp/empty_errors_file.json");
+}
+
+TEST(TargetJsonParser, ReloadMalformedFile)
+{
+    auto goodData = R"(
+        {
+            "targets" : {
+                "obmc-chassis-poweron@0.target" : {
+                    "errorsToMonitor": ["default"],
+                    "errorToLog": "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure"}
+                }
+        }
+    )"_json;
+
+    // The file was edited to drop errorsToMonitor before the reload
+    auto missingErrors = R"(
+        {
+            "targets" : {
+                "obmc-chassis-poweron@0.target" : {
+                    "errorToLog": "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure"}
+                }
+        }
+    )"_json;
+
+    std::vector<std::string> filePaths;
+    filePaths.push_back("/tmp/reload_file.json");
+
+    std::FILE* tmpf = fopen("/tmp/reload_file.json", "w");
+    std::fputs(goodData.dump().c_str(), tmpf);
+    std::fclose(tmpf);
+    TargetErrorData targetData = parseFiles(filePaths);
+
+    tmpf = fopen("/tmp/reload_file.json", "w");
+    std::fputs(missingErrors.dump().c_str(), tmpf);
+    std::fclose(tmpf);
+
+    // Verify the reload throws, so the current data is kept
+    EXPECT_THROW(targetData = parseFiles(filePaths), std::invalid_argument);
+    ASSERT_EQ(targetData.size(), 1);
+    EXPECT_EQ(targetData["obmc-chassis-poweron@0.target"].errorsToMonitor,
+              errorMask::defaults);
+    std::remove("/tmp/reload_file.json");
+}
+
+TEST(TargetConfigCache, RoundTrip)
+{
+    auto targetJson = R"(
+        {
+            "targets" : {
+                "obmc-chassis-poweron@0.target" : {
+                    "errorsToMonitor": ["timeout", "failed"],
+                    "errorToLog": "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure"}
+                }
+        }
+    )"_json;
+
+    std::FILE* tmpf = fopen("/tmp/cache_target_file.json", "w");
+    std::fputs(targetJson.dump().c_str(), tmpf);
+    std::fclose(tmpf);
+
+    std::vector<std::string> filePaths;
+    filePaths.push_back("/tmp/cache_target_file.json");
+    std::vector<std::string> serviceFilePaths;
+    const std::string cachePath = "/tmp/cache_target_file.cache";
+
+    TargetErrorData targetData = parseFiles(filePaths);
+    ServiceMonitorData serviceData = {"xyz.openbmc_project.Test.service"};
+    EXPECT_TRUE(writeConfigCache(cachePath, filePaths, serviceFilePaths,
+                                 targetData, serviceData));
+
+    TargetErrorData cachedTargets;
+    ServiceMonitorData cachedServices;
+    EXPECT_TRUE(loadConfigCache(cachePath, filePaths, serviceFilePaths,
+                                cachedTargets, cachedServices));
+    EXPECT_EQ(cachedTargets.size(), 1);
+    targetEntry tgt = cachedTargets["obmc-chassis-poweron@0.target"];
+    EXPECT_EQ(tgt.errorToLog,
+              "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure");
+    EXPECT_EQ(tgt.errorsToMonitor, errorMask::timeout | errorMask::failed);
+    EXPECT_EQ(cachedServices, serviceData);
+
+    // A different set of input files must not use the cache
+    filePaths.push_back("/tmp/cache_target_file.json");
+    EXPECT_FALSE(loadConfigCache(cachePath, filePaths, serviceFilePaths,
+                                 cachedTargets, cachedServices));
+    filePaths.pop_back();
+
+    // Nor can a changed input file
+    tmpf = fopen("/tmp/cache_target_file.json", "a");
+    std::fputs("\n", tmpf);
+    std::fclose(tmpf);
+    EXPECT_FALSE(loadConfigCache(cachePath, filePaths, serviceFilePaths,
+                                 cachedTargets, cachedServices));
+
+    std::remove("/tmp/cache_target_file.json");
+    std::remove("/tmp/cache_target_file.cache");
+}
+
+TEST(TargetConfigCache, SameSizeAndTime)
+{
+    auto targetJson = R"(
+        {
+            "targets" : {
+                "obmc-chassis-poweron@0.target" : {
+                    "errorsToMonitor": ["timeout"],
+                    "errorToLog": "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure"}
+                }
+        }
+    )"_json;
+
+    const std::string filePath = "/tmp/same_size_target_file.json";
+    const std::string cachePath = "/tmp/same_size_target_file.cache";
+    std::FILE* tmpf = fopen(filePath.c_str(), "w");
+    std::fputs(targetJson.dump().c_str(), tmpf);
+    std::fclose(tmpf);
+
+    std::vector<std::string> filePaths{filePath};
+    std::vector<std::string> serviceFilePaths;
+    TargetErrorData targetData = parseFiles(filePaths);
+    ServiceMonitorData serviceData;
+    EXPECT_TRUE(writeConfigCache(cachePath, filePaths, serviceFilePaths,
+                                 targetData, serviceData));
+
+    // Update the file like a reproducible build would, with the same size
+    // and modification time
+    auto mtime = fs::last_write_time(filePath);
+    auto updated = targetJson.dump();
+    updated.replace(updated.find("\"timeout\"]"), 10, "\"failed\"] ");
+    tmpf = fopen(filePath.c_str(), "w");
+    std::fputs(updated.c_str(), tmpf);
+    std::fclose(tmpf);
+    fs::last_write_time(filePath, mtime);
+
+    TargetErrorData cachedTargets;
+    ServiceMonitorData cachedServices;
+    EXPECT_FALSE(loadConfigCache(cachePath, filePaths, serviceFilePaths,
+                                 cachedTargets, cachedServices));
+
+    std::remove(filePath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+TEST(TargetConfigCache, InvalidCache)
+{
+    std::FILE* tmpf = fopen("/tmp/invalid_cache_file.cache", "w");
+    std::fputs("PTMC", tmpf);
+    std::fclose(tmpf);
+
+    std::vector<std::string> filePaths;
+    TargetErrorData targetData;
+    ServiceMonitorData serviceData;
+
+    // Verify a truncated cache is not loaded
+    EXPECT_FALSE(loadConfigCache("/tmp/invalid_cache_file.cache", filePaths,
+                                 filePaths, targetData, serviceData));
+    EXPECT_FALSE(loadConfigCache("/tmp/missing_cache_file.cache", filePaths,
+                                 filePaths, targetData, serviceData));
+    std::remove("/tmp/invalid_cache_file.cache");
+}
@@ -1,11 +1,21 @@
 #include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
 #include <sdeventplus/event.hpp>
 #include <systemd_target_signal.hpp>
 
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <string>
+#include <vector>
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
 // Enable debug by default for debug when needed
 bool gVerbose = true;
 
@@ -15,10 +25,10 @@ TEST(TargetSignalData, BasicPaths)
     TargetErrorData targetData = {
         {"multi-user.target",
          {"xyz.openbmc_project.State.BMC.Error.MultiUserTargetFailure",
-          {"default"}}},
+          errorMask::defaults}},
         {"obmc-chassis-poweron@0.target",
          {"xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure",
-          {"timeout", "failed"}}}};
+          errorMask::timeout | errorMask::failed}}};
 
     ServiceMonitorData serviceData = {
         "xyz.openbmc_project.biosconfig_manager.service",
@@ -46,3 +56,397 @@ TEST(TargetSignalData, BasicPaths)
     EXPECT_EQ(errorToLog,
               "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure");
 }
+
+TEST(TargetSignalData, LargeTables)
+{
+    // Size the data like a system with an extended critical service list,
+    // BM_ProcessErrorLookup times the same lookups
+    constexpr auto numTargets = 64;
+    constexpr auto numServices = 128;
+
+    TargetErrorData targetData;
+    for (auto i = 0; i < numTargets; i++)
+    {
+        targetData.emplace("obmc-test-" + std::to_string(i) + "@0.target",
+                           targetEntry{"xyz.openbmc_project.Test.Error",
+                                       errorMask::timeout});
+    }
+
+    ServiceMonitorData serviceData;
+    for (auto i = 0; i < numServices; i++)
+    {
+        serviceData.emplace("xyz.openbmc_project.Test" + std::to_string(i) +
+                            ".service");
+    }
+
+    auto bus = sdbusplus::bus::new_default();
+
+    phosphor::state::manager::SystemdTargetLogging targetMon(targetData,
+                                                             serviceData, bus);
+
+    // None of these lookups results in an error being logged
+    const std::string lastTarget = "obmc-test-" +
+                                   std::to_string(numTargets - 1) + "@0.target";
+    const std::string lastService = "xyz.openbmc_project.Test" +
+                                    std::to_string(numServices - 1) +
+                                    ".service";
+    const std::string unknownService = "xyz.openbmc_project.Unknown.service";
+
+    size_t errors = 0;
+    errors += !targetMon.processError(lastTarget, "dependency").empty();
+    errors += !targetMon.processError(lastService, "timeout").empty();
+    errors += !targetMon.processError(unknownService, "failed").empty();
+    EXPECT_EQ(errors, 0);
+}
+
+namespace
+{
+
+/** @brief Read a string from a mocked message */
+auto readString(const char* value)
+{
+    return Invoke([value](sd_bus_message*, char, void* p) {
+        *static_cast<const char**>(p) = value;
+        return 0;
+    });
+}
+
+} // namespace
+
+class TestQueuedActions : public testing::Test
+{
+  public:
+    /** @brief A method call made by the monitor */
+    struct Call
+    {
+        std::string path;
+        std::string member;
+        std::vector<std::string> strings;
+    };
+
+    TestQueuedActions() :
+        bus(sdbusplus::get_mocked_new(&sdbusMock)),
+        targetMon(targetData, serviceData, bus)
+    {
+        // Record the method calls made, each with its own message
+        EXPECT_CALL(sdbusMock,
+                    sd_bus_message_new_method_call(_, _, _, _, _, _))
+            .WillRepeatedly(Invoke([this](sd_bus*, sd_bus_message** m,
+                                          const char*, const char* path,
+                                          const char*, const char* member) {
+            calls.push_back({path, member, {}});
+            *m = reinterpret_cast<sd_bus_message*>(calls.size());
+            return 0;
+        }));
+        EXPECT_CALL(sdbusMock, sd_bus_message_append_basic(_, 's', _))
+            .WillRepeatedly(
+                Invoke([this](sd_bus_message* m, char, const void* value) {
+            auto index = reinterpret_cast<size_t>(m);
+            if ((index > 0) && (index <= calls.size()))
+            {
+                calls[index - 1].strings.emplace_back(
+                    static_cast<const char*>(value));
+            }
+            return 0;
+        }));
+
+        // The replies are handed to the monitor by the tests
+        EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+            .WillRepeatedly(Invoke([](sd_bus*, sd_bus_slot** slot,
+                                      sd_bus_message*,
+                                      sd_bus_message_handler_t, void*,
+                                      uint64_t) {
+            *slot = nullptr;
+            return 0;
+        }));
+    }
+
+    /** @brief Have the monitor handle a JobRemoved signal of a unit */
+    void jobRemoved(const char* unit, const char* result)
+    {
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 'u', _))
+            .WillOnce(Return(0));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 'o', _))
+            .WillOnce(readString("/org/freedesktop/systemd1/job/1"));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+            .WillOnce(readString(unit))
+            .WillOnce(readString(result));
+
+        auto msg = sdbusplus::message_t(nullptr, &sdbusMock);
+        targetMon.systemdUnitChange(msg);
+    }
+
+    /** @brief Reply to a read of a dependency property of a unit */
+    void dependencyReply(const char* unit,
+                         const std::vector<const char*>& units,
+                         uint64_t generation = 0)
+    {
+        EXPECT_CALL(sdbusMock,
+                    sd_bus_message_verify_type(_, 'v', testing::StrEq("as")))
+            .WillOnce(Return(1));
+        auto& atEnd = EXPECT_CALL(sdbusMock, sd_bus_message_at_end(_, _));
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            atEnd.WillOnce(Return(0));
+        }
+        atEnd.WillOnce(Return(1));
+        if (!units.empty())
+        {
+            auto& read = EXPECT_CALL(sdbusMock,
+                                     sd_bus_message_read_basic(_, 's', _));
+            for (const auto& dependency : units)
+            {
+                read.WillOnce(readString(dependency));
+            }
+        }
+
+        auto reply = sdbusplus::message_t(nullptr, &sdbusMock);
+        targetMon.dependencyReply(unit, generation, reply);
+    }
+
+    /** @brief Reply to the reads of all of the dependencies of a unit */
+    void dependencies(const char* unit, const std::vector<const char*>& units)
+    {
+        dependencyReply(unit, units);
+        dependencyReply(unit, {});
+        dependencyReply(unit, {});
+    }
+
+    /** @brief Count the calls of a method */
+    int count(const std::string& member) const
+    {
+        return std::count_if(calls.begin(), calls.end(),
+                             [&member](const auto& call) {
+            return call.member == member;
+        });
+    }
+
+    /** @brief Get the value of an additional data entry of the logged
+     *         errors */
+    std::vector<std::string> logged(const std::string& key) const
+    {
+        std::vector<std::string> values;
+        for (const auto& call : calls)
+        {
+            if (call.member != "Create")
+            {
+                continue;
+            }
+            auto entry = std::find(call.strings.begin(), call.strings.end(),
+                                   key);
+            if ((entry != call.strings.end()) &&
+                (std::next(entry) != call.strings.end()))
+            {
+                values.push_back(*std::next(entry));
+            }
+        }
+        return values;
+    }
+
+    static constexpr auto criticalService =
+        "xyz.openbmc_project.Dump.Manager.service";
+    static constexpr auto powerService = "xyz.openbmc_project.Power.service";
+    static constexpr auto quiesceTarget = "obmc-bmc-service-quiesce@0.target";
+    static constexpr auto poweronTarget = "obmc-chassis-poweron@0.target";
+    static constexpr auto hostStartTarget = "obmc-host-start@0.target";
+
+    sdbusplus::SdBusMock sdbusMock;
+    sdbusplus::bus_t bus;
+    TargetErrorData targetData = {
+        {poweronTarget,
+         {"xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure",
+          errorMask::timeout | errorMask::failed | errorMask::dependency}},
+        {hostStartTarget,
+         {"xyz.openbmc_project.State.Host.Error.HostStartFailure",
+          errorMask::timeout | errorMask::failed | errorMask::dependency}}};
+    ServiceMonitorData serviceData = {criticalService};
+    std::vector<Call> calls;
+    phosphor::state::manager::SystemdTargetLogging targetMon;
+};
+
+TEST_F(TestQueuedActions, actionsWaitForTheBurst)
+{
+    jobRemoved(poweronTarget, "failed");
+    jobRemoved(hostStartTarget, "timeout");
+    jobRemoved(criticalService, "failed");
+
+    // Nothing is sent from the signal handler
+    EXPECT_TRUE(calls.empty());
+
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("CreateDump"), 1);
+    EXPECT_EQ(count("StartUnit"), 1);
+    EXPECT_EQ(count("Create"), 3);
+}
+
+TEST_F(TestQueuedActions, oneLogPerUnit)
+{
+    jobRemoved(poweronTarget, "failed");
+    jobRemoved(poweronTarget, "timeout");
+
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("Create"), 1);
+}
+
+TEST_F(TestQueuedActions, unmonitoredFailuresIgnored)
+{
+    jobRemoved(poweronTarget, "done");
+    jobRemoved("xyz.openbmc_project.Unmonitored.service", "failed");
+
+    targetMon.processQueuedActions();
+    EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(TestQueuedActions, noDumpWhileDumpInFlight)
+{
+    jobRemoved(poweronTarget, "failed");
+    targetMon.processQueuedActions();
+
+    // The reply to the first dump request has not come back
+    jobRemoved(hostStartTarget, "failed");
+    targetMon.processQueuedActions();
+
+    EXPECT_EQ(count("CreateDump"), 1);
+    EXPECT_EQ(count("Create"), 2);
+}
+
+TEST_F(TestQueuedActions, quiesceQueuedAgainOnceStarted)
+{
+    jobRemoved(criticalService, "failed");
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("StartUnit"), 1);
+
+    // The start of the quiesce target is still in progress
+    jobRemoved(criticalService, "failed");
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("StartUnit"), 1);
+
+    jobRemoved(quiesceTarget, "done");
+    jobRemoved(criticalService, "failed");
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("StartUnit"), 2);
+}
+
+TEST_F(TestQueuedActions, quiesceQueuedAgainWhenNotSent)
+{
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+        .WillRepeatedly(Return(-ENOTCONN));
+
+    jobRemoved(criticalService, "failed");
+    targetMon.processQueuedActions();
+    jobRemoved(criticalService, "failed");
+    targetMon.processQueuedActions();
+
+    EXPECT_EQ(count("StartUnit"), 2);
+
+    // Nor is a dump request outstanding
+    EXPECT_EQ(count("CreateDump"), 2);
+}
+
+TEST_F(TestQueuedActions, rootCauseCombinesLogs)
+{
+    jobRemoved(powerService, "failed");
+    jobRemoved(poweronTarget, "dependency");
+    jobRemoved(hostStartTarget, "dependency");
+
+    // The dependencies of the units failed by a dependency are read while
+    // the burst goes on, from the unit objects of systemd
+    EXPECT_EQ(count("Get"), 6);
+    EXPECT_EQ(calls.front().path,
+              "/org/freedesktop/systemd1/unit/"
+              "obmc_2dchassis_2dpoweron_400_2etarget");
+
+    dependencies(poweronTarget, {powerService});
+    dependencies(hostStartTarget, {"obmc-host-startmin@0.target",
+                                   poweronTarget});
+    targetMon.processQueuedActions();
+
+    // One log, of the first monitored unit, for the unmonitored root
+    EXPECT_EQ(count("Create"), 1);
+    EXPECT_EQ(logged("SYSTEMD_UNIT"),
+              std::vector<std::string>{poweronTarget});
+    EXPECT_EQ(logged("SYSTEMD_ROOT_UNIT"),
+              std::vector<std::string>{powerService});
+    EXPECT_EQ(logged("SYSTEMD_ROOT_RESULT"),
+              std::vector<std::string>{"failed"});
+    EXPECT_EQ(logged("SYSTEMD_DEPENDENT_UNITS"),
+              std::vector<std::string>{hostStartTarget});
+}
+
+TEST_F(TestQueuedActions, monitoredRootLogged)
+{
+    jobRemoved(poweronTarget, "failed");
+    jobRemoved(hostStartTarget, "dependency");
+    dependencies(hostStartTarget, {poweronTarget});
+    targetMon.processQueuedActions();
+
+    EXPECT_EQ(count("Create"), 1);
+    EXPECT_EQ(logged("SYSTEMD_UNIT"),
+              std::vector<std::string>{poweronTarget});
+    EXPECT_TRUE(logged("SYSTEMD_ROOT_UNIT").empty());
+    EXPECT_EQ(logged("SYSTEMD_DEPENDENT_UNITS"),
+              std::vector<std::string>{hostStartTarget});
+}
+
+TEST_F(TestQueuedActions, unrelatedFailuresLoggedApart)
+{
+    jobRemoved(powerService, "failed");
+    jobRemoved(hostStartTarget, "dependency");
+    jobRemoved(poweronTarget, "timeout");
+    dependencies(hostStartTarget, {"obmc-host-startmin@0.target"});
+    targetMon.processQueuedActions();
+
+    EXPECT_EQ(count("Create"), 2);
+    EXPECT_TRUE(logged("SYSTEMD_ROOT_UNIT").empty());
+}
+
+TEST_F(TestQueuedActions, burstExtendedForLookups)
+{
+    jobRemoved(powerService, "failed");
+    jobRemoved(hostStartTarget, "dependency");
+
+    // Waits for the dependencies once
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("Create"), 0);
+
+    // Then logs without them
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("Create"), 1);
+    EXPECT_TRUE(logged("SYSTEMD_ROOT_UNIT").empty());
+}
+
+TEST_F(TestQueuedActions, dependenciesCached)
+{
+    jobRemoved(hostStartTarget, "dependency");
+    dependencies(hostStartTarget, {});
+    targetMon.processQueuedActions();
+
+    jobRemoved(hostStartTarget, "dependency");
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("Get"), 3);
+}
+
+TEST_F(TestQueuedActions, dependenciesDroppedOnReload)
+{
+    jobRemoved(hostStartTarget, "dependency");
+    dependencies(hostStartTarget, {});
+
+    targetMon.dropDependencies();
+
+    // The dependencies are read again
+    jobRemoved(hostStartTarget, "dependency");
+    EXPECT_EQ(count("Get"), 6);
+
+    // A reply to a read from before the reload is dropped unread
+    EXPECT_CALL(sdbusMock, sd_bus_message_verify_type(_, _, _)).Times(0);
+    auto stale = sdbusplus::message_t(nullptr, &sdbusMock);
+    targetMon.dependencyReply(hostStartTarget, 0, stale);
+
+    dependencyReply(hostStartTarget, {poweronTarget}, 1);
+    dependencyReply(hostStartTarget, {}, 1);
+    dependencyReply(hostStartTarget, {}, 1);
+
+    jobRemoved(poweronTarget, "failed");
+    targetMon.processQueuedActions();
+    EXPECT_EQ(count("Create"), 1);
+}
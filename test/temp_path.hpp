@@ -0,0 +1,56 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class TempPath
+ *  @brief A path in the temporary directory, unique to the test process.
+ *         Anything left at it is removed when it is created and destroyed.
+ */
+class TempPath
+{
+  public:
+    TempPath(const TempPath&) = delete;
+    TempPath& operator=(const TempPath&) = delete;
+    TempPath(TempPath&&) = delete;
+    TempPath& operator=(TempPath&&) = delete;
+
+    /** @brief Constructor
+     *
+     * @param[in] name - The name of the path, the process id is added to it
+     */
+    explicit TempPath(const std::string& name) :
+        path(std::filesystem::temp_directory_path() /
+             (name + "-" + std::to_string(getpid())))
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    ~TempPath()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+
+    operator const std::filesystem::path&() const
+    {
+        return path;
+    }
+
+    /** @brief The path */
+    const std::filesystem::path path;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
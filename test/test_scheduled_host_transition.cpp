@@ -1,10 +1,18 @@
 #include "scheduled_host_transition.hpp"
+#include "temp_path.hpp"
 
+#include <cereal/archives/json.hpp>
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/test/sdbus_mock.hpp>
 #include <sdeventplus/event.hpp>
 #include <xyz/openbmc_project/ScheduledTime/error.hpp>
 
+#include <cerrno>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -21,19 +29,61 @@ using InvalidTimeError =
 using HostTransition =
     sdbusplus::xyz::openbmc_project::State::server::ScheduledHostTransition;
 
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::StrEq;
+
+namespace
+{
+
+constexpr auto bmcNotReady = "xyz.openbmc_project.State.Host.Error.BMCNotReady";
+
+/** @brief Read a string from a mocked message */
+auto readString(const char* value)
+{
+    return Invoke([value](sd_bus_message*, char, void* p) {
+        *static_cast<const char**>(p) = value;
+        return 0;
+    });
+}
+
+} // namespace
+
 class TestScheduledHostTransition : public testing::Test
 {
   public:
     sdeventplus::Event event;
     sdbusplus::SdBusMock sdbusMock;
     sdbusplus::bus_t mockedBus = sdbusplus::get_mocked_new(&sdbusMock);
+    TempPath persistPath{"psm-scheduled-host-transition"};
+    HostTransitionScheduler scheduler;
     ScheduledHostTransition scheduledHostTransition;
 
+    /** @brief The retry state of the host, for the checks of the tests */
+    std::vector<ScheduledEntry>& queue = scheduledHostTransition.queue;
+    std::vector<ScheduledEntry>& inFlight = scheduledHostTransition.inFlight;
+    std::optional<seconds>& retryDelay = scheduledHostTransition.retryDelay;
+    std::unique_ptr<sdbusplus::bus::match_t>& bmcStateChangeSignal =
+        scheduledHostTransition.bmcStateChangeSignal;
+    std::string& hostService = scheduledHostTransition.hostService;
+
     TestScheduledHostTransition() :
         event(sdeventplus::Event::get_default()),
-        scheduledHostTransition(mockedBus, "", 0, event)
+        scheduler(event, persistPath),
+        scheduledHostTransition(mockedBus, "", 0, scheduler)
     {
-        // Empty
+        scheduledHostTransition.monotonicNow = [this] { return monotonic; };
+
+        // The errors of failed calls are built by sd-bus
+        EXPECT_CALL(sdbusMock, sd_bus_error_set_errno(_, _))
+            .WillRepeatedly(Invoke(sd_bus_error_set_errno));
+        EXPECT_CALL(sdbusMock, sd_bus_error_is_set(_))
+            .WillRepeatedly(Invoke(sd_bus_error_is_set));
+        EXPECT_CALL(sdbusMock, sd_bus_error_get_errno(_))
+            .WillRepeatedly(Invoke(sd_bus_error_get_errno));
+        EXPECT_CALL(sdbusMock, sd_bus_error_free(_))
+            .WillRepeatedly(Invoke(sd_bus_error_free));
     }
 
     seconds getCurrentTime()
@@ -43,13 +93,159 @@ class TestScheduledHostTransition : public testing::Test
 
     bool isTimerEnabled()
     {
-        return scheduledHostTransition.timer.isEnabled();
+        return scheduler.isScheduled(0);
     }
 
     void bmcTimeChange()
     {
         scheduledHostTransition.handleTimeUpdates();
     }
+
+    /** @brief Queue a transition */
+    void addTransition(uint64_t time, Transition transition)
+    {
+        scheduledHostTransition.addScheduledTransition(time, transition);
+    }
+
+    /** @brief Queue a transition, as the queue interface does */
+    void queueTransition(uint64_t time, Transition transition)
+    {
+        scheduledHostTransition.queueTransition(time, transition);
+    }
+
+    /** @brief Drop the queued transitions, as the queue interface does */
+    void clearTransitions()
+    {
+        scheduledHostTransition.clearTransitions();
+    }
+
+    /** @brief The transitions of the queue interface persisted */
+    std::vector<ScheduledEntry> storedQueue()
+    {
+        return scheduler.getStoredTransitions(0)
+            .value_or(StoredTransitions{})
+            .queue;
+    }
+
+    /** @brief Have the scheduled time pass, as it can't be set in the
+     *         past */
+    void scheduledTimePassed()
+    {
+        scheduledHostTransition.HostTransition::scheduledTime(
+            static_cast<uint64_t>((getCurrentTime() - seconds(1)).count()));
+    }
+
+    /** @brief Queue a transition which is already due */
+    void addDueTransition(Transition transition)
+    {
+        addTransition(
+            static_cast<uint64_t>((getCurrentTime() - seconds(1)).count()),
+            transition);
+    }
+
+    void doDueTransitions()
+    {
+        scheduledHostTransition.doDueTransitions();
+    }
+
+    void retryTransition()
+    {
+        scheduledHostTransition.retryTransition();
+    }
+
+    /** @brief Start retrying now with a fixed jitter sequence */
+    void seedRetry(unsigned seed)
+    {
+        scheduledHostTransition.retryRandom.seed(seed);
+        scheduledHostTransition.retryStart = monotonic;
+    }
+
+    /** @brief Request the due transitions, failing the call with an errno
+     *         if one is given */
+    void requestTransitions(int errnoCode = 0)
+    {
+        // Skip the mapper lookup of the host state manager
+        hostService = "xyz.openbmc_project.State.Host";
+
+        EXPECT_CALL(sdbusMock,
+                    sd_bus_message_new_method_call(_, _, _, _, _, _))
+            .WillRepeatedly(Invoke([](sd_bus*, sd_bus_message** m,
+                                      const char*, const char*, const char*,
+                                      const char*) {
+            *m = nullptr;
+            return 0;
+        }));
+        EXPECT_CALL(sdbusMock, sd_bus_message_append_basic(_, 's', _))
+            .WillRepeatedly(Invoke([this](sd_bus_message*, char,
+                                          const void* p) {
+            appended.emplace_back(static_cast<const char*>(p));
+            return 0;
+        }));
+        EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _))
+            .WillRepeatedly(Invoke([errnoCode](sd_bus*, sd_bus_slot** slot,
+                                               sd_bus_message*,
+                                               sd_bus_message_handler_t,
+                                               void*, uint64_t) {
+            *slot = nullptr;
+            return -errnoCode;
+        }));
+
+        doDueTransitions();
+    }
+
+    /** @brief Reply to the transition request, with an error if one is
+     *         given */
+    void transitionReply(const char* errorName = nullptr, int errnoCode = 0)
+    {
+        replyError.name = errorName;
+        EXPECT_CALL(sdbusMock, sd_bus_message_is_method_error(_, _))
+            .WillOnce(Return(errorName != nullptr));
+        if (errorName != nullptr)
+        {
+            EXPECT_CALL(sdbusMock, sd_bus_message_get_error(_))
+                .WillRepeatedly(Return(&replyError));
+            EXPECT_CALL(sdbusMock, sd_bus_message_get_errno(_))
+                .WillRepeatedly(Return(errnoCode));
+        }
+
+        auto reply = sdbusplus::message_t(nullptr, &sdbusMock);
+        scheduledHostTransition.transitionDone(reply);
+    }
+
+    /** @brief Seconds until the host is called back */
+    int64_t callbackIn()
+    {
+        auto deadline = scheduler.getDeadline(0);
+        EXPECT_TRUE(deadline.has_value());
+        return static_cast<int64_t>(deadline.value_or(0)) -
+               getCurrentTime().count();
+    }
+
+    /** @brief Have the BMC state change */
+    void bmcStateChange(const char* state)
+    {
+        EXPECT_CALL(sdbusMock, sd_bus_message_at_end(_, _))
+            .WillOnce(Return(0))
+            .WillRepeatedly(Return(1));
+        EXPECT_CALL(sdbusMock, sd_bus_message_verify_type(_, 'v', StrEq("s")))
+            .WillOnce(Return(1));
+        EXPECT_CALL(sdbusMock, sd_bus_message_read_basic(_, 's', _))
+            .WillOnce(readString("xyz.openbmc_project.State.BMC"))
+            .WillOnce(readString("CurrentBMCState"))
+            .WillOnce(readString(state));
+
+        auto msg = sdbusplus::message_t(nullptr, &sdbusMock);
+        scheduledHostTransition.bmcStateChangeEvent(msg);
+    }
+
+    /** @brief The monotonic clock of the retries */
+    steady_clock::time_point monotonic{};
+
+    /** @brief The error of a failed reply */
+    sd_bus_error replyError{};
+
+    /** @brief The strings of the transition requests */
+    std::vector<std::string> appended;
 };
 
 TEST_F(TestScheduledHostTransition, disableHostTransition)
@@ -112,6 +308,363 @@ TEST_F(TestScheduledHostTransition, bmcTimeChangeBackward)
     EXPECT_TRUE(isTimerEnabled());
 }
 
+TEST_F(TestScheduledHostTransition, rescheduleReplaces)
+{
+    uint64_t firstTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(60)).count());
+    uint64_t secondTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(120)).count());
+
+    // Setting the time again replaces the pending transition
+    scheduledHostTransition.scheduledTime(firstTime);
+    EXPECT_EQ(scheduledHostTransition.scheduledTime(secondTime), secondTime);
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              secondTime);
+    EXPECT_EQ(scheduler.getDeadline(0), secondTime);
+    EXPECT_TRUE(queue.empty());
+
+    auto stored = scheduler.getStoredTransitions(0);
+    ASSERT_TRUE(stored);
+    EXPECT_EQ(stored->scheduled.time, secondTime);
+    EXPECT_TRUE(stored->queue.empty());
+}
+
+TEST_F(TestScheduledHostTransition, transitionReadWhenDue)
+{
+    uint64_t schTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(60)).count());
+    scheduledHostTransition.scheduledTransition(Transition::On);
+    scheduledHostTransition.scheduledTime(schTime);
+
+    // Changed after the time was set, which is stored too
+    scheduledHostTransition.scheduledTransition(Transition::Off);
+    EXPECT_EQ(scheduler.getStoredTransitions(0)->scheduled.transition,
+              Transition::Off);
+
+    scheduledTimePassed();
+    requestTransitions();
+    EXPECT_THAT(appended,
+                ::testing::Contains(
+                    "xyz.openbmc_project.State.Host.Transition.Off"));
+
+    // Done, so no longer scheduled
+    transitionReply();
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(), 0);
+    EXPECT_EQ(scheduledHostTransition.scheduledTransition(), Transition::Off);
+    EXPECT_FALSE(isTimerEnabled());
+}
+
+TEST_F(TestScheduledHostTransition, rescheduledWhileRequested)
+{
+    scheduledTimePassed();
+    requestTransitions();
+
+    // A time set meanwhile is kept once the request is done
+    uint64_t schTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(60)).count());
+    scheduledHostTransition.scheduledTime(schTime);
+    transitionReply();
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              schTime);
+    EXPECT_EQ(scheduler.getDeadline(0), schTime);
+}
+
+TEST_F(TestScheduledHostTransition, queueKeptApart)
+{
+    uint64_t queuedTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(60)).count());
+    uint64_t schTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(120)).count());
+
+    queueTransition(queuedTime, Transition::Off);
+    scheduledHostTransition.scheduledTime(schTime);
+
+    // Called back for the earliest, without changing the properties
+    EXPECT_EQ(scheduler.getDeadline(0), queuedTime);
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              schTime);
+    EXPECT_EQ(storedQueue().size(), 1);
+
+    // Clearing the scheduled time leaves the queue
+    scheduledHostTransition.scheduledTime(0);
+    EXPECT_EQ(queue.size(), 1);
+    EXPECT_EQ(scheduler.getDeadline(0), queuedTime);
+
+    clearTransitions();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(storedQueue().empty());
+    EXPECT_FALSE(isTimerEnabled());
+
+    // Like the scheduled time, it can't be in the past
+    EXPECT_THROW(queueTransition(static_cast<uint64_t>(
+                                     (getCurrentTime() - seconds(60)).count()),
+                                 Transition::On),
+                 InvalidTimeError);
+}
+
+TEST_F(TestScheduledHostTransition, dueWithQueue)
+{
+    // The scheduled transition is the latest of the due ones
+    scheduledHostTransition.scheduledTransition(Transition::Off);
+    addTransition(
+        static_cast<uint64_t>((getCurrentTime() - seconds(2)).count()),
+        Transition::On);
+    scheduledTimePassed();
+    requestTransitions();
+    EXPECT_THAT(appended,
+                ::testing::Contains(
+                    "xyz.openbmc_project.State.Host.Transition.Off"));
+    EXPECT_EQ(inFlight.size(), 1);
+
+    // Both are done
+    transitionReply();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(), 0);
+    EXPECT_FALSE(isTimerEnabled());
+}
+
+TEST_F(TestScheduledHostTransition, transitionDone)
+{
+    addDueTransition(Transition::Off);
+    requestTransitions();
+    EXPECT_EQ(inFlight.size(), 1);
+
+    // Nothing more is requested while the transition is in flight
+    EXPECT_CALL(sdbusMock, sd_bus_call_async(_, _, _, _, _, _)).Times(0);
+    doDueTransitions();
+
+    transitionReply();
+    EXPECT_TRUE(inFlight.empty());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(retryDelay);
+    EXPECT_FALSE(isTimerEnabled());
+    EXPECT_TRUE(storedQueue().empty());
+}
+
+TEST_F(TestScheduledHostTransition, supersededTransitions)
+{
+    // Only the latest of the due transitions is requested
+    auto now = static_cast<uint64_t>(getCurrentTime().count());
+    addTransition(now - 1, Transition::Off);
+    addTransition(now - 2, Transition::On);
+    requestTransitions();
+    ASSERT_EQ(inFlight.size(), 2);
+    EXPECT_EQ(inFlight.back().transition, Transition::Off);
+    EXPECT_TRUE(queue.empty());
+
+    // They are all put back when it fails
+    transitionReply(bmcNotReady);
+    EXPECT_TRUE(inFlight.empty());
+    EXPECT_EQ(queue.size(), 2);
+}
+
+TEST_F(TestScheduledHostTransition, retryBackoff)
+{
+    addDueTransition(Transition::On);
+
+    // The delay doubles up to the maximum, spread by a quarter either way
+    for (auto delay : {5, 10, 20, 40, 60, 60})
+    {
+        requestTransitions();
+        transitionReply(bmcNotReady);
+
+        ASSERT_TRUE(retryDelay);
+        EXPECT_EQ(*retryDelay, seconds(delay));
+        EXPECT_GE(callbackIn(), delay - delay / 4 - 1);
+        EXPECT_LE(callbackIn(), delay + delay / 4);
+        EXPECT_EQ(queue.size(), 1);
+        EXPECT_TRUE(bmcStateChangeSignal);
+    }
+}
+
+TEST_F(TestScheduledHostTransition, retryJitter)
+{
+    addDueTransition(Transition::On);
+    seedRetry(1);
+
+    std::set<int64_t> delays;
+    for (int i = 0; i < 20; i++)
+    {
+        // The next retry is at the maximum delay of 60s
+        retryDelay = seconds(40);
+        retryTransition();
+
+        auto delay = callbackIn();
+        EXPECT_GE(delay, 45 - 1);
+        EXPECT_LE(delay, 75);
+        delays.insert(delay);
+    }
+
+    // The retries of different hosts don't line up
+    EXPECT_GT(delays.size(), 1);
+}
+
+TEST_F(TestScheduledHostTransition, retryDeadline)
+{
+    addDueTransition(Transition::On);
+    requestTransitions();
+    transitionReply(bmcNotReady);
+
+    // Still retried just before the deadline
+    monotonic += minutes(29);
+    requestTransitions();
+    transitionReply(bmcNotReady);
+    EXPECT_EQ(queue.size(), 1);
+    EXPECT_TRUE(isTimerEnabled());
+
+    // Dropped once the BMC was not ready for 30 minutes
+    monotonic += minutes(1);
+    requestTransitions();
+    transitionReply(bmcNotReady);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(retryDelay);
+    EXPECT_FALSE(bmcStateChangeSignal);
+    EXPECT_FALSE(isTimerEnabled());
+    EXPECT_TRUE(storedQueue().empty());
+}
+
+TEST_F(TestScheduledHostTransition, timeoutRetried)
+{
+    addDueTransition(Transition::On);
+    requestTransitions();
+    transitionReply("org.freedesktop.DBus.Error.NoReply", ETIMEDOUT);
+
+    EXPECT_EQ(queue.size(), 1);
+    EXPECT_TRUE(retryDelay);
+
+    // The host state manager is looked up again
+    EXPECT_TRUE(hostService.empty());
+}
+
+TEST_F(TestScheduledHostTransition, rejectedNotRetried)
+{
+    uint64_t laterTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(60)).count());
+    addTransition(laterTime, Transition::Off);
+    addDueTransition(Transition::On);
+    requestTransitions();
+    transitionReply("org.freedesktop.DBus.Error.AccessDenied", EACCES);
+
+    // Only the due transition is dropped
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.front().time, laterTime);
+    EXPECT_FALSE(retryDelay);
+    EXPECT_EQ(scheduler.getDeadline(0), laterTime);
+    EXPECT_EQ(storedQueue().size(), 1);
+}
+
+TEST_F(TestScheduledHostTransition, requestFailures)
+{
+    addDueTransition(Transition::On);
+
+    // A call which times out is retried
+    requestTransitions(ETIMEDOUT);
+    EXPECT_EQ(queue.size(), 1);
+    EXPECT_TRUE(retryDelay);
+    EXPECT_TRUE(inFlight.empty());
+
+    // Any other error drops the transition
+    requestTransitions(EACCES);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(retryDelay);
+    EXPECT_FALSE(isTimerEnabled());
+}
+
+TEST_F(TestScheduledHostTransition, retryWhenBmcReady)
+{
+    addDueTransition(Transition::On);
+    requestTransitions();
+    transitionReply(bmcNotReady);
+    auto retry = scheduler.getDeadline(0);
+
+    // Other BMC states don't change the retry
+    bmcStateChange("xyz.openbmc_project.State.BMC.BMCState.NotReady");
+    EXPECT_EQ(scheduler.getDeadline(0), retry);
+
+    // The transition is retried right away once the BMC is ready
+    bmcStateChange("xyz.openbmc_project.State.BMC.BMCState.Ready");
+    EXPECT_LE(callbackIn(), 0);
+}
+
+class TestTransitionStore : public testing::Test
+{
+  public:
+    /** @brief Write a file in the json format of an earlier version */
+    template <typename... T>
+    void writeJson(T&&... values)
+    {
+        std::ofstream os(persistPath.path);
+        cereal::JSONOutputArchive oarchive(os);
+        oarchive(std::forward<T>(values)...);
+    }
+
+    /** @brief Check if the file is in the json format */
+    bool isJson()
+    {
+        std::ifstream is(persistPath.path);
+        return is.peek() == '{';
+    }
+
+    sdeventplus::Event event = sdeventplus::Event::get_default();
+    TempPath persistPath{"psm-scheduled-transitions"};
+};
+
+TEST_F(TestTransitionStore, persisted)
+{
+    {
+        HostTransitionScheduler scheduler(event, persistPath);
+        scheduler.storeTransitions(0, {{100, Transition::Off}, {}});
+        scheduler.storeTransitions(
+            1, {{0, Transition::On},
+                {{200, Transition::Off}, {300, Transition::Reboot}}});
+    }
+    EXPECT_FALSE(isJson());
+
+    HostTransitionScheduler scheduler(event, persistPath);
+    auto stored = scheduler.getStoredTransitions(0);
+    ASSERT_TRUE(stored);
+    EXPECT_EQ(stored->scheduled.time, 100);
+    EXPECT_EQ(stored->scheduled.transition, Transition::Off);
+    EXPECT_TRUE(stored->queue.empty());
+
+    stored = scheduler.getStoredTransitions(1);
+    ASSERT_TRUE(stored);
+    EXPECT_EQ(stored->scheduled.time, 0);
+    ASSERT_EQ(stored->queue.size(), 2);
+    EXPECT_EQ(stored->queue[0].time, 200);
+    EXPECT_EQ(stored->queue[1].time, 300);
+    EXPECT_EQ(stored->queue[1].transition, Transition::Reboot);
+
+    EXPECT_FALSE(scheduler.getStoredTransitions(2));
+}
+
+TEST_F(TestTransitionStore, migrateJson)
+{
+    writeJson(uint64_t{100}, Transition::Reboot);
+
+    HostTransitionScheduler scheduler(event, persistPath);
+    auto stored = scheduler.getStoredTransitions(0);
+    ASSERT_TRUE(stored);
+    EXPECT_EQ(stored->scheduled.time, 100);
+    EXPECT_EQ(stored->scheduled.transition, Transition::Reboot);
+    EXPECT_TRUE(stored->queue.empty());
+
+    // Written again in the current format
+    EXPECT_FALSE(isJson());
+}
+
+TEST_F(TestTransitionStore, invalidFileDropped)
+{
+    {
+        std::ofstream os(persistPath.path);
+        os << "not transitions";
+    }
+
+    HostTransitionScheduler scheduler(event, persistPath);
+    EXPECT_FALSE(scheduler.getStoredTransitions(0));
+    EXPECT_FALSE(std::filesystem::exists(persistPath.path));
+}
+
 } // namespace manager
 } // namespace state
 } // namespace phosphor
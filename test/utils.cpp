@@ -0,0 +1,148 @@
+#include "utils.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+
+#include <cerrno>
+#include <chrono>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace utils = phosphor::state::manager::utils;
+
+using namespace std::chrono_literals;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+class TestCall : public testing::Test
+{
+  public:
+    TestCall() : bus(sdbusplus::get_mocked_new(&sdbusMock))
+    {
+        // Each test counts the calls to its own service
+        EXPECT_CALL(sdbusMock, sd_bus_message_get_destination(_))
+            .WillRepeatedly(Return(service));
+
+        // The errors of failed calls are built by sd-bus
+        EXPECT_CALL(sdbusMock, sd_bus_error_get_errno(_))
+            .WillRepeatedly(Invoke(sd_bus_error_get_errno));
+        EXPECT_CALL(sdbusMock, sd_bus_error_is_set(_))
+            .WillRepeatedly(Invoke(sd_bus_error_is_set));
+        EXPECT_CALL(sdbusMock, sd_bus_error_free(_))
+            .WillRepeatedly(Invoke(sd_bus_error_free));
+    }
+
+    /** @brief Fail the next call with an errno */
+    void failCall(int errnoCode)
+    {
+        EXPECT_CALL(sdbusMock, sd_bus_call(_, _, _, _, _))
+            .WillOnce(Invoke([errnoCode](sd_bus*, sd_bus_message*, uint64_t,
+                                         sd_bus_error* error,
+                                         sd_bus_message**) {
+            return sd_bus_error_set_errno(error, errnoCode);
+        }));
+    }
+
+    /** @brief Get the counters of the service of the test */
+    utils::CallStats stats() const
+    {
+        auto entry = utils::getCallStats().find(service);
+        return (entry == utils::getCallStats().end()) ? utils::CallStats{}
+                                                      : entry->second;
+    }
+
+    sdbusplus::SdBusMock sdbusMock;
+    sdbusplus::bus_t bus;
+    const char* service =
+        testing::UnitTest::GetInstance()->current_test_info()->name();
+};
+
+TEST(Deadline, remaining)
+{
+    utils::Deadline deadline(10s);
+    EXPECT_GT(deadline.remaining(), 0us);
+    EXPECT_LE(deadline.remaining(), 10s);
+}
+
+TEST(Deadline, passed)
+{
+    utils::Deadline deadline(0us);
+    EXPECT_EQ(deadline.remaining(), 0us);
+}
+
+TEST_F(TestCall, timeoutOfClass)
+{
+    EXPECT_CALL(sdbusMock, sd_bus_call(_, _, 10000000, _, _))
+        .WillOnce(Return(0));
+    auto method = sdbusplus::message_t(nullptr, &sdbusMock);
+    utils::call(bus, method, utils::CallClass::Query);
+
+    EXPECT_CALL(sdbusMock, sd_bus_call(_, _, 60000000, _, _))
+        .WillOnce(Return(0));
+    utils::call(bus, method, utils::CallClass::Slow);
+
+    EXPECT_EQ(stats().calls, 2);
+    EXPECT_EQ(stats().timeouts, 0);
+    EXPECT_EQ(stats().failures, 0);
+}
+
+TEST_F(TestCall, timeoutOfDeadline)
+{
+    // The deadline is sooner than the timeout of the class
+    utils::Deadline deadline(2s);
+    EXPECT_CALL(sdbusMock, sd_bus_call(_, _, testing::Le(2000000u), _, _))
+        .WillOnce(Return(0));
+
+    auto method = sdbusplus::message_t(nullptr, &sdbusMock);
+    utils::call(bus, method, utils::CallClass::Control, &deadline);
+    EXPECT_EQ(stats().calls, 1);
+}
+
+TEST_F(TestCall, deadlinePassed)
+{
+    // Not sent as it could not be answered in time
+    EXPECT_CALL(sdbusMock, sd_bus_call(_, _, _, _, _)).Times(0);
+
+    utils::Deadline deadline(0us);
+    auto method = sdbusplus::message_t(nullptr, &sdbusMock);
+    try
+    {
+        utils::call(bus, method, utils::CallClass::Query, &deadline);
+        FAIL() << "The call was made";
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        EXPECT_EQ(e.get_errno(), ETIMEDOUT);
+    }
+
+    EXPECT_EQ(stats().calls, 1);
+    EXPECT_EQ(stats().timeouts, 1);
+    EXPECT_EQ(stats().failures, 0);
+}
+
+TEST_F(TestCall, timedOut)
+{
+    failCall(ETIMEDOUT);
+
+    auto method = sdbusplus::message_t(nullptr, &sdbusMock);
+    EXPECT_THROW(utils::call(bus, method), sdbusplus::exception_t);
+
+    EXPECT_EQ(stats().calls, 1);
+    EXPECT_EQ(stats().timeouts, 1);
+    EXPECT_EQ(stats().failures, 0);
+}
+
+TEST_F(TestCall, failed)
+{
+    failCall(EACCES);
+
+    auto method = sdbusplus::message_t(nullptr, &sdbusMock);
+    EXPECT_THROW(utils::call(bus, method), sdbusplus::exception_t);
+
+    EXPECT_EQ(stats().calls, 1);
+    EXPECT_EQ(stats().timeouts, 0);
+    EXPECT_EQ(stats().failures, 1);
+}
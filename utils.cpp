@@ -7,7 +7,10 @@
 #include <gpiod.h>
 
 #include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/exception.hpp>
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <filesystem>
 
@@ -33,6 +36,101 @@ constexpr auto MAPPER_PATH = "/xyz/openbmc_project/object_mapper";
 constexpr auto MAPPER_INTERFACE = "xyz.openbmc_project.ObjectMapper";
 constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
 
+namespace
+{
+
+/** @brief The counters of the D-Bus calls of this process, by service */
+std::map<std::string, CallStats> callStats;
+
+} // namespace
+
+std::chrono::microseconds callTimeout(CallClass callClass)
+{
+    switch (callClass)
+    {
+        case CallClass::Query:
+            return 10s;
+        case CallClass::Control:
+            // The default D-Bus timeout
+            return 25s;
+        case CallClass::Slow:
+            // On OpenBMC based systems, systemd has had a few situations
+            // where it has been unable to respond within the default d-bus
+            // timeout of 25 seconds. This is due to the large amount of work
+            // being done by systemd during OpenBMC startup (worst case seen
+            // was around 30s so double it).
+            return 60s;
+    }
+    return 25s;
+}
+
+std::chrono::microseconds Deadline::remaining() const
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now >= end)
+    {
+        return 0us;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - now);
+}
+
+sdbusplus::message_t call(sdbusplus::bus_t& bus, sdbusplus::message_t& method,
+                          CallClass callClass, const Deadline* deadline)
+{
+    const char* destination = method.get_destination();
+    auto& stats = callStats[destination ? destination : ""];
+    stats.calls++;
+
+    auto timeout = callTimeout(callClass);
+    if (deadline != nullptr)
+    {
+        timeout = std::min(timeout, deadline->remaining());
+        if (timeout == 0us)
+        {
+            // Not even sent, as it could not be answered in time
+            stats.timeouts++;
+            throw sdbusplus::exception::SdBusError(
+                ETIMEDOUT, "Deadline passed before the D-Bus call");
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto countLatency = [&stats, start]() {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        stats.totalLatency += latency;
+        stats.maxLatency = std::max(stats.maxLatency, latency);
+    };
+
+    try
+    {
+        auto reply = bus.call(method, timeout);
+        countLatency();
+        return reply;
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        countLatency();
+        if (e.get_errno() != ETIMEDOUT)
+        {
+            stats.failures++;
+            throw;
+        }
+
+        stats.timeouts++;
+        warning(
+            "D-Bus call to {SERVICE} timed out after {TIMEOUT}us, {TIMEOUTS} of {CALLS} calls timed out",
+            "SERVICE", destination ? destination : "", "TIMEOUT",
+            timeout.count(), "TIMEOUTS", stats.timeouts, "CALLS", stats.calls);
+        throw;
+    }
+}
+
+const std::map<std::string, CallStats>& getCallStats()
+{
+    return callStats;
+}
+
 void subscribeToSystemdSignals(sdbusplus::bus_t& bus)
 {
     auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
@@ -40,12 +138,7 @@ void subscribeToSystemdSignals(sdbusplus::bus_t& bus)
 
     try
     {
-        // On OpenBMC based systems, systemd has had a few situations where it
-        // has been unable to respond to this call within the default d-bus
-        // timeout of 25 seconds. This is due to the large amount of work being
-        // done by systemd during OpenBMC startup. Set the timeout for this call
-        // to 60 seconds (worst case seen was around 30s so double it).
-        bus.call(method, 60s);
+        call(bus, method, CallClass::Slow);
     }
     catch (const sdbusplus::exception_t& e)
     {
@@ -56,7 +149,7 @@ void subscribeToSystemdSignals(sdbusplus::bus_t& bus)
 }
 
 std::string getService(sdbusplus::bus_t& bus, std::string path,
-                       std::string interface)
+                       std::string interface, const Deadline* deadline)
 {
     auto mapper = bus.new_method_call(MAPPER_BUSNAME, MAPPER_PATH,
                                       MAPPER_INTERFACE, "GetObject");
@@ -68,7 +161,8 @@ std::string getService(sdbusplus::bus_t& bus, std::string path,
 
     try
     {
-        auto mapperResponseMsg = bus.call(mapper);
+        auto mapperResponseMsg = call(bus, mapper, CallClass::Query,
+                                      deadline);
 
         mapperResponseMsg.read(mapperResponse);
         if (mapperResponse.empty())
@@ -92,10 +186,18 @@ std::string getService(sdbusplus::bus_t& bus, std::string path,
 
 std::string getProperty(sdbusplus::bus_t& bus, const std::string& path,
                         const std::string& interface,
-                        const std::string& propertyName)
+                        const std::string& propertyName,
+                        const Deadline* deadline)
 {
+    // The lookup and the read together take no longer than one query
+    Deadline queryDeadline(callTimeout(CallClass::Query));
+    if (deadline == nullptr)
+    {
+        deadline = &queryDeadline;
+    }
+
     std::variant<std::string> property;
-    std::string service = getService(bus, path, interface);
+    std::string service = getService(bus, path, interface, deadline);
 
     auto method = bus.new_method_call(service.c_str(), path.c_str(),
                                       PROPERTY_INTERFACE, "Get");
@@ -104,7 +206,7 @@ std::string getProperty(sdbusplus::bus_t& bus, const std::string& path,
 
     try
     {
-        auto reply = bus.call(method);
+        auto reply = call(bus, method, CallClass::Query, deadline);
         reply.read(property);
     }
     catch (const sdbusplus::exception_t& e)
@@ -135,7 +237,7 @@ void setProperty(sdbusplus::bus_t& bus, const std::string& path,
                                       PROPERTY_INTERFACE, "Set");
 
     method.append(interface, property, variantValue);
-    bus.call_noreply(method);
+    call(bus, method, CallClass::Control);
 
     return;
 }
@@ -179,7 +281,7 @@ void createError(
             "xyz.openbmc_project.Logging.Create", "Create");
 
         method.append(errorMsg, errLevel, additionalData);
-        auto resp = bus.call(method);
+        auto resp = call(bus, method, CallClass::Slow);
     }
     catch (const sdbusplus::exception_t& e)
     {
@@ -207,7 +309,7 @@ void createBmcDump(sdbusplus::bus_t& bus)
             std::pair<std::string, std::variant<std::string, uint64_t>>>());
     try
     {
-        bus.call_noreply(method);
+        call(bus, method, CallClass::Slow);
     }
     catch (const sdbusplus::exception_t& e)
     {
@@ -3,6 +3,11 @@
 #include <sdbusplus/bus.hpp>
 #include <xyz/openbmc_project/Logging/Entry/server.hpp>
 
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
 namespace phosphor
 {
 namespace state
@@ -12,6 +17,81 @@ namespace manager
 namespace utils
 {
 
+/** @brief The classes of D-Bus calls, each with its own timeout */
+enum class CallClass
+{
+    /** @brief Property reads and mapper lookups, 10 seconds */
+    Query,
+    /** @brief Requests which change state, e.g. starting a unit, 25 seconds */
+    Control,
+    /** @brief Calls known to be slow, e.g. to systemd while it starts the
+     *         BMC, 60 seconds */
+    Slow,
+};
+
+/** @brief Get the timeout of a class of D-Bus calls
+ *
+ * @param[in] callClass    - The class of the call
+ */
+std::chrono::microseconds callTimeout(CallClass callClass);
+
+/** @class Deadline
+ *  @brief The time left for the D-Bus calls of a compound operation, so
+ *         together they do not take longer than the operation may
+ */
+class Deadline
+{
+  public:
+    /** @brief Start the time of an operation
+     *
+     * @param[in] budget       - The time the operation may take
+     */
+    explicit Deadline(std::chrono::microseconds budget) :
+        end(std::chrono::steady_clock::now() + budget)
+    {}
+
+    /** @brief Get the time left, zero once the deadline has passed */
+    std::chrono::microseconds remaining() const;
+
+  private:
+    /** @brief When the operation has to be done */
+    std::chrono::steady_clock::time_point end;
+};
+
+/** @brief Counters of the D-Bus calls to a service */
+struct CallStats
+{
+    uint64_t calls = 0;
+    uint64_t timeouts = 0;
+
+    /** @brief Calls which failed other than by timing out */
+    uint64_t failures = 0;
+
+    std::chrono::microseconds totalLatency{};
+    std::chrono::microseconds maxLatency{};
+};
+
+/** @brief Call a D-Bus method
+ *
+ * The call times out after the timeout of its class, or when the deadline
+ * passes if that is sooner. The latency and the outcome are counted for
+ * the service called, and a timed out call is logged with its counters.
+ *
+ * @param[in] bus          - The Dbus bus object
+ * @param[in] method       - The method call
+ * @param[in] callClass    - The class of the call
+ * @param[in] deadline     - The deadline of the operation making the call
+ *
+ * @return The reply, will throw sdbusplus::exception_t on failure, with
+ *         ETIMEDOUT if it timed out or the deadline has already passed
+ */
+sdbusplus::message_t call(sdbusplus::bus_t& bus, sdbusplus::message_t& method,
+                          CallClass callClass = CallClass::Query,
+                          const Deadline* deadline = nullptr);
+
+/** @brief Get the counters of the D-Bus calls of this process, by service */
+const std::map<std::string, CallStats>& getCallStats();
+
 /** @brief Tell systemd to generate d-bus events
  *
  * @param[in] bus          - The Dbus bus object
@@ -25,11 +105,13 @@ void subscribeToSystemdSignals(sdbusplus::bus_t& bus);
  * @param[in] bus          - The Dbus bus object
  * @param[in] path         - The Dbus object path
  * @param[in] interface    - The Dbus interface
+ * @param[in] deadline     - The deadline of the operation making the call
  *
  * @return The name of the service
  */
 std::string getService(sdbusplus::bus_t& bus, std::string path,
-                       std::string interface);
+                       std::string interface,
+                       const Deadline* deadline = nullptr);
 
 /** @brief Get the value of input property
  *
@@ -37,12 +119,14 @@ std::string getService(sdbusplus::bus_t& bus, std::string path,
  * @param[in] path         - The Dbus object path
  * @param[in] interface    - The Dbus interface
  * @param[in] property     - The property name to get
+ * @param[in] deadline     - The deadline of the operation making the call
  *
  * @return The value of the property
  */
 std::string getProperty(sdbusplus::bus_t& bus, const std::string& path,
                         const std::string& interface,
-                        const std::string& propertyName);
+                        const std::string& propertyName,
+                        const Deadline* deadline = nullptr);
 
 /** @brief Set the value of property
  *